@@ -4,6 +4,8 @@
 #  FFTW3_INCLUDE_DIR, where to find FFTW3lib.h, etc.
 #  FFTW3_LIBRARIES, the libraries needed to use FFTW3.
 #  JFFTW3_FOUND, If false, do not try to use FFTW3.
+#  FFTW3_THREADS_LIBRARY, the multi-threading extension of FFTW3 (optional,
+#                         enables HasFFTW3Threads).
 # also defined, but not for general use are
 #  FFTW3_LIBRARY, where to find the FFTW3 library.
 
@@ -11,6 +13,7 @@ FIND_PATH(FFTW3_INCLUDE_DIR fftw3.h)
 
 SET(FFTW3_NAMES ${FFTW3_NAMES} fftw3)
 FIND_LIBRARY(FFTW3_LIBRARY NAMES ${FFTW3_NAMES} )
+FIND_LIBRARY(FFTW3_THREADS_LIBRARY NAMES fftw3_threads )
 
 # handle the QUIETLY and REQUIRED arguments and set FFTW3_FOUND to TRUE if 
 # all listed variables are TRUE
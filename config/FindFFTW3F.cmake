@@ -4,6 +4,8 @@
 #  FFTW3F_INCLUDE_DIR, where to find fftw3.h, etc.
 #  FFTW3F_LIBRARIES, the libraries needed to use single-precision FFTW3.
 #  JFFTW3_FOUND, If false, do not try to use FFTW3.
+#  FFTW3F_THREADS_LIBRARY, the multi-threading extension of single-precision
+#                          FFTW3 (optional, enables HasFFTW3FThreads).
 # also defined, but not for general use are
 #  FFTW3F_LIBRARY, where to find the single-precision FFTW3 library.
 
@@ -11,6 +13,7 @@ FIND_PATH(FFTW3F_INCLUDE_DIR fftw3.h)
 
 SET(FFTW3F_NAMES ${FFTW3F_NAMES} fftw3f)
 FIND_LIBRARY(FFTW3F_LIBRARY NAMES ${FFTW3F_NAMES} )
+FIND_LIBRARY(FFTW3F_THREADS_LIBRARY NAMES fftw3f_threads )
 
 # handle the QUIETLY and REQUIRED arguments and set FFTW3F_FOUND to TRUE if 
 # all listed variables are TRUE
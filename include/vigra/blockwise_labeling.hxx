@@ -113,7 +113,7 @@ struct BorderVisitor
 {
     Label u_label_offset;
     Label v_label_offset;
-    UnionFindArray<Label>* global_unions;
+    ConcurrentUnionFindArray<Label>* global_unions;
     Equal* equal;
 
     template <class Data, class Shape>
@@ -159,22 +159,19 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
 
     // mapping stage: label each block and save number of labels assigned in blocks before the current block in label_offsets
     Label unmerged_label_number;
+    auto d = std::distance(data_blocks_begin, data_blocks_end);
+    std::vector<Label> nSeg(d);
     {
         DataBlocksIterator data_blocks_it = data_blocks_begin;
         LabelBlocksIterator label_blocks_it = label_blocks_begin;
         typename MultiArray<Dimensions, Label>::iterator offsets_it = label_offsets.begin();
         Label current_offset = 0;
-        // a la OPENMP_PRAGMA FOR
-
-        auto d = std::distance(data_blocks_begin, data_blocks_end);
-
-
-        std::vector<Label> nSeg(d);
         //std::vector<int> ids(d);
         //std::iota(ids.begin(), ids.end(), 0 );
 
-        parallel_foreach(options.getNumThreads(), d,
-            [&](const int /*threadId*/, const uint64_t i){
+        // with NumaFirstTouch, each block is preferably labeled by its home node
+        blockwise::parallelForEachBlock(options, d,
+            [&](const int /*threadId*/, const std::ptrdiff_t i){
                 Label resVal = labelMultiArray(data_blocks_it[i], label_blocks_it[i],
                                                options, equal);
                 if(has_background) // FIXME: reversed condition?
@@ -195,7 +192,7 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
     }
 
     // reduce stage: merge adjacent labels if the region overlaps
-    UnionFindArray<Label> global_unions(unmerged_label_number);
+    ConcurrentUnionFindArray<Label> global_unions(unmerged_label_number);
     if(has_background)
     {
         // merge all labels that refer to background
@@ -207,93 +204,100 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
         }
     }
 
+    // the faces between adjacent blocks are visited in parallel
     typedef GridGraph<Dimensions, undirected_tag> Graph;
     typedef typename Graph::edge_iterator EdgeIterator;
     Graph blocks_graph(blocks_shape, options.getNeighborhood());
+    std::vector<std::pair<Shape, Shape> > block_pairs;
+    block_pairs.reserve(blocks_graph.edgeNum());
     for(EdgeIterator it = blocks_graph.get_edge_iterator(); it != blocks_graph.get_edge_end_iterator(); ++it)
+        block_pairs.push_back(std::make_pair(Shape(blocks_graph.u(*it)), Shape(blocks_graph.v(*it))));
+
+    blockwise::parallelForEachBlock(options, block_pairs.size(),
+        [&](const int /*threadId*/, const std::ptrdiff_t i){
+            Shape u = block_pairs[i].first;
+            Shape v = block_pairs[i].second;
+            Shape difference = v - u;
+
+            BorderVisitor<Equal, Label> border_visitor;
+            border_visitor.u_label_offset = label_offsets[u];
+            border_visitor.v_label_offset = label_offsets[v];
+            border_visitor.global_unions = &global_unions;
+            border_visitor.equal = &equal;
+            visitBorder(data_blocks_begin[u], label_blocks_begin[u],
+                        data_blocks_begin[v], label_blocks_begin[v],
+                        difference, options.getNeighborhood(), border_visitor);
+        }
+    );
+
+    // number the merged regions contiguously: since every region is represented by its
+    // smallest label, a single sweep assigns numbers in order of the representatives
+    // (label 0 is either the background or unused, and keeps number 0)
+    std::vector<Label> global_labels(unmerged_label_number);
+    Label region_count = 0;
+    for(Label current_label = 0; current_label != unmerged_label_number; ++current_label)
     {
-        Shape u = blocks_graph.u(*it);
-        Shape v = blocks_graph.v(*it);
-        Shape difference = v - u;
-
-        BorderVisitor<Equal, Label> border_visitor;
-        border_visitor.u_label_offset = label_offsets[u];
-        border_visitor.v_label_offset = label_offsets[v];
-        border_visitor.global_unions = &global_unions;
-        border_visitor.equal = &equal;
-        visitBorder(data_blocks_begin[u], label_blocks_begin[u],
-                    data_blocks_begin[v], label_blocks_begin[v],
-                    difference, options.getNeighborhood(), border_visitor);
+        global_labels[current_label] = global_unions.isRoot(current_label)
+                                           ? region_count++
+                                           : global_labels[global_unions.findIndex(current_label)];
     }
+    Label last_label = region_count - 1;
 
     // fill mapping (local labels) -> (global labels)
-    Label last_label = global_unions.makeContiguous();
-    {
-        typename MultiArray<Dimensions, Label>::iterator offsets_it = label_offsets.begin();
-        Label offset = *offsets_it;
-        ++offsets_it;
-        typename Mapping::iterator mapping_it = mapping.begin();
-        for( ; offsets_it != label_offsets.end(); ++offsets_it, ++mapping_it)
-        {
-            mapping_it->clear();
-            Label next_offset = *offsets_it;
+    typename MultiArray<Dimensions, Label>::iterator offsets_begin = label_offsets.begin();
+    typename Mapping::iterator mapping_begin = mapping.begin();
+    blockwise::parallelForEachBlock(options, d,
+        [&](const int /*threadId*/, const std::ptrdiff_t i){
+            std::vector<Label> & block_mapping = mapping_begin[i];
+            Label offset = offsets_begin[i];
+            block_mapping.clear();
             if(has_background)
             {
-                for(Label current_label = offset; current_label != next_offset; ++current_label)
+                for(Label current_label = offset; current_label != offset + nSeg[i]; ++current_label)
                 {
-                    mapping_it->push_back(global_unions.findLabel(current_label));
+                    block_mapping.push_back(global_labels[current_label]);
                 }
             }
             else
             {
-                mapping_it->push_back(0); // local labels start at 1
-                for(Label current_label = offset + 1; current_label != next_offset + 1; ++current_label)
+                block_mapping.push_back(0); // local labels start at 1
+                for(Label current_label = offset + 1; current_label != offset + nSeg[i] + 1; ++current_label)
                 {
-                    mapping_it->push_back(global_unions.findLabel(current_label));
+                    block_mapping.push_back(global_labels[current_label]);
                 }
             }
-
-            offset = next_offset;
-        }
-        // last block:
-        // instead of next_offset, use last_label+1
-        mapping_it->clear();
-        if(has_background)
-        {
-            for(Label current_label = offset; current_label != unmerged_label_number; ++current_label)
-            {
-                mapping_it->push_back(global_unions.findLabel(current_label));
-            }
-        }
-        else
-        {
-            mapping_it->push_back(0);
-            for(Label current_label = offset + 1; current_label != unmerged_label_number; ++current_label)
-            {
-                mapping_it->push_back(global_unions.findLabel(current_label));
-            }
         }
-    }
+    );
     return last_label;
 }
 
 
 template <class LabelBlocksIterator, class MappingIterator>
 void toGlobalLabels(LabelBlocksIterator label_blocks_begin, LabelBlocksIterator label_blocks_end,
-                    MappingIterator mapping_begin, MappingIterator mapping_end)
+                    MappingIterator mapping_begin, MappingIterator mapping_end,
+                    ParallelOptions const & options = ParallelOptions().numThreads(1))
 {
     typedef typename LabelBlocksIterator::value_type LabelBlock;
-    for( ; label_blocks_begin != label_blocks_end; ++label_blocks_begin, ++mapping_begin)
-    {
-        vigra_assert(mapping_begin != mapping_end, "");
-        for(typename LabelBlock::iterator labels_it = label_blocks_begin->begin();
-            labels_it != label_blocks_begin->end();
-            ++labels_it)
-        {
-            vigra_assert(*labels_it < mapping_begin->size(), "");
-            *labels_it = (*mapping_begin)[*labels_it];
+    std::ptrdiff_t block_count = std::distance(label_blocks_begin, label_blocks_end);
+    vigra_assert(block_count <= std::distance(mapping_begin, mapping_end), "");
+    ignore_argument(mapping_end);
+
+    blockwise::parallelForEachBlock(options, block_count,
+        [&](const int /*threadId*/, const std::ptrdiff_t i){
+            // a separate iterator keeps the block's chunk alive (if any)
+            LabelBlocksIterator block = label_blocks_begin;
+            block += i;
+            MappingIterator mapping = mapping_begin;
+            mapping += i;
+            for(typename LabelBlock::iterator labels_it = block->begin();
+                labels_it != block->end();
+                ++labels_it)
+            {
+                vigra_assert(*labels_it < mapping->size(), "");
+                *labels_it = (*mapping)[*labels_it];
+            }
         }
-    }
+    );
 }
 
 } // namespace blockwise_labeling_detail
@@ -439,7 +443,7 @@ Label labelMultiArrayBlockwise(const MultiArrayView<N, Data, S1>& data,
                                          options, equal, mapping);
 
     // replace local labels by global labels
-    toGlobalLabels(label_blocks.begin(), label_blocks.end(), mapping.begin(), mapping.end());
+    toGlobalLabels(label_blocks.begin(), label_blocks.end(), mapping.begin(), mapping.end(), options);
     return last_label;
 }
 
@@ -489,7 +493,8 @@ Label labelMultiArrayBlockwise(const ChunkedArray<N, Data>& data,
     MultiArray<N, std::vector<Label> > mapping(data.chunkArrayShape());
     Label result = labelMultiArrayBlockwise(data, labels, options, equal, mapping);
     typedef typename ChunkedArray<N, Data>::shape_type Shape;
-    toGlobalLabels(labels.chunk_begin(Shape(0), data.shape()), labels.chunk_end(Shape(0), data.shape()), mapping.begin(), mapping.end());
+    toGlobalLabels(labels.chunk_begin(Shape(0), data.shape()), labels.chunk_end(Shape(0), data.shape()),
+                   mapping.begin(), mapping.end(), options);
     return result;
 }
 
@@ -501,6 +506,369 @@ Label labelMultiArrayBlockwise(const ChunkedArray<N, Data>& data,
     return labelMultiArrayBlockwise(data, labels, options, std::equal_to<Data>());
 }
 
+namespace blockwise_labeling_detail
+{
+
+    // Union-find structure whose parent table is stored in a ChunkedArray, so that
+    // it can be swapped out to disk. Labels are appended in increasing order, and the
+    // larger root is always linked below the smaller one. Thus, every non-root entry
+    // points to a smaller label. A contiguous range of the table (the window) can be
+    // checked out into memory, and accesses within this range don't touch the
+    // ChunkedArray.
+template <class Label>
+class ChunkedUnionFind
+{
+    ChunkedArray<1, Label> & parents_;
+    MultiArrayIndex size_;
+    MultiArray<1, Label> window_;
+    MultiArrayIndex window_begin_;
+
+    Label parent(Label label) const
+    {
+        MultiArrayIndex i = (MultiArrayIndex)label - window_begin_;
+        return 0 <= i && i < window_.size()
+                   ? window_(i)
+                   : parents_.getItem(Shape1(label));
+    }
+
+    void setParent(Label label, Label parent)
+    {
+        MultiArrayIndex i = (MultiArrayIndex)label - window_begin_;
+        if(0 <= i && i < window_.size())
+            window_(i) = parent;
+        else
+            parents_.setItem(Shape1(label), parent);
+    }
+
+  public:
+    explicit ChunkedUnionFind(ChunkedArray<1, Label> & parents)
+    : parents_(parents),
+      size_(0),
+      window_begin_(0)
+    {}
+
+    MultiArrayIndex size() const
+    {
+        return size_;
+    }
+
+        // append the singletons size() ... end-1
+    void extend(MultiArrayIndex end)
+    {
+        vigra_precondition(end - 1 <= (MultiArrayIndex)NumericTraits<Label>::max(),
+            "labelMultiArrayStreaming(): Need more labels than can be represented in the destination type.");
+        vigra_precondition(end <= parents_.shape(0),
+            "labelMultiArrayStreaming(): equivalence table too small.");
+        vigra_invariant(window_.size() == 0,
+            "ChunkedUnionFind::extend(): window must not be checked out.");
+        if(end <= size_)
+            return;
+        MultiArray<1, Label> singletons(Shape1(end - size_));
+        linearSequence(singletons.begin(), singletons.end(), (Label)size_);
+        parents_.commitSubarray(Shape1(size_), singletons);
+        size_ = end;
+    }
+
+        // check out the entries begin ... size()-1
+    void beginWindow(MultiArrayIndex begin)
+    {
+        window_begin_ = begin;
+        window_.reshape(Shape1(size_ - begin));
+        parents_.checkoutSubarray(Shape1(begin), window_);
+    }
+
+        // write the window back to the table
+    void endWindow()
+    {
+        parents_.commitSubarray(Shape1(window_begin_), window_);
+        window_.reshape(Shape1(0));
+    }
+
+    Label findIndex(Label label)
+    {
+        Label p = parent(label);
+        while(p != label)
+        {
+            // path halving
+            Label grandparent = parent(p);
+            if(grandparent != p)
+                setParent(label, grandparent);
+            label = grandparent;
+            p = parent(label);
+        }
+        return label;
+    }
+
+    void makeUnion(Label l1, Label l2)
+    {
+        l1 = findIndex(l1);
+        l2 = findIndex(l2);
+        if(l1 < l2)
+            setParent(l2, l1);
+        else if(l2 < l1)
+            setParent(l1, l2);
+    }
+
+        // Replace each entry with the contiguous number of its region (in the order
+        // of the representatives) and return the number of regions. Since parents precede
+        // their children, a single sweep suffices, and the table is processed in
+        // blocks of the given size.
+    MultiArrayIndex makeContiguous(MultiArrayIndex block_size)
+    {
+        Label count = 0;
+        for(MultiArrayIndex begin = 0; begin < size_; begin += block_size)
+        {
+            MultiArrayIndex end = std::min(size_, begin + block_size);
+            MultiArray<1, Label> block(Shape1(end - begin));
+            parents_.checkoutSubarray(Shape1(begin), block);
+            for(MultiArrayIndex i = begin; i < end; ++i)
+            {
+                MultiArrayIndex parent = block(i - begin);
+                if(parent == i)
+                    block(i - begin) = count++;
+                else if(parent >= begin)
+                    block(i - begin) = block(parent - begin);
+                else
+                    block(i - begin) = parents_.getItem(Shape1(parent));
+            }
+            parents_.commitSubarray(Shape1(begin), block);
+        }
+        return count;
+    }
+};
+
+    // collect the pairs of labels to be merged across a slab border
+template <class Equal, class Label>
+struct StreamingBorderVisitor
+{
+    std::vector<std::pair<Label, Label> >* pairs;
+    Equal* equal;
+
+    template <class Data, class Shape>
+    void operator()(const Data& u_data, Label& u_label, const Data& v_data, Label& v_label, const Shape& diff)
+    {
+        if(labeling_equality::callEqual(*equal, u_data, v_data, diff))
+        {
+            pairs->push_back(std::make_pair(u_label, v_label));
+        }
+    }
+};
+
+} // namespace blockwise_labeling_detail
+
+/*************************************************************/
+/*                                                           */
+/*                      labelMultiArrayStreaming             */
+/*                                                           */
+/*************************************************************/
+
+/** \brief Connected components labeling for huge ChunkedArrays with bounded memory.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        // use the given (possibly disk-based) array for the equivalence table
+        template <unsigned int N, class Data, class Label,
+                  class Equal = std::equal_to<Data> >
+        Label labelMultiArrayStreaming(const ChunkedArray<N, Data>& data,
+                                       ChunkedArray<N, Label>& labels,
+                                       ChunkedArray<1, Label>& equivalences,
+                                       const BlockwiseLabelOptions& options = BlockwiseLabelOptions(),
+                                       Equal equal = std::equal_to<Data>());
+
+        // keep the equivalence table in memory
+        template <unsigned int N, class Data, class Label,
+                  class Equal = std::equal_to<Data> >
+        Label labelMultiArrayStreaming(const ChunkedArray<N, Data>& data,
+                                       ChunkedArray<N, Label>& labels,
+                                       const BlockwiseLabelOptions& options = BlockwiseLabelOptions(),
+                                       Equal equal = std::equal_to<Data>());
+    }
+    \endcode
+
+    In contrast to \ref labelMultiArrayBlockwise(), this function never holds more than
+    one slab of the data in memory. The array is processed in slabs along the last axis
+    whose thickness equals the chunk size of <tt>labels</tt> along that axis. Every slab
+    is labeled as a whole (using <tt>options.getNumThreads()</tt> threads, see
+    \ref labelMultiArray()), and its provisional labels are merged with those of the last
+    plane of the previous slab, which is the only state retained between slabs. The
+    provisional labels are written to <tt>labels</tt>. A second pass then replaces them
+    with the final labels, slab by slab. <tt>labels</tt> may therefore be a
+    \ref ChunkedArrayHDF5 or any other disk-based chunked array.
+
+    The equivalence table between provisional labels needs one entry per provisional label.
+    Pass an array such as \ref ChunkedArrayTmpFile or \ref ChunkedArrayHDF5 as
+    <tt>equivalences</tt> to spill it to disk. It must be at least as long as the number of
+    provisional labels plus one; <tt>data.size() + 1</tt> is always sufficient (and cheap
+    for these array types, because untouched chunks are never allocated). The variant without
+    this argument keeps the table in a \ref ChunkedArrayLazy.
+
+    The result is identical to \ref labelMultiArray() (not just equivalent),
+    and \ref NeighborhoodType and background value (if any) are specified by the
+    <tt>options</tt>. Custom block shapes are not supported.
+
+    Return: the number of regions found (=largest region label)
+
+    <b> Usage: </b>
+
+    <b>\#include </b> \<vigra/blockwise_labeling.hxx\><br>
+    Namespace: vigra
+
+    \code
+    ChunkedArrayHDF5<3, UInt8>  data(file, "data");
+    ChunkedArrayHDF5<3, UInt32> labels(file, "labels", HDF5File::New, data.shape());
+    ChunkedArrayTmpFile<1, UInt32> equivalences(Shape1(data.size() + 1));
+
+    UInt32 count = labelMultiArrayStreaming(data, labels, equivalences,
+                                            BlockwiseLabelOptions().ignoreBackgroundValue(0)
+                                                                   .numThreads(16));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> unsigned int labelMultiArrayStreaming)
+
+template <unsigned int N, class Data, class Label, class Equal>
+Label labelMultiArrayStreaming(const ChunkedArray<N, Data>& data,
+                               ChunkedArray<N, Label>& labels,
+                               ChunkedArray<1, Label>& equivalences,
+                               const BlockwiseLabelOptions& options,
+                               Equal equal)
+{
+    using namespace blockwise_labeling_detail;
+
+    typedef typename MultiArrayShape<N>::type Shape;
+    static const unsigned int last = N - 1;
+
+    vigra_precondition(data.shape() == labels.shape(),
+        "labelMultiArrayStreaming(): shape mismatch between input and output.");
+    vigra_precondition(options.getBlockShape().size() == 0,
+        "labelMultiArrayStreaming(): custom block shapes not supported "
+        "(always uses the chunk shape of the labels).");
+
+    Shape shape = data.shape(),
+          plane_shape = shape;
+    plane_shape[last] = 1;
+    MultiArrayIndex thickness = labels.chunkShape()[last];
+
+    ChunkedUnionFind<Label> regions(equivalences);
+    regions.extend(1); // label 0 is the background (or unused)
+
+    // pass 1: label the slabs and merge provisional labels across slab borders
+    MultiArray<N, Data>  boundary_data(plane_shape);
+    MultiArray<N, Label> boundary_labels(plane_shape);
+    std::vector<std::pair<Label, Label> > slab_labels; // first label and count per slab
+    for(MultiArrayIndex start = 0; start < shape[last]; start += thickness)
+    {
+        Shape slab_begin, slab_shape(shape);
+        slab_begin[last] = start;
+        slab_shape[last] = std::min(thickness, shape[last] - start);
+
+        MultiArray<N, Data>  slab_data(slab_shape);
+        MultiArray<N, Label> slab_labels_array(slab_shape);
+        data.checkoutSubarray(slab_begin, slab_data);
+        Label count = labelMultiArray(slab_data, slab_labels_array,
+                                      static_cast<LabelOptions const &>(options),
+                                      static_cast<ParallelOptions const &>(options),
+                                      equal);
+
+        // local label l > 0 becomes provisional label 'offset + l'
+        Label offset = (Label)(regions.size() - 1);
+        regions.extend(regions.size() + count);
+        if(offset > 0)
+        {
+            for(typename MultiArray<N, Label>::iterator it = slab_labels_array.begin();
+                it != slab_labels_array.end(); ++it)
+            {
+                if(*it != 0)
+                    *it += offset;
+            }
+        }
+        slab_labels.push_back(std::make_pair(offset, count));
+
+        if(start > 0)
+        {
+            Shape difference;
+            difference[last] = 1;
+            std::vector<std::pair<Label, Label> > pairs;
+            StreamingBorderVisitor<Equal, Label> border_visitor;
+            border_visitor.pairs = &pairs;
+            border_visitor.equal = &equal;
+            visitBorder(boundary_data, boundary_labels, slab_data, slab_labels_array,
+                        difference, options.getNeighborhood(), border_visitor);
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+            // the merged labels belong to the previous and current slab, whose
+            // part of the table is processed in memory
+            regions.beginWindow(slab_labels[slab_labels.size()-2].first + 1);
+            for(std::size_t k = 0; k < pairs.size(); ++k)
+                regions.makeUnion(pairs[k].first, pairs[k].second);
+            regions.endWindow();
+        }
+
+        labels.commitSubarray(slab_begin, slab_labels_array);
+
+        Shape plane_begin;
+        plane_begin[last] = slab_shape[last] - 1;
+        boundary_data = slab_data.subarray(plane_begin, slab_shape);
+        boundary_labels = slab_labels_array.subarray(plane_begin, slab_shape);
+    }
+
+    Label region_count = (Label)regions.makeContiguous(1 << 20);
+
+    // pass 2: replace provisional labels with the final ones
+    for(MultiArrayIndex start = 0, slab = 0; start < shape[last]; start += thickness, ++slab)
+    {
+        Shape slab_begin, slab_shape(shape);
+        slab_begin[last] = start;
+        slab_shape[last] = std::min(thickness, shape[last] - start);
+
+        Label offset = slab_labels[slab].first;
+        MultiArray<1, Label> mapping(Shape1(slab_labels[slab].second + 1));
+        equivalences.checkoutSubarray(Shape1(offset), mapping);
+        mapping(0) = 0;   // background (when offset > 0, this is the previous slab's last label)
+
+        MultiArray<N, Label> slab_labels_array(slab_shape);
+        labels.checkoutSubarray(slab_begin, slab_labels_array);
+        for(typename MultiArray<N, Label>::iterator it = slab_labels_array.begin();
+            it != slab_labels_array.end(); ++it)
+        {
+            *it = *it == 0
+                      ? 0
+                      : mapping(*it - offset);
+        }
+        labels.commitSubarray(slab_begin, slab_labels_array);
+    }
+    return region_count - 1;
+}
+
+template <unsigned int N, class Data, class Label>
+Label labelMultiArrayStreaming(const ChunkedArray<N, Data>& data,
+                               ChunkedArray<N, Label>& labels,
+                               ChunkedArray<1, Label>& equivalences,
+                               const BlockwiseLabelOptions& options = BlockwiseLabelOptions())
+{
+    return labelMultiArrayStreaming(data, labels, equivalences, options, std::equal_to<Data>());
+}
+
+template <unsigned int N, class Data, class Label, class Equal>
+Label labelMultiArrayStreaming(const ChunkedArray<N, Data>& data,
+                               ChunkedArray<N, Label>& labels,
+                               const BlockwiseLabelOptions& options,
+                               Equal equal)
+{
+    ChunkedArrayLazy<1, Label> equivalences(Shape1(data.size() + 1), Shape1(1 << 16));
+    return labelMultiArrayStreaming(data, labels, equivalences, options, equal);
+}
+
+template <unsigned int N, class Data, class Label>
+Label labelMultiArrayStreaming(const ChunkedArray<N, Data>& data,
+                               ChunkedArray<N, Label>& labels,
+                               const BlockwiseLabelOptions& options = BlockwiseLabelOptions())
+{
+    return labelMultiArrayStreaming(data, labels, options, std::equal_to<Data>());
+}
+
 //@}
 
 } // namespace vigra
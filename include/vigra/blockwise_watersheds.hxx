@@ -43,8 +43,13 @@
 #include "blockwise_labeling.hxx"
 #include "metaprogramming.hxx"
 #include "overlapped_blocks.hxx"
+#include "multi_watersheds.hxx"
 
 #include <limits>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <algorithm>
 
 namespace vigra
 {
@@ -131,6 +136,136 @@ struct UnionFindWatershedsEquality
     {};
 };
 
+    // Queue entry for seeded flooding. Nodes are flooded in the order of their level,
+    // then of their distance (in steps) along the current plateau, then of their
+    // scan-order index in the entire array. This order is independent of the block
+    // decomposition, so blockwise flooding reproduces the sequential result.
+template <unsigned int N, class Cost>
+struct FloodingEntry
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    Cost level;
+    UInt32 hops;
+    MultiArrayIndex index;
+    Shape point;    // relative to the current window
+
+    bool operator>(FloodingEntry const & other) const
+    {
+        if(level != other.level)
+            return other.level < level;
+        if(hops != other.hops)
+            return hops > other.hops;
+        return index > other.index;
+    }
+};
+
+    // Work space of floodBlock(), allocated once per thread for the largest window.
+template <unsigned int N, class Label, class Cost>
+struct FloodingBuffers
+{
+    MultiArray<N, Label>  labels;
+    MultiArray<N, Cost>   levels;
+    MultiArray<N, UInt32> hops;
+};
+
+    // Flood the inner part [inner_begin, inner_end) of a window from the seeds inside
+    // and the current state of the window's margin. Returns true if the inner labels,
+    // levels or hop counts changed.
+template <unsigned int N, class Data, class S1, class Label, class S2, class Cost, class S3, class S4, class S5>
+bool floodBlock(MultiArrayView<N, Data, S1> const & data,
+                MultiArrayView<N, Label, S2> labels,
+                MultiArrayView<N, Cost, S3> levels,
+                MultiArrayView<N, UInt32, S4> hops,
+                MultiArrayView<N, UInt8, S5> const & seeds,
+                typename MultiArrayShape<N>::type const & inner_begin,
+                typename MultiArrayShape<N>::type const & inner_end,
+                typename MultiArrayShape<N>::type const & window_begin,
+                typename MultiArrayShape<N>::type const & scan_strides,
+                NeighborhoodType neighborhood,
+                WatershedOptions const & options,
+                FloodingBuffers<N, Label, Cost> & buffers)
+{
+    typedef GridGraph<N, undirected_tag> Graph;
+    typedef typename Graph::NodeIt       GraphScanner;
+    typedef typename Graph::OutArcIt     NeighborIterator;
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef FloodingEntry<N, Cost> Entry;
+
+    std::pair<Shape, Shape> inner(inner_begin, inner_end);
+    bool stop_at_threshold = (options.terminate & StopAtThreshold) != 0;
+
+    Shape window_shape = data.shape();
+    MultiArrayView<N, Label, StridedArrayTag>  block_labels = buffers.labels.subarray(Shape(), window_shape);
+    MultiArrayView<N, Cost, StridedArrayTag>   block_levels = buffers.levels.subarray(Shape(), window_shape);
+    MultiArrayView<N, UInt32, StridedArrayTag> block_hops   = buffers.hops.subarray(Shape(), window_shape);
+    block_labels = labels;
+    block_levels = levels;
+    block_hops = hops;
+
+    Graph graph(data.shape(), neighborhood);
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > pqueue;
+    for(GraphScanner node(graph); node != lemon::INVALID; ++node)
+    {
+        if(within(*node, inner) && !seeds[*node])
+            block_labels[*node] = 0;    // recompute from scratch
+        if(block_labels[*node] != 0)
+        {
+            Entry entry = { block_levels[*node], block_hops[*node],
+                            dot(window_begin + *node, scan_strides), *node };
+            pqueue.push(entry);
+        }
+    }
+
+    while(!pqueue.empty())
+    {
+        Entry entry = pqueue.top();
+        pqueue.pop();
+
+        if(stop_at_threshold && entry.level > options.max_cost)
+            break;
+
+        Label label = block_labels[entry.point];
+        for(NeighborIterator arc(graph, entry.point); arc != lemon::INVALID; ++arc)
+        {
+            Shape target = graph.target(*arc);
+            if(block_labels[target] != 0 || !within(target, inner))
+                continue;
+
+            Cost level = data[target];
+            UInt32 hop_count = 0;
+            if(!(entry.level < level))
+            {
+                level = entry.level;
+                hop_count = entry.hops + 1;
+            }
+            block_labels[target] = label;
+            block_levels[target] = level;
+            block_hops[target] = hop_count;
+
+            Entry next = { level, hop_count, dot(window_begin + target, scan_strides), target };
+            pqueue.push(next);
+        }
+    }
+
+    bool changed = false;
+    for(GraphScanner node(graph); node != lemon::INVALID; ++node)
+    {
+        if(!within(*node, inner) || seeds[*node])
+            continue;
+        Label label = block_labels[*node];
+        if(label != labels[*node] ||
+           (label != 0 && (block_levels[*node] != levels[*node] || block_hops[*node] != hops[*node])))
+        {
+            labels[*node] = label;
+            levels[*node] = block_levels[*node];
+            hops[*node] = block_hops[*node];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
 } // namespace blockwise_watersheds_detail
 
 /*************************************************************/
@@ -257,6 +392,217 @@ unionFindWatershedsBlockwise(const ChunkedArray<N, Data>& data,
     return unionFindWatershedsBlockwise(data, labels, options, directions);
 }
 
+/*************************************************************/
+/*                                                           */
+/*                      seededWatershedsBlockwise            */
+/*                                                           */
+/*************************************************************/
+
+/** \weakgroup ParallelProcessing
+    \sa seededWatershedsBlockwise <B>(...)</B>
+*/
+
+/** \brief Parallel seeded region-growing watersheds for MultiArrays.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class Data, class S1,
+                                  class Label, class S2>
+        Label
+        seededWatershedsBlockwise(MultiArrayView<N, Data, S1> const & data,
+                                  MultiArrayView<N, Label, S2> labels,   // may also hold input seeds
+                                  BlockwiseLabelOptions const & options = BlockwiseLabelOptions(),
+                                  WatershedOptions const & watershed_options = WatershedOptions());
+    }
+    \endcode
+
+    This is a parallel version of \ref watershedsMultiArray() with
+    <tt>WatershedOptions().regionGrowing()</tt>. The array is divided into blocks
+    of shape <tt>options.getBlockShape()</tt>. Each block is flooded from the seeds it
+    contains and from the current labels along its border. To avoid conflicts, the blocks
+    are processed in 2<sup>N</sup> groups in which no two blocks touch (like the colors
+    of a checkerboard), using <tt>options.getNumThreads()</tt> threads. Whenever a region
+    arrives at a block border at a lower level (or earlier) than before, the
+    neighboring block is flooded again in the next sweep. The algorithm stops after the
+    first sweep without changes. The number of sweeps is bounded by the number of block borders
+    crossed by the flooding paths, so it is usually small. When the paths wind through the blocks
+    (e.g. along serpentine plateaus), the blockwise iteration becomes inefficient. Therefore, if it
+    has not converged after <tt>2<sup>N</sup>(d+1)+1</tt> sweeps, where <tt>d</tt> is the number
+    of block borders between opposite corners of the block grid, the result is computed by a
+    single sequential flood over the entire array instead.
+
+    Ties between pixels of equal priority are broken deterministically: pixels
+    are flooded in the order of their level, then of their distance (in steps) from
+    the point where the flood reached the current level, then of their scan-order index.
+    Therefore, the result does not depend on the block shape or the number of threads, and
+    equals sequential region growing with the same tie-breaking rule (i.e. this function
+    called with a single block). In contrast, \ref watershedsMultiArray() breaks ties in
+    the order of its priority queue, so the two results may differ on plateaus.
+
+    Seeds are handled as in \ref watershedsMultiArray(). If <tt>labels</tt> contains no
+    seeds, or if <tt>watershed_options</tt> explicitly requests seed computation, seeds are
+    generated first (sequentially). <tt>watershed_options.stopAtThreshold()</tt> is
+    supported, but <tt>keepContours()</tt> and <tt>biasLabel()</tt> are not: contour
+    pixels depend on the processing order, and with a biased label, a pixel's priority
+    depends on the region that reaches it first, so that the result could no longer be
+    determined block by block.
+
+    Return: the largest seed label
+
+    <b> Usage: </b>
+
+    <b>\#include </b> \<vigra/blockwise_watersheds.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float>  gradient(Shape3(300, 300, 300));
+    MultiArray<3, UInt32> labels(gradient.shape());
+    // compute gradient magnitude, put seeds into labels ...
+
+    seededWatershedsBlockwise(gradient, labels,
+                              BlockwiseLabelOptions().blockShape(64).numThreads(8)
+                                                     .neighborhood(IndirectNeighborhood));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> unsigned int seededWatershedsBlockwise)
+
+template <unsigned int N, class Data, class S1,
+                          class Label, class S2>
+Label seededWatershedsBlockwise(MultiArrayView<N, Data, S1> const & data,
+                                MultiArrayView<N, Label, S2> labels,
+                                BlockwiseLabelOptions const & options = BlockwiseLabelOptions(),
+                                WatershedOptions const & watershed_options = WatershedOptions())
+{
+    using namespace blockwise_watersheds_detail;
+
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef Data Cost;
+
+    Shape shape = data.shape();
+    vigra_precondition(shape == labels.shape(),
+        "seededWatershedsBlockwise(): shapes of data and labels do not match.");
+    vigra_precondition((watershed_options.terminate & KeepContours) == 0,
+        "seededWatershedsBlockwise(): keepContours() is not supported.");
+    vigra_precondition(watershed_options.biased_label == 0 || watershed_options.bias == 1.0,
+        "seededWatershedsBlockwise(): biasLabel() is not supported.");
+
+    // compute seeds if necessary (see lemon_graph::watershedsGraph())
+    SeedOptions seed_options;
+    if(watershed_options.seed_options.mini != SeedOptions::Unspecified)
+        seed_options = watershed_options.seed_options;
+    else if(labels.any())
+        seed_options.mini = SeedOptions::Unspecified;
+    if(seed_options.mini != SeedOptions::Unspecified)
+    {
+        GridGraph<N, undirected_tag> graph(shape, options.getNeighborhood());
+        lemon_graph::graph_detail::generateWatershedSeeds(graph, data, labels, seed_options);
+    }
+
+    MultiArray<N, Cost>   levels(shape);
+    MultiArray<N, UInt32> hops(shape);
+    MultiArray<N, UInt8>  seeds(shape);
+    Label max_label = 0;
+    for(MultiCoordinateIterator<N> p(shape), end = p.getEndIterator(); p != end; ++p)
+    {
+        Label label = labels[*p];
+        if(label == 0)
+            continue;
+        seeds[*p] = 1;
+        levels[*p] = data[*p];
+        max_label = std::max(max_label, label);
+    }
+
+    // group the blocks by the parity of their coordinates, so that the blocks
+    // of a group don't touch and can be flooded concurrently
+    Shape block_shape = options.getBlockShapeN<N>();
+    Shape blocks_per_axis = (shape + block_shape - Shape(1)) / block_shape;
+    ArrayVector<ArrayVector<Shape> > groups(1 << N);
+    for(MultiCoordinateIterator<N> b(blocks_per_axis), end = b.getEndIterator(); b != end; ++b)
+    {
+        unsigned int group = 0;
+        for(unsigned int k = 0; k < N; ++k)
+            group |= ((*b)[k] & 1) << k;
+        groups[group].push_back(*b);
+    }
+
+    // time stamps (counting group passes) of the last change and the last flooding
+    // of each block, so that a block is only flooded again when itself or a
+    // touching block changed in the meantime
+    MultiArray<N, UInt32> changed_at(blocks_per_axis, 1u),
+                          flooded_at(blocks_per_axis, 0u);
+    UInt32 time = 1;
+
+    // Flooding paths rarely cross many more block borders than lie between opposite
+    // corners of the block grid. Beyond this number of sweeps, a sequential flood
+    // is cheaper than continuing the iteration.
+    MultiArrayIndex max_sweeps = (1 << N)*(sum(blocks_per_axis - Shape(1)) + 1) + 1;
+
+    ThreadPool pool(options);
+    ArrayVector<FloodingBuffers<N, Label, Cost> > buffers(std::max<std::size_t>(1, pool.nThreads()));
+    Shape max_window_shape = min(block_shape + Shape(2), shape);
+
+    bool changed = true;
+    for(MultiArrayIndex sweep = 0; changed; ++sweep)
+    {
+        if(sweep == max_sweeps)
+        {
+            // the flood starts from the seeds only, so the intermediate state is irrelevant
+            FloodingBuffers<N, Label, Cost> & whole = buffers[0];
+            whole.labels.reshape(shape);
+            whole.levels.reshape(shape);
+            whole.hops.reshape(shape);
+            floodBlock(data, labels, levels, hops, seeds, Shape(), shape, Shape(), levels.stride(),
+                       options.getNeighborhood(), watershed_options, whole);
+            break;
+        }
+        changed = false;
+        for(unsigned int g = 0; g < groups.size(); ++g, ++time)
+        {
+            ArrayVector<Shape> const & group = groups[g];
+            std::vector<UInt8> block_changed(group.size(), 0);
+            parallel_foreach(pool, group.size(),
+                [&](const int threadId, const std::ptrdiff_t i)
+                {
+                    Shape block = group[i];
+                    MultiArrayView<N, UInt32> touching =
+                        changed_at.subarray(max(block - Shape(1), Shape(0)),
+                                            min(block + Shape(2), blocks_per_axis));
+                    if(flooded_at[block] >= *std::max_element(touching.begin(), touching.end()))
+                        return;
+                    flooded_at[block] = time;
+
+                    Shape block_begin = block * block_shape,
+                          block_end = min(block_begin + block_shape, shape),
+                          window_begin = max(block_begin - Shape(1), Shape(0)),
+                          window_end = min(block_end + Shape(1), shape);
+                    FloodingBuffers<N, Label, Cost> & thread_buffers = buffers[threadId];
+                    if(thread_buffers.labels.size() == 0)
+                    {
+                        thread_buffers.labels.reshape(max_window_shape);
+                        thread_buffers.levels.reshape(max_window_shape);
+                        thread_buffers.hops.reshape(max_window_shape);
+                    }
+                    block_changed[i] = floodBlock(data.subarray(window_begin, window_end),
+                                                  labels.subarray(window_begin, window_end),
+                                                  levels.subarray(window_begin, window_end),
+                                                  hops.subarray(window_begin, window_end),
+                                                  seeds.subarray(window_begin, window_end),
+                                                  block_begin - window_begin, block_end - window_begin,
+                                                  window_begin, levels.stride(),
+                                                  options.getNeighborhood(), watershed_options,
+                                                  thread_buffers);
+                    if(block_changed[i])
+                        changed_at[block] = time;
+                });
+            for(unsigned int i = 0; i < block_changed.size(); ++i)
+                changed = changed || block_changed[i] != 0;
+        }
+    }
+    return max_label;
+}
+
 //@}
 
 } // namespace vigra
@@ -50,9 +50,40 @@ enum CompressionMethod {  DEFAULT_COMPRESSION=-2,  // use default method (depend
                           ZLIB_FAST=1, // fastest compression using zlib
                           ZLIB=6,      // zlib default compression level
                           ZLIB_BEST=9, // highest compression using zlib
-                          LZ4          // very fast LZ4 algorithm
+                          LZ4,         // very fast LZ4 algorithm
+                          ZSTD_FAST=101, // fastest compression using zstd (level 1)
+                          ZSTD=103,      // zstd default compression level (level 3)
+                          ZSTD_BEST=119  // high compression using zstd (level 19)
                        };
 
+/** Prefilter applied to the data before compression (and after decompression).
+
+    Shuffling groups the bytes (BYTE_SHUFFLE) or bits (BIT_SHUFFLE) of equal
+    significance in consecutive array elements, like the Blosc meta-compressor.
+    This greatly improves the compression ratio of smooth numerical data,
+    e.g. 16-bit or floating point images.
+*/
+enum CompressionShuffle { NO_SHUFFLE=0,    // compress the data as they are
+                          BYTE_SHUFFLE=1,  // transpose the bytes of the array elements
+                          BIT_SHUFFLE=2    // transpose the bits of the array elements
+                        };
+
+/** Zstandard compression at the given level (1 ... 22).
+*/
+inline CompressionMethod zstdCompression(int level)
+{
+    vigra_precondition(level >= 1 && level <= 22,
+        "zstdCompression(): level must be in [1, 22].");
+    return CompressionMethod(ZSTD_FAST - 1 + level);
+}
+
+/** Check if a compression method refers to Zstandard.
+*/
+inline bool isZstdCompression(CompressionMethod method)
+{
+    return method >= ZSTD_FAST && method <= ZSTD_FAST + 21;
+}
+
 /** Compress the source buffer.
 
     The destination array will be resized as required.
@@ -60,6 +91,17 @@ enum CompressionMethod {  DEFAULT_COMPRESSION=-2,  // use default method (depend
 VIGRA_EXPORT void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method);
 VIGRA_EXPORT void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method);
 
+/** Compress the source buffer after shuffling.
+
+    If <tt>shuffle</tt> is not NO_SHUFFLE, the data are interpreted as an array
+    of elements of size <tt>elementSize</tt> and shuffled before compression.
+    The destination array will be resized as required.
+*/
+VIGRA_EXPORT void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method,
+                           CompressionShuffle shuffle, std::size_t elementSize);
+VIGRA_EXPORT void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method,
+                           CompressionShuffle shuffle, std::size_t elementSize);
+
 /** Uncompress the source buffer when the uncompressed size is known.
 
     The destination buffer must be allocated to the correct size.
@@ -67,6 +109,50 @@ VIGRA_EXPORT void compress(char const * source, std::size_t size, std::vector<ch
 VIGRA_EXPORT void uncompress(char const * source, std::size_t srcSize, 
                              char * dest, std::size_t destSize, CompressionMethod method);
 
+/** Uncompress a buffer that was shuffled before compression.
+
+    <tt>shuffle</tt> and <tt>elementSize</tt> must be the same as in the
+    corresponding call to compress(). The destination buffer must be
+    allocated to the correct size.
+*/
+VIGRA_EXPORT void uncompress(char const * source, std::size_t srcSize, 
+                             char * dest, std::size_t destSize, CompressionMethod method,
+                             CompressionShuffle shuffle, std::size_t elementSize);
+
+class ParallelOptions;
+
+/** Compress the source buffer in independent frames, using multiple threads.
+
+    The source is split into frames of (approximately) <tt>frameSize</tt> bytes,
+    which are compressed concurrently according to <tt>options</tt> (see
+    \ref ParallelOptions). The result starts with a header that records the
+    compression method, shuffle mode, element size, and the size of every frame,
+    so that uncompressFramed() needs no additional information and can again
+    work on all frames in parallel. The destination array will be resized as required.
+*/
+VIGRA_EXPORT void compressFramed(char const * source, std::size_t size, ArrayVector<char> & dest,
+                                 CompressionMethod method, ParallelOptions const & options,
+                                 std::size_t frameSize = 1 << 20,
+                                 CompressionShuffle shuffle = NO_SHUFFLE, std::size_t elementSize = 1);
+VIGRA_EXPORT void compressFramed(char const * source, std::size_t size, std::vector<char> & dest,
+                                 CompressionMethod method, ParallelOptions const & options,
+                                 std::size_t frameSize = 1 << 20,
+                                 CompressionShuffle shuffle = NO_SHUFFLE, std::size_t elementSize = 1);
+
+/** Determine the uncompressed size of a buffer created by compressFramed().
+
+    Throws a PreconditionViolation if the buffer doesn't start with a valid frame header.
+*/
+VIGRA_EXPORT std::size_t framedUncompressedSize(char const * source, std::size_t srcSize);
+
+/** Uncompress a buffer created by compressFramed(), using multiple threads.
+
+    The destination buffer must be allocated to the size returned by
+    framedUncompressedSize().
+*/
+VIGRA_EXPORT void uncompressFramed(char const * source, std::size_t srcSize,
+                                   char * dest, std::size_t destSize,
+                                   ParallelOptions const & options);
 
 } // namespace vigra
 
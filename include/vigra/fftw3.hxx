@@ -1826,7 +1826,9 @@ fourierTransformImpl(FFTWComplexImage::const_traverser sul,
     The Fourier transform functions internally create <a href="http://www.fftw.org/doc/Using-Plans.html">FFTW plans</a>
     which control the algorithm details. The plans are creates with the flag <tt>FFTW_ESTIMATE</tt>, i.e.
     optimal settings are guessed or read from saved "wisdom" files. If you need more control over planning,
-    you can use the class \ref FFTWPlan.
+    you can use the class \ref FFTWPlan. The optional argument <tt>options</tt> of the MultiArrayView
+    versions determines the number of threads (default: single-threaded, see
+    \ref FFTWPlan::FFTWPlan(ParallelOptions const &) for details).
     
     <b> Declarations:</b>
 
@@ -1836,12 +1838,14 @@ fourierTransformImpl(FFTWComplexImage::const_traverser sul,
         template <unsigned int N, class Real, class C1, class C2>
         void 
         fourierTransform(MultiArrayView<N, FFTWComplex<Real>, C1> in, 
-                         MultiArrayView<N, FFTWComplex<Real>, C2> out);
+                         MultiArrayView<N, FFTWComplex<Real>, C2> out,
+                         ParallelOptions const & options = ParallelOptions().numThreads(1));
 
         template <unsigned int N, class Real, class C1, class C2>
         void 
         fourierTransformInverse(MultiArrayView<N, FFTWComplex<Real>, C1> in, 
-                                MultiArrayView<N, FFTWComplex<Real>, C2> out);
+                                MultiArrayView<N, FFTWComplex<Real>, C2> out,
+                                ParallelOptions const & options = ParallelOptions().numThreads(1));
     }
     \endcode
 
@@ -1853,12 +1857,14 @@ fourierTransformImpl(FFTWComplexImage::const_traverser sul,
         template <unsigned int N, class Real, class C1, class C2>
         void 
         fourierTransform(MultiArrayView<N, Real, C1> in, 
-                         MultiArrayView<N, FFTWComplex<Real>, C2> out);
+                         MultiArrayView<N, FFTWComplex<Real>, C2> out,
+                         ParallelOptions const & options = ParallelOptions().numThreads(1));
 
         template <unsigned int N, class Real, class C1, class C2>
         void 
         fourierTransformInverse(MultiArrayView<N, FFTWComplex<Real>, C1> in, 
-                                MultiArrayView<N, Real, C2> out);
+                                MultiArrayView<N, Real, C2> out,
+                                ParallelOptions const & options = ParallelOptions().numThreads(1));
     }
     \endcode
 
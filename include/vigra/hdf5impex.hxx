@@ -80,6 +80,7 @@
 #include "multi_impex.hxx"
 #include "utilities.hxx"
 #include "error.hxx"
+#include "compression.hxx"
 
 #if defined(_MSC_VER)
 #  include <io.h>
@@ -2190,6 +2191,10 @@ class HDF5File
             where 0 stands for no compression and 9 for maximum compression. If
             a non-zero compression level is specified, but the chunk size is zero,
             a default chunk size will be chosen (compression always requires chunks).
+            Zstandard compression is selected by passing ZSTD_FAST, ZSTD, ZSTD_BEST,
+            or zstdCompression(level) as compression parameter (this requires
+            the HDF5 zstd filter plugin). If <tt>shuffle</tt> is not NO_SHUFFLE,
+            HDF5's byte shuffle filter is applied before compression.
 
             If the first character of datasetName is a "/", the path will be interpreted as absolute path,
             otherwise it will be interpreted as path relative to the current group.
@@ -2210,7 +2215,8 @@ class HDF5File
 #else
                   TinyVector<MultiArrayIndex, N> const & chunkSize = (TinyVector<MultiArrayIndex, N>()),
 #endif
-                  int compressionParameter = 0);
+                  int compressionParameter = 0,
+                  CompressionShuffle shuffle = NO_SHUFFLE);
 
         // for backwards compatibility
     template<int N, class T>
@@ -2297,6 +2303,30 @@ class HDF5File
         }
     }
 
+        // Activate the compression filters of a dataset. 'compression' is either
+        // a zlib level (1 ... 9) or a zstd CompressionMethod. Zstandard is HDF5's
+        // registered filter 32015 and must be provided as a plugin at runtime.
+        // Other values (e.g. LZ4) are not supported by HDF5 and leave the dataset
+        // uncompressed, as H5Pset_deflate() used to reject them.
+    void setCompressionFilters(hid_t plist, int compression, CompressionShuffle shuffle = NO_SHUFFLE)
+    {
+        if(compression <= 0)
+            return;
+        if(shuffle != NO_SHUFFLE)
+            H5Pset_shuffle(plist); // HDF5 only supports byte shuffling natively
+        if(isZstdCompression(CompressionMethod(compression)))
+        {
+            static const H5Z_filter_t zstd_filter = 32015;
+            unsigned int level = compression - ZSTD_FAST + 1;
+            vigra_postcondition(H5Pset_filter(plist, zstd_filter, H5Z_FLAG_MANDATORY, 1, &level) >= 0,
+                "HDF5File: unable to activate zstd compression.");
+        }
+        else if(compression <= 9)
+        {
+            H5Pset_deflate(plist, compression);
+        }
+    }
+
   public:
 
         /** \brief takes any path and converts it into an absolute path
@@ -2762,7 +2792,8 @@ HDF5File::createDataset(std::string datasetName,
                         TinyVector<MultiArrayIndex, N> const & shape,
                         typename detail::HDF5TypeTraits<T>::value_type init,
                          TinyVector<MultiArrayIndex, N> const & chunkSize,
-                         int compressionParameter)
+                         int compressionParameter,
+                         CompressionShuffle shuffle)
 {
     vigra_precondition(!isReadOnly(),
         "HDF5File::createDataset(): file is read-only.");
@@ -2815,10 +2846,7 @@ HDF5File::createDataset(std::string datasetName,
     }
 
     // enable compression
-    if(compressionParameter > 0)
-    {
-        H5Pset_deflate(plist, compressionParameter);
-    }
+    setCompressionFilters(plist, compressionParameter, shuffle);
 
     //create the dataset.
     HDF5HandleShared datasetHandle(H5Dcreate(parent, setname.c_str(),
@@ -2881,10 +2909,7 @@ void HDF5File::write_(std::string &datasetName,
     }
 
     // enable compression
-    if(compressionParameter > 0)
-    {
-        H5Pset_deflate(plist, compressionParameter);
-    }
+    setCompressionFilters(plist, compressionParameter);
 
     // create dataset
     HDF5Handle datasetHandle(H5Dcreate(groupHandle, setname.c_str(), datatype, dataspace,H5P_DEFAULT, plist, H5P_DEFAULT),
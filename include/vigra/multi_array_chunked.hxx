@@ -130,7 +130,9 @@
 #define VIGRA_MULTI_ARRAY_CHUNKED_HXX
 
 #include <queue>
+#include <deque>
 #include <string>
+#include <exception>
 
 #include "multi_fwd.hxx"
 #include "multi_handle.hxx"
@@ -138,6 +140,7 @@
 #include "memory.hxx"
 #include "metaprogramming.hxx"
 #include "threading.hxx"
+#include "threadpool.hxx"
 #include "compression.hxx"
 
 #ifdef _WIN32
@@ -232,6 +235,95 @@ class IteratorChunkHandle;
 
 namespace detail {
 
+// Completion state of a group of prefetch tasks started by
+// ChunkedArray::prefetchAsync(). The last task to finish fulfills
+// the promise (with the first exception that occurred, if any).
+class ChunkPrefetchGroup
+{
+  public:
+    explicit ChunkPrefetchGroup(std::ptrdiff_t count)
+    : remaining_(count)
+    , failed_(0)
+    {
+        if(count == 0)
+            done_.set_value();
+    }
+
+    template <class F>
+    void run(F && f)
+    {
+        try
+        {
+            f();
+        }
+        catch(...)
+        {
+            if(failed_.fetch_add(1) == 0)
+                error_ = std::current_exception();
+        }
+        if(remaining_.fetch_sub(1) == 1)
+        {
+            if(error_)
+                done_.set_exception(error_);
+            else
+                done_.set_value();
+        }
+    }
+
+    threading::future<void> getFuture()
+    {
+        return done_.get_future();
+    }
+
+  private:
+    threading::atomic_long remaining_, failed_;
+    std::exception_ptr error_;
+    threading::promise<void> done_;
+};
+
+// Pending prefetch tasks of a ChunkIterator (shared between copies of
+// the iterator). Since copies may be used by different threads, e.g. via
+// operator[] inside parallel_foreach(), all accesses except destruction
+// must hold mutex_. The destructor waits until all tasks are finished,
+// so that they never outlive the iterator and its array.
+class ChunkPrefetchQueue
+{
+  public:
+    ChunkPrefetchQueue(ThreadPool & pool, int distance)
+    : pool_(pool)
+    , distance_(distance)
+    , prefetched_until_(-1)
+    {}
+
+    ~ChunkPrefetchQueue()
+    {
+        for(std::size_t k=0; k<futures_.size(); ++k)
+            pool_.waitFor(futures_[k]);
+        // errors are ignored here, they will show up again
+        // when the iterator actually accesses the chunk
+    }
+
+    template <class F>
+    void push(F && f)
+    {
+        // forget about tasks that are already finished
+        while(futures_.size() > 0 &&
+              futures_.front().wait_for(threading::chrono::seconds(0)) == threading::future_status::ready)
+            futures_.pop_front();
+        futures_.push_back(pool_.enqueue(std::forward<F>(f)));
+    }
+
+    ThreadPool & pool_;
+    int distance_;
+    MultiArrayIndex prefetched_until_;
+    std::deque<threading::future<void> > futures_;
+    threading::mutex mutex_;
+};
+
+} // namespace detail
+
+namespace detail {
+
 template <unsigned int N>
 struct ChunkIndexing
 {
@@ -418,6 +510,11 @@ class ChunkedArrayBase
 
     virtual shape_type chunkArrayShape() const = 0;
 
+    // Load the given chunk into the cache if it is currently asleep.
+    // The default implementation does nothing.
+    virtual void prefetchChunk(shape_type const &) const
+    {}
+
     virtual bool isReadOnly() const
     {
         return false;
@@ -1273,6 +1370,7 @@ class ChunkedArrayOptions
     : fill_value(0.0)
     , cache_max(-1)
     , compression_method(DEFAULT_COMPRESSION)
+    , compression_shuffle(NO_SHUFFLE)
     {}
 
     /** \brief Element value for read-only access of uninitialized chunks.
@@ -1320,9 +1418,25 @@ class ChunkedArrayOptions
         return ChunkedArrayOptions(*this).compression(v);
     }
 
+    /** \brief Shuffle the bytes or bits of the array elements before compression.
+
+        Default: NO_SHUFFLE
+    */
+    ChunkedArrayOptions & shuffle(CompressionShuffle v)
+    {
+        compression_shuffle = v;
+        return *this;
+    }
+
+    ChunkedArrayOptions shuffle(CompressionShuffle v) const
+    {
+        return ChunkedArrayOptions(*this).shuffle(v);
+    }
+
     double fill_value;
     int cache_max;
     CompressionMethod compression_method;
+    CompressionShuffle compression_shuffle;
 };
 
 /** \weakgroup ParallelProcessing
@@ -1615,6 +1729,25 @@ class ChunkedArray
     typedef MultiArrayView<N, T const, ChunkedArrayTag>             const_view_type;
     typedef std::queue<Handle*> CacheType;
 
+    // The cache is split into several stripes with separate locks, so that
+    // threads working on different chunks rarely contend for a lock. Each
+    // stripe is managed in FIFO order, so the global LRU order is kept
+    // approximately.
+    struct CacheStripe
+    {
+        threading::mutex lock_;
+        CacheType queue_;
+    };
+
+    // maximal number of stripes, and minimal number of chunks per stripe
+    static const int max_cache_stripes = 16;
+    static const int min_chunks_per_stripe = 8;
+
+    struct ChunkCache
+    {
+        CacheStripe stripes_[max_cache_stripes];
+    };
+
     static const long chunk_asleep = Handle::chunk_asleep;
     static const long chunk_uninitialized = Handle::chunk_uninitialized;
     static const long chunk_locked = Handle::chunk_locked;
@@ -1629,11 +1762,36 @@ class ChunkedArray
     , mask_(this->chunk_shape_ -shape_type(1))
     , cache_max_size_(options.cache_max)
     , chunk_lock_(new threading::mutex())
+    , cache_(new ChunkCache())
     , fill_value_(T(options.fill_value))
     , fill_scalar_(options.fill_value)
     , handle_array_(detail::computeChunkArrayShape(shape, bits_, mask_))
-    , data_bytes_()
+    , data_bytes_(0)
     , overhead_bytes_(handle_array_.size()*sizeof(Handle))
+    {
+        // determine the default once, so that cacheMaxSize() never writes
+        // (it is called without locks by the cache stripes)
+        if(cache_max_size_ < 0)
+            cache_max_size_ = detail::defaultCacheSize(handle_array_.shape());
+        fill_value_chunk_.pointer_ = &fill_value_;
+        fill_value_handle_.pointer_ = &fill_value_chunk_;
+        fill_value_handle_.chunk_state_.store(1);
+    }
+
+    // The copy shares the backend lock with 'rhs', but gets its own (empty) cache,
+    // because the cache refers to the handles of 'rhs'.
+    ChunkedArray(ChunkedArray const & rhs)
+    : ChunkedArrayBase<N, T>(rhs)
+    , bits_(rhs.bits_)
+    , mask_(rhs.mask_)
+    , cache_max_size_(rhs.cache_max_size_)
+    , chunk_lock_(rhs.chunk_lock_)
+    , cache_(new ChunkCache())
+    , fill_value_(rhs.fill_value_)
+    , fill_scalar_(rhs.fill_scalar_)
+    , handle_array_(rhs.handle_array_)
+    , data_bytes_(rhs.data_bytes_.load())
+    , overhead_bytes_(rhs.overhead_bytes_.load())
     {
         fill_value_chunk_.pointer_ = &fill_value_;
         fill_value_handle_.pointer_ = &fill_value_chunk_;
@@ -1663,7 +1821,13 @@ class ChunkedArray
     */
     int cacheSize() const
     {
-        return cache_.size();
+        std::size_t res = 0;
+        for(int k=0; k<max_cache_stripes; ++k)
+        {
+            threading::lock_guard<threading::mutex> guard(cache_->stripes_[k].lock_);
+            res += cache_->stripes_[k].queue_.size();
+        }
+        return res;
     }
 
     /** \brief Bytes of main memory occupied by the array's data.
@@ -1850,10 +2014,7 @@ class ChunkedArray
             unrefChunk(chunks[k]);
 
         if(cacheMaxSize() > 0)
-        {
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
-            cleanCache(cache_.size());
-        }
+            cleanCache();
     }
 
     // Increase the reference counter of the given chunk.
@@ -1906,7 +2067,9 @@ class ChunkedArray
         if(rc >= 0)
             return handle->pointer_->pointer_;
 
-        threading::lock_guard<threading::mutex> guard(*chunk_lock_);
+        // The chunk is now in state 'chunk_locked', i.e. we have exclusive access to it.
+        // Thus, no global lock is needed, and other threads can load different
+        // chunks (i.e. perform I/O and decompression) concurrently.
         try
         {
             T * p = self->loadChunk(&handle->pointer_, chunk_index);
@@ -1916,16 +2079,21 @@ class ChunkedArray
 
             self->data_bytes_ += dataBytes(chunk);
 
+            // publish the chunk before it enters the cache, so that the
+            // cache management sees a positive refcount and keeps it
+            handle->chunk_state_.store(1, threading::memory_order_release);
+
             if(cacheMaxSize() > 0 && insertInCache)
             {
-                // insert in queue of mapped chunks
-                self->cache_.push(handle);
-
-                // do cache management if cache is full
-                // (note that we still hold the chunk_lock_)
-                self->cleanCache(2);
+                CacheStripe & stripe = self->cacheStripe(handle);
+                {
+                    // insert in queue of mapped chunks
+                    threading::lock_guard<threading::mutex> guard(stripe.lock_);
+                    stripe.queue_.push(handle);
+                }
+                // do cache management if the stripe is full
+                self->cleanCacheStripe(stripe, 2);
             }
-            handle->chunk_state_.store(1, threading::memory_order_release);
             return p;
         }
         catch(...)
@@ -1989,8 +2157,9 @@ class ChunkedArray
         return chunkForIteratorImpl(point, strides, upper_bound, h, true);
     }
 
-    // NOTE: This function must only be called while we hold the chunk_lock_.
-    //       This implies refcount != chunk_locked, so that race conditions are avoided.
+    // Send a chunk asleep (or destroy it) if its refcount is zero.
+    // The refcount is atomically switched to 'chunk_locked' before unloading,
+    // so that concurrent accesses to the chunk wait until we are done.
     long releaseChunk(Handle * handle, bool destroy = false)
     {
         long rc = 0;
@@ -2003,41 +2172,94 @@ class ChunkedArray
         if(mayUnload)
         {
             // refcount was zero or chunk_asleep => can unload
-            try
-            {
-                vigra_invariant(handle != &fill_value_handle_,
-                   "ChunkedArray::releaseChunk(): attempt to release fill_value_handle_.");
-                Chunk * chunk = handle->pointer_;
-                this->data_bytes_ -= dataBytes(chunk);
-                int didDestroy = unloadChunk(chunk, destroy);
-                this->data_bytes_ += dataBytes(chunk);
-                if(didDestroy)
-                    handle->chunk_state_.store(chunk_uninitialized);
-                else
-                    handle->chunk_state_.store(chunk_asleep);
-            }
-            catch(...)
-            {
-                handle->chunk_state_.store(chunk_failed);
-                throw;
-            }
+            unloadLockedHandle(handle, destroy);
         }
         return rc;
     }
 
-    // NOTE: this function must only be called while we hold the chunk_lock_
-    void cleanCache(int how_many = -1)
+    // Unload a chunk that is in state 'chunk_locked'.
+    void unloadLockedHandle(Handle * handle, bool destroy = false)
+    {
+        try
+        {
+            vigra_invariant(handle != &fill_value_handle_,
+               "ChunkedArray::releaseChunk(): attempt to release fill_value_handle_.");
+            Chunk * chunk = handle->pointer_;
+            this->data_bytes_ -= dataBytes(chunk);
+            int didDestroy = unloadChunk(chunk, destroy);
+            this->data_bytes_ += dataBytes(chunk);
+            if(didDestroy)
+                handle->chunk_state_.store(chunk_uninitialized);
+            else
+                handle->chunk_state_.store(chunk_asleep);
+        }
+        catch(...)
+        {
+            handle->chunk_state_.store(chunk_failed);
+            throw;
+        }
+    }
+
+    // number of stripes currently in use (depends on the cache size)
+    int cacheStripeCount() const
+    {
+        std::size_t max_size = cacheMaxSize();
+        int count = 1;
+        while(count < max_cache_stripes &&
+              std::size_t(2*count*min_chunks_per_stripe) <= max_size)
+            count *= 2;
+        return count;
+    }
+
+    // stripe responsible for the given handle (neighboring chunks go to different stripes)
+    CacheStripe & cacheStripe(Handle * handle)
+    {
+        return cache_->stripes_[(handle - handle_array_.data()) % cacheStripeCount()];
+    }
+
+    // number of chunks the given stripe may hold
+    std::size_t cacheStripeMaxSize(CacheStripe const & stripe) const
+    {
+        std::size_t index = &stripe - cache_->stripes_,
+                    count = cacheStripeCount(),
+                    max_size = cacheMaxSize();
+        if(index >= count)
+            return 0;  // stripe is unused since the cache was shrunk
+        return max_size / count + (index < max_size % count ? 1 : 0);
+    }
+
+    // Evict up to 'how_many' unused chunks from a stripe until it fits into
+    // its share of the cache. The stripe is only locked while the candidates
+    // are selected. The actual unloading (e.g. compression or writing to disk)
+    // happens outside the lock.
+    void cleanCacheStripe(CacheStripe & stripe, int how_many = -1)
     {
-        if(how_many == -1)
-            how_many = cache_.size();
-        for(; cache_.size() > cacheMaxSize() && how_many > 0; --how_many)
+        ArrayVector<Handle*> evicted;
         {
-            Handle * handle = cache_.front();
-            cache_.pop();
-            long rc = releaseChunk(handle);
-            if(rc > 0) // refcount was positive => chunk is still needed
-                cache_.push(handle);
+            threading::lock_guard<threading::mutex> guard(stripe.lock_);
+            std::size_t max_size = cacheStripeMaxSize(stripe);
+            if(how_many == -1)
+                how_many = stripe.queue_.size();
+            for(; stripe.queue_.size() > max_size && how_many > 0; --how_many)
+            {
+                Handle * handle = stripe.queue_.front();
+                stripe.queue_.pop();
+                long rc = 0;
+                if(handle->chunk_state_.compare_exchange_strong(rc, chunk_locked))
+                    evicted.push_back(handle);
+                else if(rc > 0) // refcount was positive => chunk is still needed
+                    stripe.queue_.push(handle);
+            }
         }
+        for(unsigned int k=0; k<evicted.size(); ++k)
+            unloadLockedHandle(evicted[k]);
+    }
+
+    // Clean all stripes of the cache.
+    void cleanCache()
+    {
+        for(int k=0; k<max_cache_stripes; ++k)
+            cleanCacheStripe(cache_->stripes_[k]);
     }
 
     /** Sends all chunks asleep which are completely inside the given ROI.
@@ -2065,22 +2287,103 @@ class ChunkedArray
             }
 
             Handle * handle = this->lookupHandle(*i);
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
             releaseChunk(handle, destroy);
         }
 
         // remove all chunks from the cache that are asleep or unitialized
-        threading::lock_guard<threading::mutex> guard(*chunk_lock_);
-        int cache_size = cache_.size();
-        for(int k=0; k < cache_size; ++k)
+        for(int s=0; s<max_cache_stripes; ++s)
         {
-            Handle * handle = cache_.front();
-            cache_.pop();
-            if(handle->chunk_state_.load() >= 0)
-                cache_.push(handle);
+            CacheStripe & stripe = cache_->stripes_[s];
+            threading::lock_guard<threading::mutex> guard(stripe.lock_);
+            int cache_size = stripe.queue_.size();
+            for(int k=0; k < cache_size; ++k)
+            {
+                Handle * handle = stripe.queue_.front();
+                stripe.queue_.pop();
+                if(handle->chunk_state_.load() >= 0)
+                    stripe.queue_.push(handle);
+            }
         }
     }
 
+    /** \brief Load all chunks intersected by the given ROI into the cache.
+
+        Chunks that are asleep (e.g. compressed or swapped out to disk) are
+        reactivated, so that subsequent accesses don't have to wait for I/O or
+        decompression. Chunks that were never written are skipped, since they
+        only contain the fill value. Since prefetched chunks are subject to
+        the usual cache management, the ROI should not contain more chunks
+        than the cache can hold (see \ref setCacheMaxSize()).
+    */
+    void prefetch(shape_type const & start, shape_type const & stop) const
+    {
+        checkSubarrayBounds(start, stop, "ChunkedArray::prefetch()");
+
+        shape_type chunk_start(chunkStart(start));
+        MultiCoordinateIterator<N> i(chunk_start, chunkStop(stop)),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+            prefetchChunk(chunk_start + *i);
+    }
+
+    /** \brief Load all chunks intersected by the given ROI into the cache
+        in the background.
+
+        Like \ref prefetch(), but the chunks are loaded concurrently by the
+        threads of the given <tt>pool</tt>, and the function returns
+        immediately. The returned future becomes ready when all chunks have
+        been loaded (and rethrows the first error, if any). The array must
+        stay alive until then.
+
+        <b> Usage:</b>
+
+        \code
+        ChunkedArrayCompressed<3, float> array(...);
+        ThreadPool pool(ParallelOptions().numThreads(4));
+
+        // start loading the next slab while processing the current one
+        auto loading = array.prefetchAsync(pool, next_start, next_stop);
+        process(array, current_start, current_stop);
+        loading.get();
+        \endcode
+    */
+    threading::future<void>
+    prefetchAsync(ThreadPool & pool, shape_type const & start, shape_type const & stop) const
+    {
+        checkSubarrayBounds(start, stop, "ChunkedArray::prefetchAsync()");
+
+        shape_type chunk_start(chunkStart(start)), chunk_stop(chunkStop(stop));
+        VIGRA_SHARED_PTR<detail::ChunkPrefetchGroup>
+            group(new detail::ChunkPrefetchGroup(prod(chunk_stop - chunk_start)));
+        threading::future<void> res = group->getFuture();
+
+        MultiCoordinateIterator<N> i(chunk_start, chunk_stop),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            shape_type chunk_index = chunk_start + *i;
+            pool.enqueue(
+                [this, group, chunk_index](int)
+                {
+                    group->run([&]() { this->prefetchChunk(chunk_index); });
+                });
+        }
+        return res;
+    }
+
+    virtual void prefetchChunk(shape_type const & chunk_index) const
+    {
+        ChunkedArray * self = const_cast<ChunkedArray *>(this);
+        Handle * handle = self->lookupHandle(chunk_index);
+        // Only chunks that are asleep need to be loaded. Active chunks are
+        // already in memory, uninitialized ones only contain the fill value,
+        // and locked ones are currently being loaded by another thread.
+        if(handle->chunk_state_.load(threading::memory_order_acquire) != chunk_asleep)
+            return;
+        getChunk(handle, true, true, chunk_index);
+        unrefChunk(handle);
+    }
+
     /** \brief Copy an ROI of the chunked array into an ordinary MultiArrayView.
 
         The ROI's lower bound is given by 'start', its upper bound (in 'beyond' sense)
@@ -2159,8 +2462,6 @@ class ChunkedArray
             if(isConst && handle->chunk_state_.load() == chunk_uninitialized)
                 handle = &self->fill_value_handle_;
 
-            // This potentially acquires the chunk_lock_ in each iteration.
-            // Would it be better to acquire it once before the loop?
             pointer p = getChunk(handle, isConst, true, *i);
 
             ChunkBase<N, T> * mini_chunk = &view.chunks_[*i - chunk_start];
@@ -2356,8 +2657,6 @@ class ChunkedArray
     */
     std::size_t cacheMaxSize() const
     {
-        if(cache_max_size_ < 0)
-            const_cast<int &>(cache_max_size_) = detail::defaultCacheSize(this->chunkArrayShape());
         return cache_max_size_;
     }
 
@@ -2369,11 +2668,8 @@ class ChunkedArray
     void setCacheMaxSize(std::size_t c)
     {
         cache_max_size_ = c;
-        if(c < cache_.size())
-        {
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
+        if((int)c < cacheSize())
             cleanCache();
-        }
     }
 
     /** \brief Create a scan-order iterator for the entire chunked array.
@@ -2475,14 +2771,15 @@ class ChunkedArray
 
     shape_type bits_, mask_;
     int cache_max_size_;
+    // serializes backend operations that are not thread-safe (e.g. HDF5 I/O)
     VIGRA_SHARED_PTR<threading::mutex> chunk_lock_;
-    CacheType cache_;
+    VIGRA_SHARED_PTR<ChunkCache> cache_;
     Chunk fill_value_chunk_;
     Handle fill_value_handle_;
     value_type fill_value_;
     double fill_scalar_;
     MultiArray<N, Handle> handle_array_;
-    std::size_t data_bytes_, overhead_bytes_;
+    threading::atomic<std::size_t> data_bytes_, overhead_bytes_;
 };
 
 /** Returns a CoupledScanOrderIterator to simultaneously iterate over image m1 and its coordinates.
@@ -2855,14 +3152,15 @@ class ChunkedArrayCompressed
             compressed_.clear();
         }
 
-        void compress(CompressionMethod method)
+        void compress(CompressionMethod method, CompressionShuffle shuffle)
         {
             if(this->pointer_ != 0)
             {
                 vigra_invariant(compressed_.size() == 0,
                     "ChunkedArrayCompressed::Chunk::compress(): compressed and uncompressed pointer are both non-zero.");
 
-                ::vigra::compress((char const *)this->pointer_, size_*sizeof(T), compressed_, method);
+                ::vigra::compress((char const *)this->pointer_, size_*sizeof(T), compressed_, method,
+                                  shuffle, sizeof(typename ExpandElementResult<T>::type));
 
                 // std::cerr << "compression ratio: " << double(compressed_.size())/(this->size()*sizeof(T)) << "\n";
                 detail::destroy_dealloc_n(this->pointer_, size_, alloc_);
@@ -2870,7 +3168,7 @@ class ChunkedArrayCompressed
             }
         }
 
-        pointer uncompress(CompressionMethod method)
+        pointer uncompress(CompressionMethod method, CompressionShuffle shuffle)
         {
             if(this->pointer_ == 0)
             {
@@ -2879,7 +3177,8 @@ class ChunkedArrayCompressed
                     this->pointer_ = alloc_.allocate((typename Alloc::size_type)size_);
 
                     ::vigra::uncompress(compressed_.data(), compressed_.size(),
-                                        (char*)this->pointer_, size_*sizeof(T), method);
+                                        (char*)this->pointer_, size_*sizeof(T), method,
+                                        shuffle, sizeof(typename ExpandElementResult<T>::type));
                     compressed_.clear();
                 }
                 else
@@ -2918,14 +3217,22 @@ class ChunkedArrayCompressed
         <li>ZLIB_FAST: Fast compression using 'zlib' (slower than LZ4, but higher compression).
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
+        <li>ZSTD_FAST, ZSTD, ZSTD_BEST, zstdCompression(level): Zstandard at the
+            given level (better compression than LZ4 at similar decompression speed,
+            requires VIGRA to be compiled with zstd support).
         <li>DEFAULT_COMPRESSION: Same as LZ4.
         </ul>
+        In addition, <tt>options.shuffle(BYTE_SHUFFLE)</tt> or
+        <tt>options.shuffle(BIT_SHUFFLE)</tt> shuffle the element bytes
+        or bits before compression, which usually improves the compression
+        ratio of multi-byte types considerably.
     */
     explicit ChunkedArrayCompressed(shape_type const & shape,
                                     shape_type const & chunk_shape=shape_type(),
                                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
     : ChunkedArray<N, T>(shape, chunk_shape, options),
-       compression_method_(options.compression_method)
+       compression_method_(options.compression_method),
+       compression_shuffle_(options.compression_shuffle)
     {
         if(compression_method_ == DEFAULT_COMPRESSION)
             compression_method_ = LZ4;
@@ -2950,7 +3257,7 @@ class ChunkedArrayCompressed
             *p = new Chunk(this->chunkShape(index));
             this->overhead_bytes_ += sizeof(Chunk);
         }
-        return static_cast<Chunk *>(*p)->uncompress(compression_method_);
+        return static_cast<Chunk *>(*p)->uncompress(compression_method_, compression_shuffle_);
     }
 
     virtual bool unloadChunk(ChunkBase<N, T> * chunk, bool destroy)
@@ -2958,7 +3265,7 @@ class ChunkedArrayCompressed
         if(destroy)
             static_cast<Chunk *>(chunk)->deallocate();
         else
-            static_cast<Chunk *>(chunk)->compress(compression_method_);
+            static_cast<Chunk *>(chunk)->compress(compression_method_, compression_shuffle_);
         return destroy;
     }
 
@@ -2976,7 +3283,15 @@ class ChunkedArrayCompressed
             return "ChunkedArrayCompressed<ZLIB_BEST>";
           case LZ4:
             return "ChunkedArrayCompressed<LZ4>";
+          case ZSTD_FAST:
+            return "ChunkedArrayCompressed<ZSTD_FAST>";
+          case ZSTD:
+            return "ChunkedArrayCompressed<ZSTD>";
+          case ZSTD_BEST:
+            return "ChunkedArrayCompressed<ZSTD_BEST>";
           default:
+            if(isZstdCompression(compression_method_))
+                return "ChunkedArrayCompressed<ZSTD>";
             return "unknown";
         }
     }
@@ -2994,6 +3309,7 @@ class ChunkedArrayCompressed
     }
 
     CompressionMethod compression_method_;
+    CompressionShuffle compression_shuffle_;
 };
 
 /** \weakgroup ParallelProcessing
@@ -3210,6 +3526,8 @@ class ChunkedArrayTmpFile
             shape_type shape = this->chunkShape(index);
             std::size_t chunk_size = computeAllocSize(shape);
         #ifdef VIGRA_NO_SPARSE_FILE
+            // chunks are loaded concurrently, but the file must grow sequentially
+            threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
             std::size_t offset = file_size_;
             if(offset + chunk_size > file_capacity_)
             {
@@ -3263,6 +3581,268 @@ class ChunkedArrayTmpFile
     std::size_t file_size_, file_capacity_;
 };
 
+/** \weakgroup ParallelProcessing
+    \sa ChunkedArrayMmap
+*/
+
+/** Implement a read-only ChunkedArray on top of an existing file by
+    mapping the file into memory.
+
+    <b>\#include</b> \<vigra/multi_array_chunked.hxx\> <br/>
+    Namespace: vigra
+
+    The file must contain the raw array data in native byte order,
+    optionally preceded by a header of <tt>header_bytes</tt> bytes. Two layouts
+    are supported:
+
+    <ul>
+    <li> <tt>ChunkedArrayMmap::RawVolume</tt>: The data are stored as a single
+         contiguous array in scan order (i.e. the first coordinate varies
+         fastest), as written by <tt>fwrite(array.data(), ...)</tt>.
+         Chunks are views onto this array with the strides of the entire volume.
+    <li> <tt>ChunkedArrayMmap::ChunkedLayout</tt>: The chunks are stored one after
+         another in scan order of the chunk grid (like the raw chunks of an N5 or
+         zarr dataset concatenated into a single file), each chunk in scan order
+         of its own. Chunks at the upper array border are truncated to the
+         array shape.
+    </ul>
+
+    The entire file is mapped once upon construction, and chunks are returned
+    as pointers into the mapping. Thus, there is no decompression buffer
+    and no copy: Data are served directly from the operating system's page
+    cache, which is shared by all processes that map the same file.
+    Consequently, there is no need for a chunk cache, and the cache size is
+    always zero. The file is mapped read-only, so that the mapping does not
+    count against the system's commit charge. Consequently, the array must only
+    be accessed via const iterators and views: writing through a non-const
+    iterator terminates the program with an access violation. Note that a 64-bit
+    address space is needed to map very large files.
+
+    <b> Usage:</b>
+
+    \code
+    // a 2048^3 volume of uint16 values written by another program
+    ChunkedArrayMmap<3, UInt16> volume("volume.raw", Shape3(2048));
+
+    // same data, stored chunk-by-chunk in 64^3 chunks after a 512 byte header
+    ChunkedArrayMmap<3, UInt16> chunked("volume.chunks", Shape3(2048), Shape3(64),
+                                        ChunkedArrayOptions(),
+                                        ChunkedArrayMmap<3, UInt16>::ChunkedLayout, 512);
+    \endcode
+*/
+template <unsigned int N, class T>
+class ChunkedArrayMmap
+: public ChunkedArray<N, T>
+{
+  public:
+    enum FileLayout { RawVolume, ChunkedLayout };
+
+    class Chunk
+    : public ChunkBase<N, T>
+    {
+      public:
+        typedef typename MultiArrayShape<N>::type  shape_type;
+        typedef T value_type;
+        typedef value_type * pointer;
+        typedef value_type & reference;
+
+        Chunk(shape_type const & shape, shape_type const & strides, pointer p)
+        : ChunkBase<N, T>(strides, p)
+        , size_(prod(shape))
+        {}
+
+        std::size_t size_;
+
+      private:
+        Chunk & operator=(Chunk const &);
+    };
+
+    typedef MultiArray<N, SharedChunkHandle<N, T>  > ChunkStorage;
+    typedef MultiArray<N, std::size_t>               OffsetStorage;
+    typedef typename ChunkStorage::difference_type   shape_type;
+    typedef T value_type;
+    typedef value_type * pointer;
+    typedef value_type & reference;
+
+    /** \brief Map the file 'filename' which contains an array of the given 'shape'.
+
+        'chunk_shape' determines the chunk size of the ChunkedArray interface
+        and, if 'layout' is <tt>ChunkedLayout</tt>, also the chunk size in the file.
+        'header_bytes' is the offset of the array data from the beginning of the file.
+        An exception is thrown if the file cannot be opened or is too small.
+    */
+    ChunkedArrayMmap(std::string const & filename,
+                     shape_type const & shape,
+                     shape_type const & chunk_shape=shape_type(),
+                     ChunkedArrayOptions const & options = ChunkedArrayOptions(),
+                     FileLayout layout = RawVolume,
+                     std::size_t header_bytes = 0)
+    : ChunkedArray<N, T>(shape, chunk_shape, options.cacheMax(0))
+    , layout_(layout)
+    , file_name_(filename)
+    , mapped_size_(0)
+    , data_(0)
+    , data_begin_(0)
+    {
+        vigra_precondition(header_bytes % alignof(T) == 0,
+            "ChunkedArrayMmap(): header_bytes must be a multiple of the alignment of the value_type.");
+        std::size_t size = header_bytes + prod(shape)*sizeof(T);
+
+        if(layout_ == ChunkedLayout)
+        {
+            // compute the offset of each chunk in the file
+            offset_array_.reshape(this->chunkArrayShape());
+            typename OffsetStorage::iterator i = offset_array_.begin(),
+                                             end = offset_array_.end();
+            std::size_t offset = header_bytes;
+            for(; i != end; ++i)
+            {
+                *i = offset;
+                offset += prod(this->chunkShape(i.point()))*sizeof(T);
+            }
+            this->overhead_bytes_ += offset_array_.size()*sizeof(std::size_t);
+        }
+
+    #ifdef _WIN32
+        HANDLE file = ::CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+            winErrorToException("ChunkedArrayMmap(): ");
+        LARGE_INTEGER file_size;
+        if(!::GetFileSizeEx(file, &file_size))
+        {
+            ::CloseHandle(file);
+            winErrorToException("ChunkedArrayMmap(): ");
+        }
+        mapped_size_ = (std::size_t)file_size.QuadPart;
+        if(mapped_size_ < size)
+            ::CloseHandle(file);
+        vigra_precondition(mapped_size_ >= size,
+            "ChunkedArrayMmap(): file '" + filename + "' is too small for the given shape.");
+        HANDLE mapping = ::CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        ::CloseHandle(file);
+        if(!mapping)
+            winErrorToException("ChunkedArrayMmap(): ");
+        data_ = (char *)::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        ::CloseHandle(mapping);  // the view keeps the mapping alive
+        if(data_ == 0)
+            winErrorToException("ChunkedArrayMmap(): ");
+    #else
+        int file = ::open(filename.c_str(), O_RDONLY);
+        if(file == -1)
+            throw std::runtime_error("ChunkedArrayMmap(): unable to open file '" + filename + "'.");
+        struct stat info;
+        if(::fstat(file, &info) == -1)
+        {
+            ::close(file);
+            throw std::runtime_error("ChunkedArrayMmap(): unable to determine size of file '" + filename + "'.");
+        }
+        mapped_size_ = (std::size_t)info.st_size;
+        if(mapped_size_ < size)
+            ::close(file);
+        vigra_precondition(mapped_size_ >= size,
+            "ChunkedArrayMmap(): file '" + filename + "' is too small for the given shape.");
+        void * data = mmap(0, mapped_size_, PROT_READ, MAP_SHARED, file, 0);
+        ::close(file);  // the mapping keeps the file alive
+        if(data == MAP_FAILED)
+            throw std::runtime_error("ChunkedArrayMmap(): mmap() failed.");
+        data_ = (char *)data;
+    #endif
+
+        if(layout_ == RawVolume)
+            data_begin_ = (pointer)(data_ + header_bytes);
+
+        // all chunks exist in the file
+        typename ChunkStorage::iterator i = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(; i != end; ++i)
+            i->chunk_state_.store(this->chunk_asleep);
+    }
+
+    ~ChunkedArrayMmap()
+    {
+        typename ChunkStorage::iterator  i = this->handle_array_.begin(),
+                                         end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            if(i->pointer_)
+                delete static_cast<Chunk*>(i->pointer_);
+            i->pointer_ = 0;
+        }
+    #ifdef _WIN32
+        ::UnmapViewOfFile(data_);
+    #else
+        munmap(data_, mapped_size_);
+    #endif
+    }
+
+    virtual pointer loadChunk(ChunkBase<N, T> ** p, shape_type const & index)
+    {
+        if(*p == 0)
+        {
+            shape_type shape = this->chunkShape(index);
+            if(layout_ == RawVolume)
+            {
+                shape_type strides = detail::defaultStride(this->shape());
+                *p = new Chunk(shape, strides,
+                               data_begin_ + dot(index*this->chunk_shape_, strides));
+            }
+            else
+            {
+                *p = new Chunk(shape, detail::defaultStride(shape),
+                               (pointer)(data_ + offset_array_[index]));
+            }
+            this->overhead_bytes_ += sizeof(Chunk);
+        }
+        return (*p)->pointer_;
+    }
+
+    virtual bool unloadChunk(ChunkBase<N, T> *, bool /* destroy */)
+    {
+        return false; // the data remain in the file mapping
+    }
+
+    virtual bool isReadOnly() const
+    {
+        return true;
+    }
+
+    virtual std::string backend() const
+    {
+        return "ChunkedArrayMmap<'" + file_name_ + "'>";
+    }
+
+    virtual std::size_t dataBytes(ChunkBase<N,T> * c) const
+    {
+        return static_cast<Chunk*>(c)->size_*sizeof(T);
+    }
+
+    virtual std::size_t overheadBytesPerChunk() const
+    {
+        return layout_ == RawVolume
+                  ? sizeof(Chunk) + sizeof(SharedChunkHandle<N, T>)
+                  : sizeof(Chunk) + sizeof(SharedChunkHandle<N, T>) + sizeof(std::size_t);
+    }
+
+    std::string fileName() const
+    {
+        return file_name_;
+    }
+
+    FileLayout layout() const
+    {
+        return layout_;
+    }
+
+  private:
+    FileLayout layout_;
+    std::string file_name_;
+    OffsetStorage offset_array_;  // chunk offsets in the file (ChunkedLayout only)
+    std::size_t mapped_size_;
+    char * data_;                 // start of the file mapping
+    pointer data_begin_;          // start of the array data (RawVolume only)
+};
+
 template<unsigned int N, class U>
 class ChunkIterator
 : public MultiCoordinateIterator<N>
@@ -3317,6 +3897,7 @@ class ChunkIterator
     , start_(rhs.start_)
     , stop_(rhs.stop_)
     , chunk_shape_(rhs.chunk_shape_)
+    , prefetch_(rhs.prefetch_)
     {
         getChunk();
     }
@@ -3331,6 +3912,7 @@ class ChunkIterator
             start_ = rhs.start_;
             stop_ = rhs.stop_;
             chunk_shape_ = rhs.chunk_shape_;
+            prefetch_ = rhs.prefetch_;
             getChunk();
         }
         return *this;
@@ -3374,6 +3956,57 @@ class ChunkIterator
                        upper_bound(SkipInitialization);
             this->m_ptr = array_->chunkForIterator(array_point, this->m_stride, upper_bound, &chunk_);
             this->m_shape = min(upper_bound, stop_) - array_point;
+            if(prefetch_)
+                prefetchChunks();
+        }
+    }
+
+    /** \brief Load upcoming chunks in the background.
+
+        Whenever the iterator moves, the next <tt>distance</tt> chunks
+        (in scan order) are loaded by the threads of the given <tt>pool</tt>,
+        so that I/O and decompression overlap with the processing of the
+        current chunk. Copies of the iterator share the pending tasks (the
+        shared queue is protected by a mutex, so that copies may be used
+        concurrently), and the last copy to be destroyed waits until they
+        are finished.
+        The pool must therefore outlive the iterator. <tt>distance</tt>
+        should be smaller than the array's cache size, so that prefetched
+        chunks are not evicted before they are used.
+    */
+    ChunkIterator & prefetch(ThreadPool & pool, int distance)
+    {
+        if(distance > 0)
+        {
+            prefetch_.reset(new detail::ChunkPrefetchQueue(pool, distance));
+            prefetchChunks();
+        }
+        else
+        {
+            prefetch_.reset();
+        }
+        return *this;
+    }
+
+    void prefetchChunks()
+    {
+        MultiArrayIndex current = base_type::scanOrderIndex(),
+                        last    = std::min<MultiArrayIndex>(current + prefetch_->distance_,
+                                                            prod(base_type::shape()) - 1);
+        threading::lock_guard<threading::mutex> lock(prefetch_->mutex_);
+        MultiArrayIndex & done = prefetch_->prefetched_until_;
+        if(done < current || done > current + prefetch_->distance_)
+            done = current;  // the iterator jumped => restart prefetching here
+        shape_type chunk_offset = chunk_.offset_ / chunk_shape_;
+        array_type * array = array_;
+        for(; done < last; ++done)
+        {
+            shape_type chunk_index = (base_type(*this) += (done + 1 - current)).point() + chunk_offset;
+            prefetch_->push(
+                [array, chunk_index](int)
+                {
+                    array->prefetchChunk(chunk_index);
+                });
         }
     }
 
@@ -3481,6 +4114,7 @@ class ChunkIterator
     array_type * array_;
     Chunk chunk_;
     shape_type start_, stop_, chunk_shape_, array_point_;
+    VIGRA_SHARED_PTR<detail::ChunkPrefetchQueue> prefetch_;
 };
 
 //@}
@@ -181,8 +181,12 @@ class ChunkedArrayHDF5
         <li>ZLIB_FAST: Fast compression using 'zlib' (slower than LZ4, but higher compression).
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
+        <li>ZSTD_FAST, ZSTD, ZSTD_BEST, zstdCompression(level): Zstandard compression
+            (requires the HDF5 zstd filter plugin when the file is written and read).
         <li>DEFAULT_COMPRESSION: Same as ZLIB_FAST.
         </ul>
+        <tt>options.shuffle()</tt> activates HDF5's shuffle filter (HDF5 only provides
+        byte shuffling, so BIT_SHUFFLE is treated like BYTE_SHUFFLE).
     */
     ChunkedArrayHDF5(HDF5File const & file, std::string const & dataset,
                      HDF5File::OpenMode mode,
@@ -195,6 +199,7 @@ class ChunkedArrayHDF5
       dataset_name_(dataset),
       dataset_(),
       compression_(options.compression_method),
+      compression_shuffle_(options.compression_shuffle),
       alloc_(alloc)
     {
         init(mode);
@@ -233,6 +238,7 @@ class ChunkedArrayHDF5
       dataset_name_(dataset),
       dataset_(),
       compression_(options.compression_method),
+      compression_shuffle_(options.compression_shuffle),
       alloc_(alloc)
     {
         init(mode);
@@ -245,6 +251,7 @@ class ChunkedArrayHDF5
     file_(src.file_),
     dataset_name_(src.dataset_name_),
     compression_(src.compression_),
+    compression_shuffle_(src.compression_shuffle_),
     alloc_(src.alloc_)
     {
         if( file_.isReadOnly() )
@@ -309,7 +316,8 @@ class ChunkedArrayHDF5
                                                  this->shape_,
                                                  init,
                                                  this->chunk_shape_,
-                                                 compression_);
+                                                 compression_,
+                                                 compression_shuffle_);
         }
         else
         {
@@ -425,6 +433,8 @@ class ChunkedArrayHDF5
     {
         vigra_precondition(file_.isOpen(),
             "ChunkedArrayHDF5::loadChunk(): file was already closed.");
+        // the HDF5 library is not thread-safe => serialize file access
+        threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
         if(*p == 0)
         {
             *p = new Chunk(this->chunkShape(index), index*this->chunk_shape_, this, alloc_);
@@ -437,6 +447,7 @@ class ChunkedArrayHDF5
     {
         if(!file_.isOpen())
             return true;
+        threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
         static_cast<Chunk *>(chunk)->write();
         return false;
     }
@@ -472,6 +483,7 @@ class ChunkedArrayHDF5
     std::string dataset_name_;
     HDF5HandleShared dataset_;
     CompressionMethod compression_;
+    CompressionShuffle compression_shuffle_;
     Alloc alloc_;
 };
 
@@ -42,6 +42,7 @@
 #include "multi_blocking.hxx"
 #include "multi_convolution.hxx"
 #include "multi_tensorutilities.hxx"
+#include "multi_array_chunked.hxx"
 #include "threadpool.hxx"
 #include "array_vector.hxx"
 
@@ -147,6 +148,18 @@ public:
         ParallelOptions::numThreads(n);
     }
 
+    BlockwiseOptions & threadPinning(ThreadPinning p)
+    {
+        ParallelOptions::threadPinning(p);
+        return *this;
+    }
+
+    BlockwiseOptions & numaPolicy(NumaPolicy p)
+    {
+        ParallelOptions::numaPolicy(p);
+        return *this;
+    }
+
 private:
     Shape blockShape_;
 };
@@ -170,6 +183,26 @@ public:
 
 namespace blockwise{
 
+    /**
+        helper function to run a functor <tt>f(threadId, blockIndex)</tt>
+        for all blocks in parallel. The pool is configured according
+        to the given options. With the <tt>NumaFirstTouch</tt> policy,
+        blocks are preferably processed on a fixed NUMA node
+        (see \ref parallel_foreach_numa()).
+    */
+    template<class F>
+    void parallelForEachBlock(
+        const ParallelOptions & options,
+        const std::ptrdiff_t numBlocks,
+        F && f
+    ){
+        ThreadPool pool(options);
+        if(options.getNumaPolicy() == ParallelOptions::NumaFirstTouch)
+            parallel_foreach_numa(pool, numBlocks, f);
+        else
+            parallel_foreach(pool, numBlocks, f);
+    }
+
     /**
         helper function to create blockwise parallel filters.
         This implementation should be used if the filter functor
@@ -194,12 +227,13 @@ namespace blockwise{
         typedef typename MultiBlocking<DIM, C>::BlockWithBorder BlockWithBorder;
 
         auto beginIter  =  blocking.blockWithBorderBegin(borderWidth);
-        auto endIter   =  blocking.blockWithBorderEnd(borderWidth);
 
-        parallel_foreach(options.getNumThreads(),
-            beginIter, endIter,
-            [&](const int /*threadId*/, const BlockWithBorder bwb)
+        parallelForEachBlock(options, blocking.numBlocks(),
+            [&](const int /*threadId*/, const std::ptrdiff_t blockIndex)
             {
+                // the iterator caches its value, so each call needs a copy
+                auto iter = beginIter;
+                const BlockWithBorder bwb = iter[blockIndex];
                 // get the input of the block as a view
                 vigra::MultiArrayView<DIM, T_IN, ST_IN> sourceSub = source.subarray(bwb.border().begin(),
                                                                              bwb.border().end());
@@ -213,8 +247,7 @@ namespace blockwise{
                 // write the core global out
                 dest.subarray(bwb.core().begin()-blocking.roiBegin(),
                               bwb.core().end()  -blocking.roiBegin()  ) = destSubCore;
-            },
-            blocking.numBlocks()
+            }
         );
 
     }
@@ -246,12 +279,13 @@ namespace blockwise{
 
 
         auto beginIter  =  blocking.blockWithBorderBegin(borderWidth);
-        auto endIter   =  blocking.blockWithBorderEnd(borderWidth);
 
-        parallel_foreach(options.getNumThreads(),
-            beginIter, endIter,
-            [&](const int /*threadId*/, const BlockWithBorder bwb)
+        parallelForEachBlock(options, blocking.numBlocks(),
+            [&](const int /*threadId*/, const std::ptrdiff_t blockIndex)
             {
+                // the iterator caches its value, so each call needs a copy
+                auto iter = beginIter;
+                const BlockWithBorder bwb = iter[blockIndex];
                 // get the input of the block as a view
                 vigra::MultiArrayView<DIM, T_IN, ST_IN> sourceSub = source.subarray(bwb.border().begin(),
                                                                             bwb.border().end());
@@ -261,13 +295,82 @@ namespace blockwise{
                 const Block localCore =  bwb.localCore();
                 // call the functor
                 functor(sourceSub, destCore, localCore.begin(), localCore.end());
-            },
-            blocking.numBlocks()
+            }
         );
 
 
     }
 
+    /**
+        helper function to create blockwise parallel filters
+        on \ref ChunkedArray "ChunkedArrays".
+        Each block (with its halo) is checked out through the chunk cache
+        of the source, filtered in memory, and its core is committed to
+        the destination. Blocks should be aligned to the destination's
+        chunks, so that concurrent commits never touch the same chunk.
+        Memory consumption is thus bounded by the cache sizes plus one
+        block per thread.
+    */
+    template<
+        unsigned int DIM,
+        class T_IN,
+        class T_OUT,
+        class FILTER_FUNCTOR,
+        class C
+    >
+    void blockwiseCaller(
+        const vigra::ChunkedArray<DIM, T_IN> & source,
+        vigra::ChunkedArray<DIM, T_OUT> & dest,
+        FILTER_FUNCTOR & functor,
+        const vigra::MultiBlocking<DIM, C> & blocking,
+        const typename vigra::MultiBlocking<DIM, C>::Shape & borderWidth,
+        const BlockwiseConvolutionOptions<DIM>  & options
+    ){
+        typedef typename MultiBlocking<DIM, C>::BlockWithBorder BlockWithBorder;
+        typedef typename MultiBlocking<DIM, C>::Block Block;
+
+        vigra_precondition((void const *)&source != (void const *)&dest,
+            "blockwiseCaller(): ChunkedArray filters cannot work in-place.");
+
+        auto beginIter  =  blocking.blockWithBorderBegin(borderWidth);
+
+        parallelForEachBlock(options, blocking.numBlocks(),
+            [&](const int /*threadId*/, const std::ptrdiff_t blockIndex)
+            {
+                // the iterator caches its value, so each call needs a copy
+                auto iter = beginIter;
+                const BlockWithBorder bwb = iter[blockIndex];
+                // fetch the input of the block including its halo
+                vigra::MultiArray<DIM, T_IN> sourceSub(bwb.border().size());
+                source.checkoutSubarray(bwb.border().begin(), sourceSub);
+                // compute the block's core into a temporary array
+                vigra::MultiArray<DIM, T_OUT> destCore(bwb.core().size());
+                const Block localCore =  bwb.localCore();
+                functor(sourceSub, destCore, localCore.begin(), localCore.end());
+                // write the core global out
+                dest.commitSubarray(bwb.core().begin(), destCore);
+            }
+        );
+    }
+
+    /**
+        Determine the block shape for filters on ChunkedArrays: the block shape
+        from the options (or the chunk shape if none was given), rounded to
+        a multiple of the chunk shape.
+    */
+    template<int N>
+    vigra::TinyVector< vigra::MultiArrayIndex, N > chunkAlignedBlockShape(
+        const BlockwiseOptions & opt,
+        const vigra::TinyVector< vigra::MultiArrayIndex, N > & chunkShape
+    ){
+        if(opt.getBlockShape().size() == 0)
+            return chunkShape;
+        vigra::TinyVector< vigra::MultiArrayIndex, N > res = opt.template getBlockShapeN<N>();
+        for(int d=0; d<N; ++d)
+            res[d] = std::max<MultiArrayIndex>(1, (res[d] + chunkShape[d] / 2) / chunkShape[d]) * chunkShape[d];
+        return res;
+    }
+
     #define CONVOLUTION_FUNCTOR(FUNCTOR_NAME, FUNCTION_NAME) \
     template<unsigned int DIM> \
     class FUNCTOR_NAME{ \
@@ -432,6 +535,25 @@ void FUNCTION( \
     const Blocking blocking(source.shape(), options.template getBlockShapeN<N>()); \
     blockwise::FUNCTOR<N> f(subOptions); \
     blockwise::blockwiseCaller(source, dest, f, blocking, border, options); \
+} \
+ \
+template <unsigned int N, class T1, class T2> \
+void FUNCTION( \
+    ChunkedArray<N, T1> const & source, \
+    ChunkedArray<N, T2> & dest, \
+    BlockwiseConvolutionOptions<N> const & options \
+) \
+{  \
+    typedef  MultiBlocking<N, vigra::MultiArrayIndex> Blocking; \
+    typedef typename Blocking::Shape Shape; \
+    vigra_precondition(source.shape() == dest.shape(), \
+        #FUNCTION "(): shape mismatch between input and output."); \
+    const Shape border = blockwise::getBorder(options, ORDER, USES_OUTER_SCALE); \
+    BlockwiseConvolutionOptions<N> subOptions(options); \
+    subOptions.subarray(Shape(0), Shape(0));  \
+    const Blocking blocking(source.shape(), blockwise::chunkAlignedBlockShape(options, dest.chunkShape())); \
+    blockwise::FUNCTOR<N> f(subOptions); \
+    blockwise::blockwiseCaller(source, dest, f, blocking, border, options); \
 }
 
 VIGRA_BLOCKWISE(GaussianSmoothFunctor,                   gaussianSmoothMultiArray,                   0, false );
@@ -459,6 +581,675 @@ gaussianGradientMagnitude(
     gaussianGradientMagnitudeMultiArray(source, dest, options);
 }
 
+template <unsigned int N, class T1, class T2>
+inline void
+gaussianGradientMagnitude(
+    ChunkedArray<N, T1> const & source,
+    ChunkedArray<N, T2> & dest,
+    BlockwiseConvolutionOptions<N> const & options)
+{
+    gaussianGradientMagnitudeMultiArray(source, dest, options);
+}
+
+/********************************************************/
+/*                                                      */
+/*                   blockwiseFilterBank                */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Specification of a single feature for \ref blockwiseFilterBank().
+
+        Each feature is defined by its type and scale (the standard deviation
+        of the Gaussian). The outer scale is only used by
+        <tt>StructureTensorEigenvalues</tt>.
+    */
+class FilterBankFeature
+{
+  public:
+    enum Type {
+        GaussianSmoothing,              ///< 1 channel, see gaussianSmoothMultiArray()
+        GaussianGradient,               ///< N channels, see gaussianGradientMultiArray()
+        GaussianGradientMagnitude,      ///< 1 channel, see gaussianGradientMagnitude()
+        LaplacianOfGaussian,            ///< 1 channel, see laplacianOfGaussianMultiArray()
+        HessianOfGaussianEigenvalues,   ///< N channels, see hessianOfGaussianMultiArray()
+        StructureTensorEigenvalues      ///< N channels, see structureTensorMultiArray()
+    };
+
+    FilterBankFeature(Type type, double scale, double outerScale = 0.0)
+    : type_(type)
+    , scale_(scale)
+    , outerScale_(outerScale)
+    {
+        vigra_precondition(scale > 0.0 && outerScale >= 0.0,
+            "FilterBankFeature(): scales must be positive.");
+        vigra_precondition(type != StructureTensorEigenvalues || outerScale > 0.0,
+            "FilterBankFeature(): the structure tensor requires a positive outer scale.");
+    }
+
+    Type type() const
+    {
+        return type_;
+    }
+
+    double scale() const
+    {
+        return scale_;
+    }
+
+    double outerScale() const
+    {
+        return outerScale_;
+    }
+
+        /** Number of output channels of this feature in N dimensions.
+        */
+    unsigned int channelCount(unsigned int N) const
+    {
+        switch(type_)
+        {
+          case GaussianGradient:
+          case HessianOfGaussianEigenvalues:
+          case StructureTensorEigenvalues:
+            return N;
+          default:
+            return 1;
+        }
+    }
+
+        /** Derivative order of the underlying Gaussian filters.
+        */
+    unsigned int order() const
+    {
+        switch(type_)
+        {
+          case GaussianSmoothing:
+            return 0;
+          case LaplacianOfGaussian:
+          case HessianOfGaussianEigenvalues:
+            return 2;
+          default:
+            return 1;
+        }
+    }
+
+  private:
+    Type type_;
+    double scale_, outerScale_;
+};
+
+    /** Total number of channels computed by \ref blockwiseFilterBank() in N dimensions.
+    */
+inline unsigned int
+filterBankChannelCount(ArrayVector<FilterBankFeature> const & features, unsigned int N)
+{
+    unsigned int res = 0;
+    for(unsigned int k=0; k<features.size(); ++k)
+        res += features[k].channelCount(N);
+    return res;
+}
+
+namespace blockwise {
+
+    // halo needed by all features, using the same rule as getBorder()
+    template<unsigned int N>
+    vigra::TinyVector< vigra::MultiArrayIndex, N > filterBankBorder(
+        const ArrayVector<FilterBankFeature> & features
+    ){
+        MultiArrayIndex border = 0;
+        for(unsigned int k=0; k<features.size(); ++k)
+        {
+            double stdDev = features[k].scale() + features[k].outerScale();
+            border = std::max(border,
+                static_cast<MultiArrayIndex>(3.0 * stdDev  + 0.5*static_cast<double>(features[k].order())+0.5));
+        }
+        return vigra::TinyVector< vigra::MultiArrayIndex, N >(border);
+    }
+
+    /**
+        Compute all features for the ROI <tt>[roiBegin, roiEnd)</tt> of <tt>source</tt>
+        and write them to the channels of <tt>dest</tt> (whose spatial shape equals
+        the ROI's shape). Features with the same scale share their Gaussian
+        gradient and Hessian, so that e.g. the Laplacian and the Hessian
+        eigenvalues at a given scale cost only a single Hessian computation.
+    */
+    template <unsigned int N, class T1, class S1, class T2, class S2>
+    void filterBankBlock(
+        const MultiArrayView<N, T1, S1> & source,
+        const MultiArrayView<N+1, T2, S2> & dest,
+        const ArrayVector<FilterBankFeature> & features,
+        const typename MultiArrayShape<N>::type & roiBegin,
+        const typename MultiArrayShape<N>::type & roiEnd
+    ){
+        typedef typename NumericTraits<T1>::RealPromote RealType;
+        typedef TinyVector<RealType, int(N)> VectorType;
+        typedef TinyVector<RealType, int(N*(N+1)/2)> TensorType;
+        typedef MultiArrayView<N, T2, StridedArrayTag> ChannelView;
+        typedef typename MultiArrayShape<N>::type Shape;
+
+        const Shape shape = roiEnd - roiBegin;
+
+        ArrayVector<unsigned int> channels(features.size()+1, 0);
+        for(unsigned int k=0; k<features.size(); ++k)
+            channels[k+1] = channels[k] + features[k].channelCount(N);
+
+        ArrayVector<bool> done(features.size(), false);
+        for(unsigned int i=0; i<features.size(); ++i)
+        {
+            if(done[i])
+                continue;
+
+            // process all features of the current scale
+            const double scale = features[i].scale();
+            ConvolutionOptions<N> opt;
+            opt.stdDev(scale).subarray(roiBegin, roiEnd);
+
+            MultiArray<N, VectorType> gradient;
+            MultiArray<N, TensorType> hessian;
+
+            for(unsigned int j=i; j<features.size(); ++j)
+            {
+                if(done[j] || features[j].scale() != scale)
+                    continue;
+                done[j] = true;
+
+                const FilterBankFeature::Type type = features[j].type();
+                if((type == FilterBankFeature::GaussianGradient ||
+                    type == FilterBankFeature::GaussianGradientMagnitude) && gradient.size() == 0)
+                {
+                    gradient.reshape(shape);
+                    gaussianGradientMultiArray(source, gradient, opt);
+                }
+                if((type == FilterBankFeature::LaplacianOfGaussian ||
+                    type == FilterBankFeature::HessianOfGaussianEigenvalues) && hessian.size() == 0)
+                {
+                    hessian.reshape(shape);
+                    hessianOfGaussianMultiArray(source, hessian, opt);
+                }
+
+                const unsigned int c = channels[j];
+                switch(type)
+                {
+                  case FilterBankFeature::GaussianSmoothing:
+                  {
+                    MultiArray<N, RealType> smoothed(shape);
+                    gaussianSmoothMultiArray(source, smoothed, opt);
+                    dest.bindOuter(c) = smoothed;
+                    break;
+                  }
+                  case FilterBankFeature::GaussianGradient:
+                  {
+                    for(unsigned int d=0; d<N; ++d)
+                        dest.bindOuter(c+d) = gradient.bindElementChannel(d);
+                    break;
+                  }
+                  case FilterBankFeature::GaussianGradientMagnitude:
+                  {
+                    ChannelView channel = dest.bindOuter(c);
+                    typename MultiArray<N, VectorType>::iterator g = gradient.begin();
+                    for(typename ChannelView::iterator d = channel.begin(); d != channel.end(); ++d, ++g)
+                        *d = detail::RequiresExplicitCast<T2>::cast(norm(*g));
+                    break;
+                  }
+                  case FilterBankFeature::LaplacianOfGaussian:
+                  {
+                    // the trace of the Hessian (stored as upper triangular matrix)
+                    ChannelView channel = dest.bindOuter(c);
+                    typename MultiArray<N, TensorType>::iterator h = hessian.begin();
+                    for(typename ChannelView::iterator d = channel.begin(); d != channel.end(); ++d, ++h)
+                    {
+                        RealType sum = (*h)[0];
+                        for(unsigned int k=1, diag=N; k<N; diag += N-k, ++k)
+                            sum += (*h)[diag];
+                        *d = detail::RequiresExplicitCast<T2>::cast(sum);
+                    }
+                    break;
+                  }
+                  case FilterBankFeature::HessianOfGaussianEigenvalues:
+                  {
+                    MultiArray<N, VectorType> eigenvalues(shape);
+                    tensorEigenvaluesMultiArray(hessian, eigenvalues);
+                    for(unsigned int d=0; d<N; ++d)
+                        dest.bindOuter(c+d) = eigenvalues.bindElementChannel(d);
+                    break;
+                  }
+                  case FilterBankFeature::StructureTensorEigenvalues:
+                  {
+                    ConvolutionOptions<N> stOpt(opt);
+                    stOpt.outerScale(features[j].outerScale());
+                    MultiArray<N, TensorType> tensor(shape);
+                    structureTensorMultiArray(source, tensor, stOpt);
+                    MultiArray<N, VectorType> eigenvalues(shape);
+                    tensorEigenvaluesMultiArray(tensor, eigenvalues);
+                    for(unsigned int d=0; d<N; ++d)
+                        dest.bindOuter(c+d) = eigenvalues.bindElementChannel(d);
+                    break;
+                  }
+                }
+            }
+        }
+    }
+
+    template <unsigned int N>
+    typename MultiArrayShape<N+1>::type
+    appendChannel(const typename MultiArrayShape<N>::type & shape, MultiArrayIndex channel)
+    {
+        typename MultiArrayShape<N+1>::type res;
+        for(unsigned int d=0; d<N; ++d)
+            res[d] = shape[d];
+        res[N] = channel;
+        return res;
+    }
+
+} // end namespace blockwise
+
+/** \brief Compute a bank of filter responses in a single blockwise pass.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void
+        blockwiseFilterBank(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N+1, T2, S2> dest,
+                            ArrayVector<FilterBankFeature> const & features,
+                            BlockwiseOptions const & options = BlockwiseOptions());
+
+        template <unsigned int N, class T1, class T2>
+        void
+        blockwiseFilterBank(ChunkedArray<N, T1> const & source,
+                            ChunkedArray<N+1, T2> & dest,
+                            ArrayVector<FilterBankFeature> const & features,
+                            BlockwiseOptions const & options = BlockwiseOptions());
+    }
+    \endcode
+
+    Calling several blockwise filters one after the other re-reads the input
+    for each filter and recomputes the same Gaussian derivatives. This function
+    instead visits every block only once (in parallel according to
+    <tt>options</tt>), fetches the block's input with a halo large enough for all
+    features, and computes the requested features together. Features of the same
+    scale share their intermediate results: the Gaussian gradient is computed once
+    for <tt>GaussianGradient</tt> and <tt>GaussianGradientMagnitude</tt>, and
+    the Hessian once for <tt>LaplacianOfGaussian</tt> and
+    <tt>HessianOfGaussianEigenvalues</tt>.
+
+    The results are written to the last (channel) axis of <tt>dest</tt>, in the order
+    of <tt>features</tt>. The number of channels is given by \ref filterBankChannelCount().
+    In the \ref ChunkedArray variant, blocks are aligned to the destination's chunks
+    (see \ref BlockwiseOptions), and the whole channel axis should be in one chunk
+    so that no two blocks write to the same chunk.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_blockwise.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float> volume(Shape3(200, 200, 100));
+    ...
+    ArrayVector<FilterBankFeature> features;
+    features.push_back(FilterBankFeature(FilterBankFeature::GaussianSmoothing, 1.0));
+    features.push_back(FilterBankFeature(FilterBankFeature::LaplacianOfGaussian, 1.6));
+    features.push_back(FilterBankFeature(FilterBankFeature::HessianOfGaussianEigenvalues, 1.6));
+    features.push_back(FilterBankFeature(FilterBankFeature::StructureTensorEigenvalues, 1.0, 2.0));
+
+    MultiArray<4, float> result(Shape4(200, 200, 100, filterBankChannelCount(features, 3)));
+    blockwiseFilterBank(volume, result, features, BlockwiseOptions().blockShape(64));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void blockwiseFilterBank)
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+void
+blockwiseFilterBank(MultiArrayView<N, T1, S1> const & source,
+                    MultiArrayView<N+1, T2, S2> dest,
+                    ArrayVector<FilterBankFeature> const & features,
+                    BlockwiseOptions const & options = BlockwiseOptions())
+{
+    typedef MultiBlocking<N, vigra::MultiArrayIndex> Blocking;
+    typedef typename Blocking::Shape Shape;
+    typedef typename Blocking::BlockWithBorder BlockWithBorder;
+
+    vigra_precondition(dest.shape() == blockwise::appendChannel<N>(source.shape(), filterBankChannelCount(features, N)),
+        "blockwiseFilterBank(): shape mismatch between input and output.");
+
+    const Shape border = blockwise::filterBankBorder<N>(features);
+    const Blocking blocking(source.shape(), options.template getBlockShapeN<N>());
+    auto beginIter = blocking.blockWithBorderBegin(border);
+
+    blockwise::parallelForEachBlock(options, blocking.numBlocks(),
+        [&](const int /*threadId*/, const std::ptrdiff_t blockIndex)
+        {
+            // the iterator caches its value, so each call needs a copy
+            auto iter = beginIter;
+            const BlockWithBorder bwb = iter[blockIndex];
+            blockwise::filterBankBlock(
+                source.subarray(bwb.border().begin(), bwb.border().end()),
+                dest.subarray(blockwise::appendChannel<N>(bwb.core().begin(), 0),
+                              blockwise::appendChannel<N>(bwb.core().end(), dest.shape(N))),
+                features, bwb.localCore().begin(), bwb.localCore().end());
+        }
+    );
+}
+
+template <unsigned int N, class T1, class T2>
+void
+blockwiseFilterBank(ChunkedArray<N, T1> const & source,
+                    ChunkedArray<N+1, T2> & dest,
+                    ArrayVector<FilterBankFeature> const & features,
+                    BlockwiseOptions const & options = BlockwiseOptions())
+{
+    typedef MultiBlocking<N, vigra::MultiArrayIndex> Blocking;
+    typedef typename Blocking::Shape Shape;
+    typedef typename Blocking::BlockWithBorder BlockWithBorder;
+
+    vigra_precondition(dest.shape() == blockwise::appendChannel<N>(source.shape(), filterBankChannelCount(features, N)),
+        "blockwiseFilterBank(): shape mismatch between input and output.");
+
+    const Shape border = blockwise::filterBankBorder<N>(features);
+    const Blocking blocking(source.shape(),
+                            blockwise::chunkAlignedBlockShape(options, Shape(dest.chunkShape().template subarray<0, N>())));
+    auto beginIter = blocking.blockWithBorderBegin(border);
+
+    blockwise::parallelForEachBlock(options, blocking.numBlocks(),
+        [&](const int /*threadId*/, const std::ptrdiff_t blockIndex)
+        {
+            // the iterator caches its value, so each call needs a copy
+            auto iter = beginIter;
+            const BlockWithBorder bwb = iter[blockIndex];
+            MultiArray<N, T1> sourceSub(bwb.border().size());
+            source.checkoutSubarray(bwb.border().begin(), sourceSub);
+            MultiArray<N+1, T2> destCore(blockwise::appendChannel<N>(bwb.core().size(), dest.shape(N)));
+            blockwise::filterBankBlock(sourceSub, destCore, features,
+                                       bwb.localCore().begin(), bwb.localCore().end());
+            dest.commitSubarray(blockwise::appendChannel<N>(bwb.core().begin(), 0), destCore);
+        }
+    );
+}
+
+#ifdef HasFFTW3
+
+namespace blockwise {
+
+    // Mirror coordinate 'i' at the borders of [0, n) without repeating the border
+    // element (the same padding as in convolveFFT()).
+inline MultiArrayIndex
+fftReflect(MultiArrayIndex i, MultiArrayIndex n)
+{
+    if(n == 1)
+        return 0;
+    MultiArrayIndex period = 2*(n-1);
+    i %= period;
+    if(i < 0)
+        i += period;
+    return i < n
+              ? i
+              : period - i;
+}
+
+    // Source coordinates of an FFT window that may extend beyond the array:
+    // 'index[d][k]' is the (reflected) source coordinate of the window's k-th
+    // element along axis d, and [boxBegin, boxEnd) is the bounding box of
+    // all these coordinates, i.e. the only part of the source that must be read.
+template <unsigned int N>
+struct FFTWindow
+{
+    typedef TinyVector<MultiArrayIndex, N> Shape;
+
+    ArrayVector<MultiArrayIndex> index[N];
+    Shape boxBegin, boxEnd;
+
+    FFTWindow(Shape const & start, Shape const & windowShape, Shape const & shape)
+    {
+        for(unsigned int d=0; d<N; ++d)
+        {
+            index[d].resize(windowShape[d]);
+            boxBegin[d] = shape[d];
+            boxEnd[d] = 0;
+            for(MultiArrayIndex k=0; k<windowShape[d]; ++k)
+            {
+                MultiArrayIndex i = fftReflect(start[d] + k, shape[d]);
+                index[d][k] = i;
+                boxBegin[d] = std::min(boxBegin[d], i);
+                boxEnd[d] = std::max(boxEnd[d], i + 1);
+            }
+        }
+    }
+
+        // copy the window from 'box' (the source restricted to [boxBegin, boxEnd))
+    template <class T, class S, class Real, class C>
+    void fill(MultiArrayView<N, T, S> const & box, MultiArrayView<N, Real, C> window) const
+    {
+        MultiCoordinateIterator<N> i(window.shape()),
+                                   end = i.getEndIterator();
+        for(; i != end; ++i)
+        {
+            Shape p;
+            for(unsigned int d=0; d<N; ++d)
+                p[d] = index[d][(*i)[d]] - boxBegin[d];
+            window[*i] = detail::RequiresExplicitCast<Real>::cast(box[p]);
+        }
+    }
+};
+
+    // Overlap-save convolution: every block's core is extended by the kernel's
+    // reach and padded to the FFT size 'windowShape', which must be at least
+    // 'coreShape + kernel.shape() - 1'. The cyclic convolution of the window
+    // (computed with the kernel's transform, which is the same for all blocks)
+    // is exact in the core, so no further padding is needed. 'fetch(window, buffer)'
+    // fills a window's data, 'store(core, result)' writes the result of a block.
+template <unsigned int N, class Real, class C, class FETCH, class STORE>
+void
+convolveFFTBlockwiseImpl(typename MultiArrayShape<N>::type const & shape,
+                         MultiArrayView<N, Real, C> const & kernel,
+                         typename MultiArrayShape<N>::type const & coreShape,
+                         typename MultiArrayShape<N>::type const & windowShape,
+                         ParallelOptions const & options,
+                         FETCH fetch, STORE store)
+{
+    typedef MultiBlocking<N, MultiArrayIndex> Blocking;
+    typedef typename Blocking::Shape Shape;
+    typedef typename Blocking::Block Block;
+    typedef FFTWComplex<Real> Complex;
+
+    struct ThreadData
+    {
+        FFTWConvolvePlan<N, Real> plan;
+        MultiArray<N, Real> in, out;
+    };
+
+    // the kernel element at kernel.shape() / 2 is the center (as in convolveFFT())
+    Shape leftReach = kernel.shape() - Shape(1) - kernel.shape() / 2,
+          fourierShape = fftwCorrespondingShapeR2C(windowShape);
+
+    // transform the kernel only once
+    MultiArray<N, Complex> fourierKernel(fourierShape);
+    {
+        MultiArray<N, Real> spatialKernel(windowShape);
+        detail::fftEmbedKernel(kernel, spatialKernel);
+        fourierTransform(spatialKernel, fourierKernel);
+        moveDCToHalfspaceCenter(fourierKernel);
+    }
+
+    const Blocking blocking(shape, coreShape);
+    auto beginIter = blocking.blockBegin();
+    std::vector<VIGRA_UNIQUE_PTR<ThreadData> > threadData(std::max(1, options.getActualNumThreads()));
+
+    parallelForEachBlock(options, blocking.numBlocks(),
+        [&](const int threadId, const std::ptrdiff_t blockIndex)
+        {
+            VIGRA_UNIQUE_PTR<ThreadData> & data = threadData[threadId];
+            if(!data)
+            {
+                data.reset(new ThreadData);
+                data->plan.initFourierKernel(windowShape, fourierShape);
+                data->in.reshape(windowShape);
+                data->out.reshape(windowShape);
+            }
+
+            // the iterator caches its value, so each call needs a copy
+            auto iter = beginIter;
+            const Block core = iter[blockIndex];
+            fetch(FFTWindow<N>(core.begin() - leftReach, windowShape, shape), data->in);
+            data->plan.execute(data->in, fourierKernel, data->out);
+            store(core, data->out.subarray(leftReach, leftReach + core.size()));
+        }
+    );
+}
+
+    // Choose the block and FFT window shapes: blocks should be at least as large
+    // as the overlap between neighboring windows, and the window shape is rounded
+    // up to an efficient FFT size.
+template <int N>
+TinyVector<MultiArrayIndex, N>
+fftWindowShape(TinyVector<MultiArrayIndex, N> & blockShape,
+               TinyVector<MultiArrayIndex, N> const & kernelShape,
+               TinyVector<MultiArrayIndex, N> const & shape,
+               bool enlargeBlocks)
+{
+    typedef TinyVector<MultiArrayIndex, N> Shape;
+
+    Shape overlap = kernelShape - Shape(1);
+    if(enlargeBlocks)
+        blockShape = max(blockShape, overlap);
+    blockShape = min(max(blockShape, Shape(1)), shape);
+    Shape windowShape = fftwBestPaddedShapeR2C(blockShape + overlap);
+    // use the padding of the window for a larger block
+    if(enlargeBlocks)
+        blockShape = min(windowShape - overlap, shape);
+    return windowShape;
+}
+
+    // true if the memory of the two views intersects
+template <unsigned int N, class T1, class S1, class T2, class S2>
+bool
+viewsOverlap(MultiArrayView<N, T1, S1> const & a, MultiArrayView<N, T2, S2> const & b)
+{
+    typedef TinyVector<MultiArrayIndex, N> Shape;
+
+    if(a.size() == 0 || b.size() == 0)
+        return false;
+    char const * aBegin = (char const *)a.data(),
+               * aEnd   = (char const *)(a.data() + dot(a.shape() - Shape(1), a.stride()) + 1),
+               * bBegin = (char const *)b.data(),
+               * bEnd   = (char const *)(b.data() + dot(b.shape() - Shape(1), b.stride()) + 1);
+    return aBegin < bEnd && bBegin < aEnd;
+}
+
+} // namespace blockwise
+
+/** \brief Convolve an array with a kernel by means of blockwise Fourier transforms.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class Real, class C, class T2, class S2>
+        void
+        convolveFFTBlockwise(MultiArrayView<N, T1, S1> const & source,
+                             MultiArrayView<N, Real, C> const & kernel,
+                             MultiArrayView<N, T2, S2> dest,
+                             BlockwiseOptions const & options = BlockwiseOptions());
+
+        template <unsigned int N, class T1, class Real, class C, class T2>
+        void
+        convolveFFTBlockwise(ChunkedArray<N, T1> const & source,
+                             MultiArrayView<N, Real, C> const & kernel,
+                             ChunkedArray<N, T2> & dest,
+                             BlockwiseOptions const & options = BlockwiseOptions());
+    }
+    \endcode
+
+    The result is the same as that of \ref convolveFFT() (up to round-off), including the
+    reflective border treatment, but the array is not transformed as a whole. Instead, the
+    function uses the <i>overlap-save</i> method: the array is divided into blocks
+    (in parallel according to <tt>options</tt>), every block is extended by the kernel's
+    support and convolved cyclically via the Fourier transform, and the parts
+    affected by the cyclic wrap-around are discarded. Thus, memory consumption is bounded
+    by a few windows per thread, and the kernel is transformed only once. The block
+    shape from the options is enlarged to at least the kernel size minus one (so that at
+    most half of each FFT is overlap), and the FFT windows are rounded up to efficient
+    FFT lengths.
+
+    In the \ref ChunkedArray variant, blocks are aligned to the destination's chunks,
+    and each window is fetched through the source's chunk cache. The function requires
+    FFTW (compile with <tt>HasFFTW3</tt> defined), and cannot work in-place.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_blockwise.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    ChunkedArrayHDF5<3, float> volume(...), result(...);
+    MultiArray<3, float> kernel(Shape3(31, 31, 31));
+    ...
+    convolveFFTBlockwise(volume, kernel, result, BlockwiseOptions().blockShape(128).numThreads(8));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void convolveFFTBlockwise)
+
+template <unsigned int N, class T1, class S1, class Real, class C, class T2, class S2>
+void
+convolveFFTBlockwise(MultiArrayView<N, T1, S1> const & source,
+                     MultiArrayView<N, Real, C> const & kernel,
+                     MultiArrayView<N, T2, S2> dest,
+                     BlockwiseOptions const & options = BlockwiseOptions())
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    vigra_precondition(source.shape() == dest.shape(),
+        "convolveFFTBlockwise(): shape mismatch between input and output.");
+    vigra_precondition(!blockwise::viewsOverlap(source, dest),
+        "convolveFFTBlockwise(): cannot work in-place.");
+
+    Shape blockShape = options.template getBlockShapeN<N>(),
+          windowShape = blockwise::fftWindowShape(blockShape, kernel.shape(), source.shape(), true);
+
+    blockwise::convolveFFTBlockwiseImpl(source.shape(), kernel, blockShape, windowShape, options,
+        [&](blockwise::FFTWindow<N> const & window, MultiArrayView<N, Real> buffer)
+        {
+            window.fill(source.subarray(window.boxBegin, window.boxEnd), buffer);
+        },
+        [&](Box<MultiArrayIndex, N> const & core, MultiArrayView<N, Real, StridedArrayTag> result)
+        {
+            dest.subarray(core.begin(), core.end()) = result;
+        });
+}
+
+template <unsigned int N, class T1, class Real, class C, class T2>
+void
+convolveFFTBlockwise(ChunkedArray<N, T1> const & source,
+                     MultiArrayView<N, Real, C> const & kernel,
+                     ChunkedArray<N, T2> & dest,
+                     BlockwiseOptions const & options = BlockwiseOptions())
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    vigra_precondition(source.shape() == dest.shape(),
+        "convolveFFTBlockwise(): shape mismatch between input and output.");
+    vigra_precondition((void const *)&source != (void const *)&dest,
+        "convolveFFTBlockwise(): ChunkedArray filters cannot work in-place.");
+
+    Shape blockShape = blockwise::chunkAlignedBlockShape(options, dest.chunkShape()),
+          windowShape = blockwise::fftWindowShape(blockShape, kernel.shape(), source.shape(), false);
+
+    blockwise::convolveFFTBlockwiseImpl(source.shape(), kernel, blockShape, windowShape, options,
+        [&](blockwise::FFTWindow<N> const & window, MultiArrayView<N, Real> buffer)
+        {
+            MultiArray<N, T1> box(window.boxEnd - window.boxBegin);
+            source.checkoutSubarray(window.boxBegin, box);
+            window.fill(box, buffer);
+        },
+        [&](Box<MultiArrayIndex, N> const & core, MultiArrayView<N, Real, StridedArrayTag> result)
+        {
+            MultiArray<N, T2> converted(result);
+            dest.commitSubarray(core.begin(), converted);
+        });
+}
+
+#endif // HasFFTW3
 
 } // end namespace vigra
 
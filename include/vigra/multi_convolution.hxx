@@ -50,9 +50,20 @@
 #include "functorexpression.hxx"
 #include "tinyvector.hxx"
 #include "algorithm.hxx"
+#include "threadpool.hxx"
+#include "recursiveconvolution.hxx"
+#ifdef HasFFTW3
+#include "multi_fft.hxx"
+#endif
 
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <chrono>
 
 namespace vigra
 {
@@ -204,6 +215,255 @@ struct multiArrayScaleParam
 
 } // namespace detail
 
+/** \brief Algorithms for Gaussian filters and their derivatives.
+
+    See \ref ConvolutionOptions::convolutionMethod().
+*/
+enum ConvolutionMethod
+{
+    DirectConvolution,     ///< separable FIR kernels (default)
+    RecursiveConvolution,  ///< recursive (IIR) filters
+    FFTConvolution,        ///< multiplication in the Fourier domain (requires FFTW)
+    AutomaticConvolution   ///< the fastest of the above according to ConvolutionCostModel
+};
+
+/********************************************************/
+/*                                                      */
+/*                 ConvolutionCostModel                 */
+/*                                                      */
+/********************************************************/
+
+/** \brief Run time model for the choice of a convolution algorithm.
+
+    The model predicts the run time of a Gaussian filter (or derivative) computed by
+    direct (separable FIR) convolution, by recursive filters, or by means of the
+    Fourier transform, and is used by the <tt>AutomaticConvolution</tt> mode (see
+    \ref ConvolutionOptions::convolutionMethod()). The predictions are
+
+    <ul>
+    <li> direct: <tt>pixels * sum_k (direct_pass + direct_tap * kernel_size_k) / threads</tt>
+    <li> recursive: <tt>sum_k pixels * (1 + border_margin_k / shape_k) * recursive_pass</tt>
+    <li> FFT: <tt>3 * fft_element * padded_pixels * log2(padded_pixels) / threads</tt> (forward
+         transforms of array and kernel, inverse transform of the product)
+    </ul>
+
+    where each coefficient exists for single and double precision (index 0 and 1
+    respectively). <tt>threads</tt> is the number of threads in tiled mode, see
+    \ref ConvolutionOptions::tileShape().
+
+    The default coefficients represent a typical desktop machine. Use
+    \ref calibrateConvolutionCostModel() to measure them on the present machine
+    (and cache them in a file), or set them directly in the model returned by
+    <tt>ConvolutionCostModel::global()</tt>.
+
+    <b>\#include</b> \<vigra/multi_convolution.hxx\><br/>
+    Namespace: vigra
+*/
+class ConvolutionCostModel
+{
+  public:
+        /** Seconds per pixel and kernel tap of a direct convolution pass.
+        */
+    double direct_tap[2];
+
+        /** Seconds per pixel of a direct convolution pass, independent of the kernel size.
+        */
+    double direct_pass[2];
+
+        /** Seconds per pixel of a recursive filter pass.
+        */
+    double recursive_pass[2];
+
+        /** Seconds per element and <tt>log2(size)</tt> of a real-to-complex Fourier transform.
+        */
+    double fft_element[2];
+
+        /** Initialize with the default coefficients.
+        */
+    ConvolutionCostModel()
+    {
+        direct_tap[0]     = 0.5e-9;
+        direct_tap[1]     = 0.8e-9;
+        direct_pass[0]    = 2.5e-9;
+        direct_pass[1]    = 4.0e-9;
+        recursive_pass[0] = 1.4e-8;
+        recursive_pass[1] = 1.5e-8;
+        fft_element[0]    = 1.0e-9;
+        fft_element[1]    = 1.6e-9;
+    }
+
+        /** The model used by the <tt>AutomaticConvolution</tt> mode.
+        */
+    static ConvolutionCostModel & global()
+    {
+        static ConvolutionCostModel model;
+        return model;
+    }
+
+        /** Radius of the Gaussian kernel of the given order as created by
+            \ref Kernel1D::initGaussianDerivative().
+        */
+    static int gaussianRadius(double sigma, unsigned int order, double window_ratio = 0.0)
+    {
+        int radius = window_ratio > 0.0
+                         ? (int)(window_ratio * sigma + 0.5)
+                         : (int)(3.0 * sigma + 0.5 * order + 0.5);
+        return std::max(radius, 1);
+    }
+
+        /** Smallest length <tt>>= n</tt> whose prime factors are at most 7,
+            i.e. which can be Fourier transformed efficiently.
+        */
+    static MultiArrayIndex fftPaddedSize(MultiArrayIndex n)
+    {
+        for(;; ++n)
+        {
+            MultiArrayIndex m = n;
+            for(int f = 2; f <= 7; ++f)
+                while(m % f == 0)
+                    m /= f;
+            if(m == 1)
+                return n;
+        }
+    }
+
+        /** Predicted run time of direct convolution.
+        */
+    template <int N>
+    double directCost(TinyVector<MultiArrayIndex, N> const & shape, TinyVector<double, N> const & sigmas,
+                      unsigned int order, double window_ratio, bool double_precision,
+                      int threads = 1) const
+    {
+        int p = double_precision ? 1 : 0;
+        double pixels = (double)prod(shape), res = 0.0;
+        for(int k=0; k<N; ++k)
+            res += pixels*(direct_pass[p] +
+                           direct_tap[p]*(2*gaussianRadius(sigmas[k], order, window_ratio) + 1));
+        return res / std::max(threads, 1);
+    }
+
+        /** Predicted run time of recursive filtering.
+        */
+    template <int N>
+    double recursiveCost(TinyVector<MultiArrayIndex, N> const & shape, TinyVector<double, N> const & sigmas,
+                         bool double_precision) const
+    {
+        int p = double_precision ? 1 : 0;
+        double pixels = (double)prod(shape), res = 0.0;
+        for(int k=0; k<N; ++k)
+            res += pixels*(1.0 + (8.0*sigmas[k] + 8.0) / shape[k])*recursive_pass[p];
+        return res;
+    }
+
+        /** Predicted run time of Fourier domain convolution.
+        */
+    template <int N>
+    double fftCost(TinyVector<MultiArrayIndex, N> const & shape, TinyVector<double, N> const & sigmas,
+                   unsigned int order, double window_ratio, bool double_precision,
+                   int threads = 1) const
+    {
+        int p = double_precision ? 1 : 0;
+        double padded = 1.0;
+        for(int k=0; k<N; ++k)
+            padded *= (double)fftPaddedSize(shape[k] + 2*gaussianRadius(sigmas[k], order, window_ratio));
+        return 3.0*fft_element[p]*padded*std::log(padded)/std::log(2.0) / std::max(threads, 1);
+    }
+
+        /** Choose the fastest method for a Gaussian filter of the given order (i.e. the
+            highest derivative order along any axis) among direct convolution and the
+            methods whose flags are <tt>true</tt>.
+        */
+    template <int N>
+    ConvolutionMethod select(TinyVector<MultiArrayIndex, N> const & shape, TinyVector<double, N> const & sigmas,
+                             unsigned int order, double window_ratio, bool double_precision,
+                             int threads, bool allow_recursive, bool allow_fft) const
+    {
+        ConvolutionMethod best = DirectConvolution;
+        double cost = directCost(shape, sigmas, order, window_ratio, double_precision, threads);
+        if(allow_recursive)
+        {
+            double c = recursiveCost(shape, sigmas, double_precision);
+            if(c < cost)
+            {
+                best = RecursiveConvolution;
+                cost = c;
+            }
+        }
+        if(allow_fft && fftCost(shape, sigmas, order, window_ratio, double_precision, threads) < cost)
+            best = FFTConvolution;
+        return best;
+    }
+
+        /** Measure the coefficients on the present machine.
+
+            This runs each method on a few small test volumes and takes about
+            a second.
+        */
+    void calibrate();
+
+        /** Read coefficients from a file written by save().
+
+            Returns <tt>false</tt> (and leaves the model unchanged) when the file
+            does not exist or cannot be parsed.
+        */
+    bool load(std::string const & filename)
+    {
+        std::ifstream file(filename.c_str());
+        if(!file)
+            return false;
+        ConvolutionCostModel model(*this);
+        std::string line;
+        int found = 0;
+        while(std::getline(file, line))
+        {
+            if(line.empty() || line[0] == '#')
+                continue;
+            std::istringstream s(line);
+            std::string key;
+            double single_precision, double_precision;
+            if(!(s >> key >> single_precision >> double_precision))
+                return false;
+            double * target = key == "direct_tap"     ? model.direct_tap
+                            : key == "direct_pass"    ? model.direct_pass
+                            : key == "recursive_pass" ? model.recursive_pass
+                            : key == "fft_element"    ? model.fft_element
+                                                      : 0;
+            if(target == 0)
+                return false;
+            target[0] = single_precision;
+            target[1] = double_precision;
+            ++found;
+        }
+        if(found != 4)
+            return false;
+        *this = model;
+        return true;
+    }
+
+        /** Write the coefficients to a text file.
+        */
+    void save(std::string const & filename) const
+    {
+        std::ofstream file(filename.c_str());
+        vigra_precondition((bool)file,
+            "ConvolutionCostModel::save(): unable to open file '" + filename + "'.");
+        file.precision(6);
+        file << "# vigra::ConvolutionCostModel: seconds for single and double precision\n"
+             << "direct_tap "     << direct_tap[0]     << " " << direct_tap[1]     << "\n"
+             << "direct_pass "    << direct_pass[0]    << " " << direct_pass[1]    << "\n"
+             << "recursive_pass " << recursive_pass[0] << " " << recursive_pass[1] << "\n"
+             << "fft_element "    << fft_element[0]    << " " << fft_element[1]    << "\n";
+    }
+
+  private:
+    template <class T>
+    void calibrateImpl(int p);
+
+    template <class T>
+    static double timeGaussianSmoothing(MultiArrayView<3, T> const & data, MultiArrayView<3, T> res,
+                                        double sigma, ConvolutionMethod method);
+};
+
 #define VIGRA_CONVOLUTION_OPTIONS(function_name, default_value, member_name, getter_setter_name) \
     template <class Param> \
     ConvolutionOptions & function_name(const Param & val) \
@@ -345,13 +605,18 @@ class ConvolutionOptions
     ParamVec outer_scale;
     double window_ratio;
     Shape from_point, to_point;
+    Shape tile_shape;
+    int tile_threads;
+    ConvolutionMethod convolution_method;
 
     ConvolutionOptions()
     : sigma_eff(0.0),
       sigma_d(0.0),
       step_size(1.0),
       outer_scale(0.0),
-      window_ratio(0.0)
+      window_ratio(0.0),
+      tile_threads(ParallelOptions::Auto),
+      convolution_method(DirectConvolution)
     {}
 
     typedef typename detail::WrapDoubleIteratorTriple<ParamIt, ParamIt, ParamIt>
@@ -508,11 +773,306 @@ class ConvolutionOptions
       res.second = to_point;
       return res;
     }
+
+        /** Convolve the array tile by tile.
+
+            In tiled mode, \ref separableConvolveMultiArray() and the
+            Gaussian filters built upon it perform all axis passes for one
+            tile (plus the halo required by the kernels) before moving on to
+            the next tile, instead of streaming the entire array through
+            memory once per axis. Tiles are processed in parallel (see
+            tileThreads()). Choose the tile shape such that a tile with halo
+            fits into the cache, e.g. <tt>64x64x64</tt> for 3D float data, but
+            considerably larger than the kernel radius, because the halo has
+            to be convolved along with each tile.
+            Entries <tt><= 0</tt> mean that tiles span the entire array along
+            the respective axis.
+
+            The results agree with the untiled computation up to rounding
+            errors. Source and destination must not overlap unless the
+            <tt>MultiArrayView</tt> API is used, which makes a temporary copy
+            of the source in this case.
+
+            Default: <tt>Shape()</tt> (i.e. don't use tiles)
+        */
+    ConvolutionOptions<dim> & tileShape(Shape const & shape)
+    {
+        tile_shape = shape;
+        return *this;
+    }
+
+        /** Convolve the array in cubic tiles of the given side length.
+        */
+    ConvolutionOptions<dim> & tileShape(MultiArrayIndex size)
+    {
+        tile_shape = Shape(size);
+        return *this;
+    }
+
+    Shape const & getTileShape() const
+    {
+        return tile_shape;
+    }
+
+    bool isTiled() const
+    {
+        return tile_shape != Shape();
+    }
+
+        /** Number of threads used in tiled mode.
+
+            The value is interpreted as in ParallelOptions::numThreads(),
+            i.e. <tt>0</tt> processes the tiles sequentially in the calling thread.
+
+            Default: <tt>ParallelOptions::Auto</tt>
+        */
+    ConvolutionOptions<dim> & tileThreads(int n)
+    {
+        tile_threads = n;
+        return *this;
+    }
+
+    int getTileThreads() const
+    {
+        return tile_threads;
+    }
+
+        /** Compute Gaussian filters and their derivatives recursively.
+
+            When this option is set, \ref gaussianSmoothMultiArray(),
+            \ref gaussianGradientMultiArray(), \ref hessianOfGaussianMultiArray(),
+            \ref laplacianOfGaussianMultiArray() and the functions built upon them
+            (e.g. \ref structureTensorMultiArray()) use a fourth order recursive (IIR)
+            approximation of the Gaussian instead of FIR kernels (see
+            \ref recursiveGaussianDerivativeLine()). The cost per pixel is then
+            independent of the scale, which pays off for <tt>sigma</tt> of about 3 and
+            above. The results agree with the FIR filters up to about 1% of the
+            maximum response. The border is always treated by reflection, and
+            filterWindowSize() and tileShape() are ignored.
+
+            Since FIR filters are cheaper and more accurate at small scales,
+            they are still used when the effective standard deviation of some axis
+            (see resolutionStdDev() and stepSize()) is below 1.
+
+            This is equivalent to <tt>convolutionMethod(use ? RecursiveConvolution : DirectConvolution)</tt>.
+
+            Default: <tt>false</tt>
+        */
+    ConvolutionOptions<dim> & recursiveGaussian(bool use = true)
+    {
+        convolution_method = use ? RecursiveConvolution : DirectConvolution;
+        return *this;
+    }
+
+    bool getRecursiveGaussian() const
+    {
+        return convolution_method == RecursiveConvolution;
+    }
+
+        /** Select the algorithm for Gaussian filters and their derivatives.
+
+            The choice applies to \ref gaussianSmoothMultiArray(),
+            \ref gaussianGradientMultiArray(), \ref hessianOfGaussianMultiArray(),
+            \ref laplacianOfGaussianMultiArray() and the functions built upon them.
+            <ul>
+            <li> <tt>DirectConvolution</tt>: separable FIR kernels (see
+                 \ref separableConvolveMultiArray()).
+            <li> <tt>RecursiveConvolution</tt>: recursive filters, see recursiveGaussian().
+            <li> <tt>FFTConvolution</tt>: multiplication in the Fourier domain by
+                 means of \ref convolveFFT(). This requires FFTW and is only
+                 compiled when the macro <tt>HasFFTW3</tt> is defined and the source and
+                 destination arrays are scalar. Like the direct convolution, it
+                 reflects the array at the border, so that the results agree
+                 up to rounding errors.
+            <li> <tt>AutomaticConvolution</tt>: choose the fastest of the applicable methods
+                 for each call, according to the \ref ConvolutionCostModel. The
+                 model takes the kernel sizes, the array shape, the pixel type
+                 and the number of threads (in tiled mode) into account.
+                 Call \ref calibrateConvolutionCostModel() once to adapt the model
+                 to the present machine.
+            </ul>
+
+            Default: <tt>DirectConvolution</tt>
+        */
+    ConvolutionOptions<dim> & convolutionMethod(ConvolutionMethod method)
+    {
+        convolution_method = method;
+        return *this;
+    }
+
+    ConvolutionMethod getConvolutionMethod() const
+    {
+        return convolution_method;
+    }
 };
 
 namespace detail
 {
 
+/********************************************************/
+/*                                                      */
+/*                 convolveLineBundle                   */
+/*                                                      */
+/********************************************************/
+
+    // number of lines that are convolved together by convolveLineBundle()
+enum { ConvolveLineBundleSize = 16 };
+
+    // Index of the line element that represents position x when the line
+    // (of length w) is extended according to the given border treatment.
+    // Returns -1 when the position is to be treated as zero.
+inline int
+lineBorderIndex(int x, int w, BorderTreatmentMode border)
+{
+    if(0 <= x && x < w)
+        return x;
+    switch(border)
+    {
+      case BORDER_TREATMENT_REFLECT:
+        return x < 0 ? -x : 2*(w-1) - x;
+      case BORDER_TREATMENT_REPEAT:
+        return x < 0 ? 0 : w-1;
+      case BORDER_TREATMENT_WRAP:
+        return x < 0 ? x + w : x - w;
+      default:
+        return -1;
+    }
+}
+
+    // convolveLineBundle() handles the border treatments that merely extend
+    // the line. CLIP and AVOID modify the kernel resp. the output range
+    // near the border and are left to convolveLine().
+template <class Kernel>
+inline bool
+canConvolveLineBundle(Kernel const & kernel, MultiArrayIndex w)
+{
+    BorderTreatmentMode border = kernel.borderTreatment();
+    return (border == BORDER_TREATMENT_REFLECT || border == BORDER_TREATMENT_REPEAT ||
+            border == BORDER_TREATMENT_WRAP    || border == BORDER_TREATMENT_ZEROPAD) &&
+           w >= std::max(kernel.right(), -kernel.left()) + 1;
+}
+
+/* Convolve 'count' (at most ConvolveLineBundleSize) lines of length w
+   from 'slines' to 'dlines' (which may be the same lines).
+
+   The lines are transposed into an interleaved buffer (including the border
+   extension), so that the innermost loop runs over corresponding elements of
+   all lines. This loop has unit stride and is therefore vectorized by the
+   compiler, regardless of the stride of the lines themselves.
+   Neighboring lines (as delivered by MultiArrayNavigator) also make the
+   transposition cache friendly. Each line's sum is accumulated in the same
+   order as in convolveLine() (including the folding of symmetric kernels),
+   so the results are identical.
+*/
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor,
+          class Kernel, class TmpType, class SumType>
+void
+convolveLineBundle(SrcIterator const * slines, SrcAccessor src,
+                   DestIterator const * dlines, DestAccessor dest,
+                   int count, int w, Kernel const & kernel,
+                   ArrayVector<TmpType> & buffer, ArrayVector<SumType> & sum)
+{
+    enum { L = ConvolveLineBundleSize };
+
+    typedef typename Kernel::value_type KernelValue;
+    typedef typename DestAccessor::value_type DestType;
+
+    const int kleft = kernel.left(), kright = kernel.right();
+    const int padded = w + kright - kleft;
+    const BorderTreatmentMode border = kernel.borderTreatment();
+
+    if(buffer.size() != (std::size_t)(padded*L))
+        buffer.resize(padded*L);
+    if(count < L)
+        std::fill(buffer.begin(), buffer.end(), NumericTraits<TmpType>::zero());
+
+    // transpose the lines into the buffer
+    TmpType * b = buffer.data() + kright*L;
+    for(int x=0; x<w; ++x, b += L)
+        for(int l=0; l<count; ++l)
+            b[l] = src(slines[l] + x);
+
+    // border extension
+    for(int x=-kright; x<w-kleft; ++x)
+    {
+        if(x == 0)
+            x = w;
+        if(x >= w-kleft)
+            break;
+        int from = lineBorderIndex(x, w, border);
+        TmpType * d = buffer.data() + (x+kright)*L;
+        if(from < 0)
+            std::fill(d, d+L, NumericTraits<TmpType>::zero());
+        else
+            std::copy(buffer.data() + (from+kright)*L, buffer.data() + (from+kright+1)*L, d);
+    }
+
+    // Accumulate one kernel tap at a time over all positions and lines.
+    // The innermost loop is a plain unit-stride multiply-add of length w*L.
+    // Pairs of equal coefficients of (anti)symmetric kernels are folded
+    // in the same way as in convolveLine().
+    const int size = w*L;
+    if(sum.size() != (std::size_t)size)
+        sum.resize(size);
+    std::fill(sum.begin(), sum.end(), NumericTraits<SumType>::zero());
+    SumType * s = sum.data();
+    const KernelSymmetry symmetry = kernel.symmetry();
+    // convolveLine() folds only where the kernel fits inside the line,
+    // so the border positions keep the plain tap order
+    const int interiorBegin = symmetry == KERNEL_ASYMMETRIC
+                                  ? size
+                                  : std::min(kright*L, size),
+              interiorEnd   = std::max(interiorBegin, (w+kleft)*L);
+    for(int k=kright; k>=kleft; --k)
+    {
+        const KernelValue kv = kernel[k];
+        TmpType const * p = buffer.data() + (kright-k)*L;
+        for(int i=0; i<interiorBegin; ++i)
+            s[i] += kv * p[i];
+        for(int i=interiorEnd; i<size; ++i)
+            s[i] += kv * p[i];
+    }
+    if(interiorBegin < interiorEnd)
+    {
+        TmpType const * center = buffer.data() + kright*L;
+        if(symmetry == KERNEL_SYMMETRIC)
+        {
+            const KernelValue kv = kernel[0];
+            for(int i=interiorBegin; i<interiorEnd; ++i)
+                s[i] += kv * center[i];
+        }
+        for(int k=1; k<=kright; ++k)
+        {
+            const KernelValue kv = kernel[k];
+            TmpType const * pl = center - k*L;
+            TmpType const * pr = center + k*L;
+            if(symmetry == KERNEL_SYMMETRIC)
+            {
+                for(int i=interiorBegin; i<interiorEnd; ++i)
+                {
+                    SumType t = pl[i];
+                    t += pr[i];
+                    s[i] += kv * t;
+                }
+            }
+            else
+            {
+                for(int i=interiorBegin; i<interiorEnd; ++i)
+                {
+                    SumType t = pl[i];
+                    t -= pr[i];
+                    s[i] += kv * t;
+                }
+            }
+        }
+    }
+
+    for(int x=0; x<w; ++x, s += L)
+        for(int l=0; l<count; ++l)
+            dest.set(detail::RequiresExplicitCast<DestType>::cast(s[l]), dlines[l] + x);
+}
+
 /********************************************************/
 /*                                                      */
 /*        internalSeparableConvolveMultiArray           */
@@ -530,6 +1090,8 @@ internalSeparableConvolveMultiArrayTmp(
 
     typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
     typedef typename AccessorTraits<TmpType>::default_accessor TmpAcessor;
+    typedef typename std::iterator_traits<KernelIterator>::value_type::value_type KernelValue;
+    typedef typename PromoteTraits<TmpType, KernelValue>::Promote SumType;
 
     // temporary array to hold the current line to enable in-place operation
     ArrayVector<TmpType> tmp( shape[0] );
@@ -539,19 +1101,46 @@ internalSeparableConvolveMultiArrayTmp(
 
     TmpAcessor acc;
 
+    // whenever the kernel allows, process several neighboring lines at once
+    // (see convolveLineBundle())
+    typedef typename SNavigator::iterator SLineIterator;
+    typedef typename DNavigator::iterator DLineIterator;
+    std::vector<SLineIterator> slines;
+    std::vector<DLineIterator> dlines;
+    ArrayVector<TmpType> buffer;
+    ArrayVector<SumType> sum;
+
     {
         // only operate on first dimension here
         SNavigator snav( si, shape, 0 );
         DNavigator dnav( di, shape, 0 );
 
-        for( ; snav.hasMore(); snav++, dnav++ )
+        if(canConvolveLineBundle(*kit, shape[0]))
         {
-             // first copy source to tmp for maximum cache efficiency
-             copyLine(snav.begin(), snav.end(), src, tmp.begin(), acc);
+            while(snav.hasMore())
+            {
+                slines.clear();
+                dlines.clear();
+                for( ; snav.hasMore() && slines.size() < ConvolveLineBundleSize; snav++, dnav++ )
+                {
+                    slines.push_back(snav.begin());
+                    dlines.push_back(dnav.begin());
+                }
+                convolveLineBundle(&slines[0], src, &dlines[0], dest,
+                                   (int)slines.size(), (int)shape[0], *kit, buffer, sum);
+            }
+        }
+        else
+        {
+            for( ; snav.hasMore(); snav++, dnav++ )
+            {
+                 // first copy source to tmp for maximum cache efficiency
+                 copyLine(snav.begin(), snav.end(), src, tmp.begin(), acc);
 
-             convolveLine(srcIterRange(tmp.begin(), tmp.end(), acc),
-                          destIter( dnav.begin(), dest ),
-                          kernel1d( *kit ) );
+                 convolveLine(srcIterRange(tmp.begin(), tmp.end(), acc),
+                              destIter( dnav.begin(), dest ),
+                              kernel1d( *kit ) );
+            }
         }
         ++kit;
     }
@@ -561,6 +1150,19 @@ internalSeparableConvolveMultiArrayTmp(
     {
         DNavigator dnav( di, shape, d );
 
+        if(canConvolveLineBundle(*kit, shape[d]))
+        {
+            while(dnav.hasMore())
+            {
+                dlines.clear();
+                for( ; dnav.hasMore() && dlines.size() < ConvolveLineBundleSize; dnav++ )
+                    dlines.push_back(dnav.begin());
+                convolveLineBundle(&dlines[0], dest, &dlines[0], dest,
+                                   (int)dlines.size(), (int)shape[d], *kit, buffer, sum);
+            }
+            continue;
+        }
+
         tmp.resize( shape[d] );
 
         for( ; dnav.hasMore(); dnav++ )
@@ -623,60 +1225,498 @@ internalSeparableConvolveSubarray(
     TmpAcessor acc;
 
     {
-        // only operate on first dimension here
-        SNavigator snav( si, sstart, sstop, axisorder[0]);
-        TNavigator tnav( tmp.traverser_begin(), dstart, dstop, axisorder[0]);
+        // only operate on first dimension here
+        SNavigator snav( si, sstart, sstop, axisorder[0]);
+        TNavigator tnav( tmp.traverser_begin(), dstart, dstop, axisorder[0]);
+
+        ArrayVector<TmpType> tmpline(sstop[axisorder[0]] - sstart[axisorder[0]]);
+
+        int lstart = start[axisorder[0]] - sstart[axisorder[0]];
+        int lstop  = lstart + (stop[axisorder[0]] - start[axisorder[0]]);
+
+        for( ; snav.hasMore(); snav++, tnav++ )
+        {
+            // first copy source to tmp for maximum cache efficiency
+            copyLine(snav.begin(), snav.end(), src, tmpline.begin(), acc);
+
+            convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
+                         destIter(tnav.begin(), acc),
+                         kernel1d( kit[axisorder[0]] ), lstart, lstop);
+        }
+    }
+
+    // operate on further dimensions
+    for( int d = 1; d < N; ++d)
+    {
+        TNavigator tnav( tmp.traverser_begin(), dstart, dstop, axisorder[d]);
+
+        ArrayVector<TmpType> tmpline(dstop[axisorder[d]] - dstart[axisorder[d]]);
+
+        int lstart = start[axisorder[d]] - sstart[axisorder[d]];
+        int lstop  = lstart + (stop[axisorder[d]] - start[axisorder[d]]);
+
+        for( ; tnav.hasMore(); tnav++ )
+        {
+            // first copy source to tmp because convolveLine() cannot work in-place
+            copyLine(tnav.begin(), tnav.end(), acc, tmpline.begin(), acc );
+
+            convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
+                         destIter( tnav.begin() + lstart, acc ),
+                         kernel1d( kit[axisorder[d]] ), lstart, lstop);
+        }
+
+        dstart[axisorder[d]] = lstart;
+        dstop[axisorder[d]] = lstop;
+    }
+
+    copyMultiArray(tmp.traverser_begin()+dstart, stop-start, acc, di, dest);
+}
+
+
+/********************************************************/
+/*                                                      */
+/*          internalSeparableConvolveTiled              */
+/*                                                      */
+/********************************************************/
+
+    // Compute the ROI [start, stop) tile by tile, each tile with all axis
+    // passes before moving on. Tiles are independent and run in parallel.
+    // A tile is convolved together with its halo as if it were an array of
+    // its own, which is exact for all positions that are at least a kernel
+    // radius away from the halo's end (unless the halo ends at the array
+    // border, where the border treatment is then the same as for the full
+    // array). Wrapped axes are never split for this reason.
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+internalSeparableConvolveTiled(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest, KernelIterator kit,
+                      SrcShape const & start, SrcShape const & stop,
+                      SrcShape const & tileShape, int nThreads)
+{
+    enum { N = 1 + SrcIterator::level };
+
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAccessor;
+    typedef typename std::iterator_traits<KernelIterator>::value_type::value_type KernelValue;
+    typedef typename PromoteTraits<TmpType, KernelValue>::Promote SumType;
+
+    SrcShape tile(tileShape), tileCount;
+    for(int k=0; k<N; ++k)
+    {
+        if(tile[k] <= 0 || tile[k] > stop[k] - start[k] ||
+           kit[k].borderTreatment() == BORDER_TREATMENT_WRAP)
+            tile[k] = stop[k] - start[k];
+        tileCount[k] = (stop[k] - start[k] + tile[k] - 1) / tile[k];
+    }
+
+    parallel_foreach(nThreads, prod(tileCount),
+        [&](int /*threadId*/, MultiArrayIndex i)
+        {
+            SrcShape t;
+            ScanOrderToCoordinate<N>::exec(i, tileCount, t);
+            SrcShape tstart = start + t*tile,
+                     tstop  = min(tstart + tile, stop);
+
+            // the tile plus halo
+            SrcShape hstart, hstop;
+            bool useBundles = true;
+            for(int k=0; k<N; ++k)
+            {
+                if(kit[k].borderTreatment() == BORDER_TREATMENT_WRAP)
+                {
+                    hstart[k] = 0;
+                    hstop[k] = shape[k];
+                }
+                else
+                {
+                    hstart[k] = std::max<MultiArrayIndex>(0, tstart[k] - kit[k].right());
+                    hstop[k] = std::min<MultiArrayIndex>(shape[k], tstop[k] - kit[k].left());
+                }
+                useBundles = useBundles && canConvolveLineBundle(kit[k], hstop[k] - hstart[k]);
+            }
+
+            if(useBundles)
+            {
+                typedef MultiArray<N, TmpType> TmpArray;
+                typedef typename TmpArray::traverser TmpIterator;
+                typedef MultiArrayNavigator<SrcIterator, N> SNavigator;
+                typedef MultiArrayNavigator<TmpIterator, N> TNavigator;
+
+                SrcShape hshape(hstop - hstart), tbegin(tstart - hstart);
+                TmpArray tmp(hshape);
+                std::vector<typename SNavigator::iterator> slines;
+                std::vector<typename TNavigator::iterator> tlines;
+                ArrayVector<TmpType> buffer;
+                ArrayVector<SumType> sum;
+
+                // pass d only needs the tile's core along the axes
+                // that have already been processed
+                SrcShape lstart, lstop(hshape);
+                for(int d=0; d<N; ++d)
+                {
+                    SNavigator snav(si + hstart, lstart, lstop, d);
+                    TNavigator tnav(tmp.traverser_begin(), lstart, lstop, d);
+                    while(tnav.hasMore())
+                    {
+                        slines.clear();
+                        tlines.clear();
+                        for( ; tnav.hasMore() && tlines.size() < ConvolveLineBundleSize; snav++, tnav++)
+                        {
+                            slines.push_back(snav.begin());
+                            tlines.push_back(tnav.begin());
+                        }
+                        if(d == 0)
+                            convolveLineBundle(&slines[0], src, &tlines[0], TmpAccessor(),
+                                               (int)tlines.size(), (int)hshape[d], kit[d], buffer, sum);
+                        else
+                            convolveLineBundle(&tlines[0], TmpAccessor(), &tlines[0], TmpAccessor(),
+                                               (int)tlines.size(), (int)hshape[d], kit[d], buffer, sum);
+                    }
+                    lstart[d] = tbegin[d];
+                    lstop[d] = tbegin[d] + tstop[d] - tstart[d];
+                }
+                copyMultiArray(tmp.traverser_begin() + tbegin, tstop - tstart, TmpAccessor(),
+                               di + (tstart - start), dest);
+            }
+            else
+            {
+                // border treatments that change the kernel near the border
+                internalSeparableConvolveSubarray(si, shape, src, di + (tstart - start), dest,
+                                                  kit, tstart, tstop);
+            }
+        });
+}
+
+    // true if the memory regions of the two arrays overlap
+template <unsigned int N, class T1, class S1, class T2, class S2>
+bool
+arrayMemoryOverlaps(MultiArrayView<N, T1, S1> const & a, MultiArrayView<N, T2, S2> const & b)
+{
+    if(a.size() == 0 || b.size() == 0)
+        return false;
+    char const * a0 = reinterpret_cast<char const *>(a.data()),
+               * a1 = reinterpret_cast<char const *>(&a[a.shape() - 1]),
+               * b0 = reinterpret_cast<char const *>(b.data()),
+               * b1 = reinterpret_cast<char const *>(&b[b.shape() - 1]);
+    if(a1 < a0)
+        std::swap(a0, a1);
+    if(b1 < b0)
+        std::swap(b0, b1);
+    return a0 < b1 + sizeof(T2) && b0 < a1 + sizeof(T1);
+}
+
+template <class K>
+void
+scaleKernel(K & kernel, double a)
+{
+    for(int i = kernel.left(); i <= kernel.right(); ++i)
+        kernel[i] = detail::RequiresExplicitCast<typename K::value_type>::cast(kernel[i] * a);
+}
+
+/********************************************************/
+/*                                                      */
+/*             recursiveGaussianMultiArray              */
+/*                                                      */
+/********************************************************/
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void
+internalRecursiveGaussianMultiArray(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest,
+                      ArrayVector<RecursiveGaussianFilter> const & filters)
+{
+    enum { N = 1 + SrcIterator::level };
+    enum { L = ConvolveLineBundleSize };
+
+    typedef typename RecursiveGaussianTmpType<typename DestAccessor::value_type>::type TmpType;
+
+    typedef MultiArrayNavigator<SrcIterator, N> SNavigator;
+    typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+    typedef typename SNavigator::iterator SLineIterator;
+    typedef typename DNavigator::iterator DLineIterator;
+
+    // as in internalSeparableConvolveMultiArrayTmp(), neighboring lines
+    // are filtered together
+    std::vector<SLineIterator> slines;
+    std::vector<DLineIterator> dlines;
+    ArrayVector<TmpType> buffer;
+
+    {
+        // only operate on first dimension here
+        SNavigator snav( si, shape, 0 );
+        DNavigator dnav( di, shape, 0 );
+
+        while(snav.hasMore())
+        {
+            slines.clear();
+            dlines.clear();
+            for( ; snav.hasMore() && slines.size() < L; snav++, dnav++ )
+            {
+                slines.push_back(snav.begin());
+                dlines.push_back(dnav.begin());
+            }
+            filters[0].filterLines<L>(&slines[0], src, &dlines[0], dest,
+                                      (int)slines.size(), (int)shape[0], buffer);
+        }
+    }
+
+    // operate on further dimensions in-place
+    for( int d = 1; d < N; ++d )
+    {
+        DNavigator dnav( di, shape, d );
+
+        while(dnav.hasMore())
+        {
+            dlines.clear();
+            for( ; dnav.hasMore() && dlines.size() < L; dnav++ )
+                dlines.push_back(dnav.begin());
+            filters[d].filterLines<L>(&dlines[0], dest, &dlines[0], dest,
+                                      (int)dlines.size(), (int)shape[d], buffer);
+        }
+    }
+}
+
+    // Compute the Gaussian derivative of the given order along each axis
+    // (0 means smoothing) with recursive filters. Derivatives are scaled
+    // according to the step size, as in the FIR case.
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void
+recursiveGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                            DestIterator di, DestAccessor dest,
+                            SrcShape const & orders,
+                            ConvolutionOptions<SrcShape::static_size> const & opt,
+                            const char * const function_name)
+{
+    enum { N = SrcShape::static_size };
+
+    typedef typename RecursiveGaussianTmpType<typename DestAccessor::value_type>::type TmpType;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAccessor;
+
+    typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
+    ArrayVector<RecursiveGaussianFilter> filters;
+    for(int k=0; k<N; ++k, ++params)
+        filters.push_back(RecursiveGaussianFilter(params.sigma_scaled(function_name, true), (unsigned int)orders[k],
+                                                  std::pow(params.step_size(), -(double)orders[k])));
+
+    SrcShape start(opt.from_point), stop(opt.to_point);
+    if(stop == SrcShape())
+    {
+        internalRecursiveGaussianMultiArray(si, shape, src, di, dest, filters);
+        return;
+    }
+
+    RelativeToAbsoluteCoordinate<N-1>::exec(shape, start);
+    RelativeToAbsoluteCoordinate<N-1>::exec(shape, stop);
+    for(int k=0; k<N; ++k)
+        vigra_precondition(0 <= start[k] && start[k] < stop[k] && stop[k] <= shape[k],
+          std::string(function_name) + "(): invalid subarray shape.");
+
+    // filter a box around the ROI that contains the filters' support
+    SrcShape boxStart, boxStop;
+    for(int k=0; k<N; ++k)
+    {
+        boxStart[k] = std::max<MultiArrayIndex>(0, start[k] - filters[k].radius());
+        boxStop[k]  = std::min<MultiArrayIndex>(shape[k], stop[k] + filters[k].radius());
+    }
+    MultiArray<N, TmpType> tmp(boxStop - boxStart);
+    internalRecursiveGaussianMultiArray(si + boxStart, tmp.shape(), src,
+                                        tmp.traverser_begin(), TmpAccessor(), filters);
+    copyMultiArray(tmp.traverser_begin() + (start - boxStart), stop - start, TmpAccessor(),
+                   di, dest);
+}
+
+template <class T>
+struct IsDoublePrecision
+{
+    static const bool value =
+        sizeof(typename NumericTraits<typename NumericTraits<T>::RealPromote>::ValueType) > sizeof(float);
+};
+
+template <class SrcAccessor, class DestAccessor>
+struct FFTGaussianApplicable
+{
+    static const bool value =
+        NumericTraits<typename SrcAccessor::value_type>::isScalar::value &&
+        NumericTraits<typename DestAccessor::value_type>::isScalar::value;
+};
+
+    // Decide how the Gaussian filters requested by 'opt' are computed (see
+    // ConvolutionOptions::convolutionMethod()). 'order' is the highest derivative
+    // order of the filters, and 'fft_applicable' tells if the pixel types admit
+    // FFT convolution.
+template <class DestType, class SrcShape>
+ConvolutionMethod
+gaussianConvolutionMethod(ConvolutionOptions<SrcShape::static_size> const & opt, SrcShape const & shape,
+                          unsigned int order, bool fft_applicable,
+                          const char * const function_name)
+{
+    enum { N = SrcShape::static_size };
+
+    ConvolutionMethod method = opt.convolution_method;
+    if(method == DirectConvolution)
+        return method;
+
+    // FIR filters are cheaper and more accurate for small scales
+    TinyVector<double, N> sigmas;
+    bool allow_recursive = true;
+    typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
+    for(int k=0; k<N; ++k, ++params)
+    {
+        sigmas[k] = params.sigma_scaled(function_name, true);
+        if(sigmas[k] < 1.0)
+            allow_recursive = false;
+    }
 
-        ArrayVector<TmpType> tmpline(sstop[axisorder[0]] - sstart[axisorder[0]]);
+    if(method == RecursiveConvolution)
+        return allow_recursive ? RecursiveConvolution : DirectConvolution;
 
-        int lstart = start[axisorder[0]] - sstart[axisorder[0]];
-        int lstop  = lstart + (stop[axisorder[0]] - start[axisorder[0]]);
+#ifndef HasFFTW3
+    vigra_precondition(method != FFTConvolution,
+        std::string(function_name) + "(): FFT convolution requires FFTW (compile with HasFFTW3 defined).");
+    fft_applicable = false;
+#endif
+    if(method == FFTConvolution)
+    {
+        vigra_precondition(fft_applicable,
+            std::string(function_name) + "(): FFT convolution requires scalar source and destination.");
+        return method;
+    }
 
-        for( ; snav.hasMore(); snav++, tnav++ )
+    // AutomaticConvolution: estimate the costs for the region actually computed
+    SrcShape region(shape);
+    if(opt.to_point != SrcShape())
+    {
+        SrcShape start(opt.from_point), stop(opt.to_point);
+        RelativeToAbsoluteCoordinate<N-1>::exec(shape, start);
+        RelativeToAbsoluteCoordinate<N-1>::exec(shape, stop);
+        for(int k=0; k<N; ++k)
         {
-            // first copy source to tmp for maximum cache efficiency
-            copyLine(snav.begin(), snav.end(), src, tmpline.begin(), acc);
-
-            convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
-                         destIter(tnav.begin(), acc),
-                         kernel1d( kit[axisorder[0]] ), lstart, lstop);
+            MultiArrayIndex radius = ConvolutionCostModel::gaussianRadius(sigmas[k], order, opt.window_ratio);
+            region[k] = std::min<MultiArrayIndex>(shape[k], stop[k] + radius) -
+                        std::max<MultiArrayIndex>(0, start[k] - radius);
         }
     }
+    int threads = opt.isTiled()
+                      ? ParallelOptions().numThreads(opt.tile_threads).getActualNumThreads()
+                      : 1;
+    return ConvolutionCostModel::global().select(TinyVector<MultiArrayIndex, N>(region), sigmas, order,
+                                                 opt.window_ratio, IsDoublePrecision<DestType>::value,
+                                                 threads, allow_recursive, fft_applicable);
+}
 
-    // operate on further dimensions
-    for( int d = 1; d < N; ++d)
-    {
-        TNavigator tnav( tmp.traverser_begin(), dstart, dstop, axisorder[d]);
+#ifdef HasFFTW3
 
-        ArrayVector<TmpType> tmpline(dstop[axisorder[d]] - dstart[axisorder[d]]);
+    // Compute the Gaussian derivative of the given order along each axis by
+    // convolving with the N-dimensional kernel (the outer product of the 1D
+    // kernels of the direct method) in the Fourier domain.
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void
+fftGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest,
+                      SrcShape const & orders,
+                      ConvolutionOptions<SrcShape::static_size> const & opt,
+                      const char * const function_name, VigraTrueType /* applicable */)
+{
+    enum { N = SrcShape::static_size };
 
-        int lstart = start[axisorder[d]] - sstart[axisorder[d]];
-        int lstop  = lstart + (stop[axisorder[d]] - start[axisorder[d]]);
+    typedef typename IfBool<IsDoublePrecision<typename DestAccessor::value_type>::value,
+                            double, float>::type Real;
+    typedef typename AccessorTraits<Real>::default_accessor RealAccessor;
 
-        for( ; tnav.hasMore(); tnav++ )
-        {
-            // first copy source to tmp because convolveLine() cannot work in-place
-            copyLine(tnav.begin(), tnav.end(), acc, tmpline.begin(), acc );
+    typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
+    ArrayVector<Kernel1D<double> > kernels(N);
+    SrcShape kernelShape;
+    for(int k=0; k<N; ++k, ++params)
+    {
+        kernels[k].initGaussianDerivative(params.sigma_scaled(function_name, true), orders[k],
+                                          1.0, opt.window_ratio);
+        scaleKernel(kernels[k], std::pow(params.step_size(), -(double)orders[k]));
+        kernelShape[k] = kernels[k].size();
+    }
 
-            convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
-                         destIter( tnav.begin() + lstart, acc ),
-                         kernel1d( kit[axisorder[d]] ), lstart, lstop);
-        }
+    MultiArray<N, Real> kernel(kernelShape);
+    MultiCoordinateIterator<N> c(kernelShape), cend = c.getEndIterator();
+    for(; c != cend; ++c)
+    {
+        double v = 1.0;
+        for(int k=0; k<N; ++k)
+            v *= kernels[k][(*c)[k] + kernels[k].left()];
+        kernel[*c] = (Real)v;
+    }
 
-        dstart[axisorder[d]] = lstart;
-        dstop[axisorder[d]] = lstop;
+    SrcShape start, stop(shape);
+    if(opt.to_point != SrcShape())
+    {
+        start = opt.from_point;
+        stop = opt.to_point;
+        RelativeToAbsoluteCoordinate<N-1>::exec(shape, start);
+        RelativeToAbsoluteCoordinate<N-1>::exec(shape, stop);
+        for(int k=0; k<N; ++k)
+            vigra_precondition(0 <= start[k] && start[k] < stop[k] && stop[k] <= shape[k],
+              std::string(function_name) + "(): invalid subarray shape.");
     }
 
-    copyMultiArray(tmp.traverser_begin()+dstart, stop-start, acc, di, dest);
+    // convolve a box around the ROI that contains the kernel's support
+    SrcShape boxStart, boxStop;
+    for(int k=0; k<N; ++k)
+    {
+        boxStart[k] = std::max<MultiArrayIndex>(0, start[k] + kernels[k].left());
+        boxStop[k]  = std::min<MultiArrayIndex>(shape[k], stop[k] + kernels[k].right());
+    }
+    MultiArray<N, Real> in(boxStop - boxStart), out(boxStop - boxStart);
+    copyMultiArray(si + boxStart, in.shape(), src, in.traverser_begin(), RealAccessor());
+    ParallelOptions popt;
+    popt.numThreads(opt.isTiled() ? opt.tile_threads : 1);
+    convolveFFT(in, kernel, out, popt);
+    copyMultiArray(out.traverser_begin() + (start - boxStart), stop - start, RealAccessor(),
+                   di, dest);
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void
+fftGaussianMultiArray(SrcIterator, SrcShape const &, SrcAccessor,
+                      DestIterator, DestAccessor,
+                      SrcShape const &,
+                      ConvolutionOptions<SrcShape::static_size> const &,
+                      const char * const function_name, VigraFalseType /* applicable */)
+{
+    vigra_precondition(false,
+        std::string(function_name) + "(): FFT convolution requires scalar source and destination.");
+}
 
-template <class K>
+#endif // HasFFTW3
+
+    // Compute a Gaussian filter of the given derivative orders along each
+    // axis with the given method.
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor>
 void
-scaleKernel(K & kernel, double a)
+gaussianMultiArrayByMethod(ConvolutionMethod method,
+                           SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                           DestIterator di, DestAccessor dest,
+                           SrcShape const & orders,
+                           ConvolutionOptions<SrcShape::static_size> const & opt,
+                           const char * const function_name)
 {
-    for(int i = kernel.left(); i <= kernel.right(); ++i)
-        kernel[i] = detail::RequiresExplicitCast<typename K::value_type>::cast(kernel[i] * a);
+#ifdef HasFFTW3
+    if(method == FFTConvolution)
+    {
+        typedef typename IfBool<FFTGaussianApplicable<SrcAccessor, DestAccessor>::value,
+                                VigraTrueType, VigraFalseType>::type Applicable;
+        fftGaussianMultiArray(si, shape, src, di, dest, orders, opt, function_name, Applicable());
+        return;
+    }
+#endif
+    vigra_precondition(method == RecursiveConvolution,
+        "gaussianMultiArrayByMethod(): internal error: unsupported method.");
+    recursiveGaussianMultiArray(si, shape, src, di, dest, orders, opt, function_name);
 }
 
 
@@ -719,6 +1759,12 @@ scaleKernel(K & kernel, double a)
     interpreted relative to the end of the respective dimension
     (i.e. <tt>if(stop[k] < 0) stop[k] += source.shape(k);</tt>).
 
+    Alternatively, the ROI can be passed in a \ref vigra::ConvolutionOptions object.
+    If its <tt>tileShape()</tt> is set, the array is processed tile by tile:
+    all axis passes are performed for one tile (including the halo needed by the
+    kernels) before the next tile is considered, and tiles are processed in parallel.
+    This reduces memory traffic considerably when the array doesn't fit into the cache.
+
     <b> Declarations:</b>
 
     pass arbitrary-dimensional array views:
@@ -745,6 +1791,25 @@ scaleKernel(K & kernel, double a)
                                     Kernel1D<T> const & kernel,
                                     typename MultiArrayShape<N>::type const & start = typename MultiArrayShape<N>::type(),
                                     typename MultiArrayShape<N>::type const & stop = typename MultiArrayShape<N>::type());
+
+        // take ROI and tiling from the options object
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class KernelIterator>
+        void
+        separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    KernelIterator kernels,
+                                    ConvolutionOptions<N> const & opt);
+
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class T>
+        void
+        separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    Kernel1D<T> const & kernel,
+                                    ConvolutionOptions<N> const & opt);
     }
     \endcode
 
@@ -827,6 +1892,9 @@ scaleKernel(K & kernel, double a)
 
     // only smooth the given ROI (ignore 5 pixels on all sides of the array)
     separableConvolveMultiArray(source, destROI, gauss, Shape3(5,5,5), Shape3(-5,-5,-5));
+
+    // process the array in tiles of 64^3 pixels, using all available cores
+    separableConvolveMultiArray(source, dest, gauss, ConvolutionOptions<3>().tileShape(64));
     \endcode
 
     \deprecatedUsage{separableConvolveMultiArray}
@@ -913,6 +1981,53 @@ separableConvolveMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor
     separableConvolveMultiArray( s, shape, src, d, dest, kernels.begin(), start, stop);
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+separableConvolveMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                             DestIterator d, DestAccessor dest,
+                             KernelIterator kernels,
+                             ConvolutionOptions<SrcShape::static_size> const & opt)
+{
+    if(!opt.isTiled())
+    {
+        separableConvolveMultiArray(s, shape, src, d, dest, kernels, opt.from_point, opt.to_point);
+        return;
+    }
+
+    enum { N = 1 + SrcIterator::level };
+    SrcShape start(opt.from_point), stop(opt.to_point);
+    if(stop != SrcShape())
+    {
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, start);
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, stop);
+
+        for(int k=0; k<N; ++k)
+            vigra_precondition(0 <= start[k] && start[k] < stop[k] && stop[k] <= shape[k],
+              "separableConvolveMultiArray(): invalid subarray shape.");
+    }
+    else
+    {
+        start = SrcShape();
+        stop = shape;
+    }
+    detail::internalSeparableConvolveTiled(s, shape, src, d, dest, kernels, start, stop,
+                                           opt.tile_shape, opt.tile_threads);
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class T>
+inline void
+separableConvolveMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                             DestIterator d, DestAccessor dest,
+                             Kernel1D<T> const & kernel,
+                             ConvolutionOptions<SrcShape::static_size> const & opt)
+{
+    ArrayVector<Kernel1D<T> > kernels(shape.size(), kernel);
+
+    separableConvolveMultiArray( s, shape, src, d, dest, kernels.begin(), opt);
+}
+
 template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class KernelIterator>
 inline void
@@ -1003,6 +2118,57 @@ separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
     separableConvolveMultiArray(source, dest, kernel, SHAPE(), SHAPE());
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class KernelIterator>
+void
+separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            KernelIterator kit,
+                            ConvolutionOptions<N> opt)
+{
+    if(opt.to_point != typename MultiArrayShape<N>::type())
+    {
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(source.shape(), opt.from_point);
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(source.shape(), opt.to_point);
+        vigra_precondition(dest.shape() == (opt.to_point - opt.from_point),
+            "separableConvolveMultiArray(): shape mismatch between ROI and output.");
+    }
+    else
+    {
+        vigra_precondition(source.shape() == dest.shape(),
+            "separableConvolveMultiArray(): shape mismatch between input and output.");
+    }
+
+    if(opt.isTiled() && detail::arrayMemoryOverlaps(source, dest))
+    {
+        // tiles must not overwrite the halos of their neighbors
+        MultiArray<N, T1> tmp(source);
+        separableConvolveMultiArray(tmp, dest, kit, opt);
+    }
+    else
+    {
+        separableConvolveMultiArray(source.traverser_begin(), source.shape(),
+                                    typename AccessorTraits<T1>::default_const_accessor(),
+                                    dest.traverser_begin(),
+                                    typename AccessorTraits<T2>::default_accessor(),
+                                    kit, opt);
+    }
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class T>
+inline void
+separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            Kernel1D<T> const & kernel,
+                            ConvolutionOptions<N> const & opt)
+{
+    ArrayVector<Kernel1D<T> > kernels(N, kernel);
+    separableConvolveMultiArray(source, dest, kernels.begin(), opt);
+}
+
 /********************************************************/
 /*                                                      */
 /*            convolveMultiArrayOneDimension            */
@@ -1340,6 +2506,16 @@ gaussianSmoothMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src
 {
     static const int N = SrcShape::static_size;
 
+    ConvolutionMethod method =
+        detail::gaussianConvolutionMethod<typename DestAccessor::value_type>(opt, shape, 0,
+            detail::FFTGaussianApplicable<SrcAccessor, DestAccessor>::value, function_name);
+    if(method != DirectConvolution)
+    {
+        detail::gaussianMultiArrayByMethod(method, s, shape, src, d, dest, SrcShape(),
+                                           opt, function_name);
+        return;
+    }
+
     typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
     ArrayVector<Kernel1D<double> > kernels(N);
 
@@ -1347,7 +2523,7 @@ gaussianSmoothMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src
         kernels[dim].initGaussian(params.sigma_scaled(function_name, true),
                                   1.0, opt.window_ratio);
 
-    separableConvolveMultiArray(s, shape, src, d, dest, kernels.begin(), opt.from_point, opt.to_point);
+    separableConvolveMultiArray(s, shape, src, d, dest, kernels.begin(), opt);
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -1403,8 +2579,18 @@ gaussianSmoothMultiArray(MultiArrayView<N, T1, S1> const & source,
             "gaussianSmoothMultiArray(): shape mismatch between input and output.");
     }
 
-    gaussianSmoothMultiArray( srcMultiArrayRange(source),
-                              destMultiArray(dest), opt );
+    if(opt.isTiled() && detail::arrayMemoryOverlaps(source, dest))
+    {
+        // tiles must not overwrite the halos of their neighbors
+        MultiArray<N, T1> tmp(source);
+        gaussianSmoothMultiArray( srcMultiArrayRange(tmp),
+                                  destMultiArray(dest), opt );
+    }
+    else
+    {
+        gaussianSmoothMultiArray( srcMultiArrayRange(source),
+                                  destMultiArray(dest), opt );
+    }
 }
 
 template <unsigned int N, class T1, class S1,
@@ -1418,6 +2604,110 @@ gaussianSmoothMultiArray(MultiArrayView<N, T1, S1> const & source,
     gaussianSmoothMultiArray( source, dest, opt.stdDev(sigma) );
 }
 
+/********************************************************/
+/*                                                      */
+/*            calibrateConvolutionCostModel             */
+/*                                                      */
+/********************************************************/
+
+#ifndef DOXYGEN // doxygen documents these functions in the class
+
+template <class T>
+double
+ConvolutionCostModel::timeGaussianSmoothing(MultiArrayView<3, T> const & data, MultiArrayView<3, T> res,
+                                            double sigma, ConvolutionMethod method)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    double best = 0.0;
+    for(int k=0; k<3; ++k)
+    {
+        Clock::time_point start = Clock::now();
+        gaussianSmoothMultiArray(data, res, sigma, ConvolutionOptions<3>().convolutionMethod(method));
+        double t = std::chrono::duration<double>(Clock::now() - start).count();
+        if(k == 0 || t < best)
+            best = t;
+    }
+    return best;
+}
+
+template <class T>
+void
+ConvolutionCostModel::calibrateImpl(int p)
+{
+    typedef MultiArrayShape<3>::type Shape;
+
+    Shape shape(64);
+    MultiArray<3, T> data(shape), res(shape);
+    for(MultiArrayIndex k=0; k<data.size(); ++k)
+        data[k] = (T)((k*7919) % 256);
+    double passes = 3.0*data.size();
+
+    // two kernel sizes separate the per-tap from the per-pass costs
+    double sigma1 = 1.0, sigma2 = 6.0;
+    double t1 = timeGaussianSmoothing<T>(data, res, sigma1, DirectConvolution),
+           t2 = timeGaussianSmoothing<T>(data, res, sigma2, DirectConvolution);
+    int taps1 = 2*gaussianRadius(sigma1, 0) + 1,
+        taps2 = 2*gaussianRadius(sigma2, 0) + 1;
+    direct_tap[p]  = std::max(0.0, (t2 - t1) / (passes*(taps2 - taps1)));
+    direct_pass[p] = std::max(0.0, t1 / passes - direct_tap[p]*taps1);
+
+    double sigma3 = 4.0;
+    double t3 = timeGaussianSmoothing<T>(data, res, sigma3, RecursiveConvolution);
+    recursive_pass[p] = t3 / (passes*(1.0 + (8.0*sigma3 + 8.0) / shape[0]));
+
+#ifdef HasFFTW3
+    double sigma4 = 2.0;
+    double t4 = timeGaussianSmoothing<T>(data, res, sigma4, FFTConvolution);
+    double padded = std::pow((double)fftPaddedSize(shape[0] + 2*gaussianRadius(sigma4, 0)), 3.0);
+    fft_element[p] = t4 / (3.0*padded*std::log(padded)/std::log(2.0));
+#endif
+}
+
+inline void
+ConvolutionCostModel::calibrate()
+{
+    calibrateImpl<float>(0);
+    calibrateImpl<double>(1);
+}
+
+#endif // DOXYGEN
+
+/** \brief Calibrate a \ref ConvolutionCostModel (by default the global one) for the present machine.
+
+    If <tt>cacheFile</tt> names a file written by an earlier call, the coefficients
+    are simply read from there. Otherwise, they are measured by
+    <tt>model.calibrate()</tt> and written to <tt>cacheFile</tt>
+    (unless it is empty), so that the measurement is done only once per machine.
+    Since the global model is shared, call this function before starting threads that
+    use the <tt>AutomaticConvolution</tt> mode.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_convolution.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    calibrateConvolutionCostModel("convolution_costs.txt");
+
+    MultiArray<3, float> volume(Shape3(200, 200, 100)), smoothed(volume.shape());
+    ...
+    // use the fastest algorithm for the given scale and array shape
+    gaussianSmoothMultiArray(volume, smoothed, 8.0,
+                             ConvolutionOptions<3>().convolutionMethod(AutomaticConvolution));
+    \endcode
+*/
+inline void
+calibrateConvolutionCostModel(std::string const & cacheFile = std::string(),
+                              ConvolutionCostModel & model = ConvolutionCostModel::global())
+{
+    if(!cacheFile.empty() && model.load(cacheFile))
+        return;
+    model.calibrate();
+    if(!cacheFile.empty())
+        model.save(cacheFile);
+}
+
 
 /********************************************************/
 /*                                                      */
@@ -1564,6 +2854,23 @@ gaussianGradientMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor s
     vigra_precondition(N == (int)dest.size(di),
         "gaussianGradientMultiArray(): Wrong number of channels in output array.");
 
+    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
+
+    ConvolutionMethod method =
+        detail::gaussianConvolutionMethod<DestValueType>(opt, shape, 1,
+            detail::FFTGaussianApplicable<SrcAccessor, ElementAccessor>::value, function_name);
+    if(method != DirectConvolution)
+    {
+        for (int dim = 0; dim < N; ++dim)
+        {
+            SrcShape orders;
+            orders[dim] = 1;
+            detail::gaussianMultiArrayByMethod(method, si, shape, src, di, ElementAccessor(dim, dest),
+                                               orders, opt, function_name);
+        }
+        return;
+    }
+
     ParamType params = opt.scaleParams();
     ParamType params2(params);
 
@@ -1574,16 +2881,13 @@ gaussianGradientMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor s
         plain_kernels[dim].initGaussian(sigma, 1.0, opt.window_ratio);
     }
 
-    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
-
     // compute gradient components
     for (int dim = 0; dim < N; ++dim, ++params2)
     {
         ArrayVector<Kernel1D<KernelType> > kernels(plain_kernels);
         kernels[dim].initGaussianDerivative(params2.sigma_scaled(), 1, 1.0, opt.window_ratio);
         detail::scaleKernel(kernels[dim], 1.0 / params2.step_size());
-        separableConvolveMultiArray(si, shape, src, di, ElementAccessor(dim, dest), kernels.begin(),
-                                    opt.from_point, opt.to_point);
+        separableConvolveMultiArray(si, shape, src, di, ElementAccessor(dim, dest), kernels.begin(), opt);
     }
 }
 
@@ -2085,6 +3389,39 @@ laplacianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccesso
     static const int N = SrcShape::static_size;
     typedef typename ConvolutionOptions<N>::ScaleIterator ParamType;
 
+    SrcShape dshape(shape);
+    if(opt.to_point != SrcShape())
+        dshape = opt.to_point - opt.from_point;
+
+    MultiArray<N, KernelType> derivative(dshape);
+
+    ConvolutionMethod method =
+        detail::gaussianConvolutionMethod<DestType>(opt, shape, 2,
+            detail::FFTGaussianApplicable<SrcAccessor, DestAccessor>::value,
+            "laplacianOfGaussianMultiArray");
+    if(method != DirectConvolution)
+    {
+        for (int dim = 0; dim < N; ++dim)
+        {
+            SrcShape orders;
+            orders[dim] = 2;
+            if (dim == 0)
+            {
+                detail::gaussianMultiArrayByMethod(method, si, shape, src, di, dest, orders, opt,
+                                                   "laplacianOfGaussianMultiArray");
+            }
+            else
+            {
+                detail::gaussianMultiArrayByMethod(method, si, shape, src,
+                                                   derivative.traverser_begin(), DerivativeAccessor(),
+                                                   orders, opt, "laplacianOfGaussianMultiArray");
+                combineTwoMultiArrays(di, dshape, dest, derivative.traverser_begin(), DerivativeAccessor(),
+                                      di, dest, Arg1() + Arg2() );
+            }
+        }
+        return;
+    }
+
     ParamType params = opt.scaleParams();
     ParamType params2(params);
 
@@ -2095,12 +3432,6 @@ laplacianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccesso
         plain_kernels[dim].initGaussian(sigma, 1.0, opt.window_ratio);
     }
 
-    SrcShape dshape(shape);
-    if(opt.to_point != SrcShape())
-        dshape = opt.to_point - opt.from_point;
-
-    MultiArray<N, KernelType> derivative(dshape);
-
     // compute 2nd derivatives and sum them up
     for (int dim = 0; dim < N; ++dim, ++params2)
     {
@@ -2111,13 +3442,13 @@ laplacianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccesso
         if (dim == 0)
         {
             separableConvolveMultiArray( si, shape, src,
-                                         di, dest, kernels.begin(), opt.from_point, opt.to_point);
+                                         di, dest, kernels.begin(), opt);
         }
         else
         {
             separableConvolveMultiArray( si, shape, src,
                                          derivative.traverser_begin(), DerivativeAccessor(),
-                                         kernels.begin(), opt.from_point, opt.to_point);
+                                         kernels.begin(), opt);
             combineTwoMultiArrays(di, dshape, dest, derivative.traverser_begin(), DerivativeAccessor(),
                                   di, dest, Arg1() + Arg2() );
         }
@@ -2333,11 +3664,11 @@ gaussianDivergenceMultiArray(Iterator vectorField, Iterator vectorFieldEnd,
         kernels[k].initGaussianDerivative(sigmas[k], 1, 1.0, opt.window_ratio);
         if(k == 0)
         {
-            separableConvolveMultiArray(*vectorField, divergence, kernels.begin(), opt.from_point, opt.to_point);
+            separableConvolveMultiArray(*vectorField, divergence, kernels.begin(), opt);
         }
         else
         {
-            separableConvolveMultiArray(*vectorField, tmpDeriv, kernels.begin(), opt.from_point, opt.to_point);
+            separableConvolveMultiArray(*vectorField, tmpDeriv, kernels.begin(), opt);
             divergence += tmpDeriv;
         }
         kernels[k].initGaussian(sigmas[k], 1.0, opt.window_ratio);
@@ -2524,6 +3855,28 @@ hessianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor
     vigra_precondition(M == (int)dest.size(di),
         "hessianOfGaussianMultiArray(): Wrong number of channels in output array.");
 
+    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
+
+    ConvolutionMethod method =
+        detail::gaussianConvolutionMethod<DestValueType>(opt, shape, 2,
+            detail::FFTGaussianApplicable<SrcAccessor, ElementAccessor>::value,
+            "hessianOfGaussianMultiArray");
+    if(method != DirectConvolution)
+    {
+        for (int b=0, i=0; i<N; ++i)
+        {
+            for (int j=i; j<N; ++j, ++b)
+            {
+                SrcShape orders;
+                orders[i] += 1;
+                orders[j] += 1;
+                detail::gaussianMultiArrayByMethod(method, si, shape, src, di, ElementAccessor(b, dest),
+                                                   orders, opt, "hessianOfGaussianMultiArray");
+            }
+        }
+        return;
+    }
+
     ParamType params_init = opt.scaleParams();
 
     ArrayVector<Kernel1D<KernelType> > plain_kernels(N);
@@ -2534,8 +3887,6 @@ hessianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor
         plain_kernels[dim].initGaussian(sigma, 1.0, opt.window_ratio);
     }
 
-    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
-
     // compute elements of the Hessian matrix
     ParamType params_i(params_init);
     for (int b=0, i=0; i<N; ++i, ++params_i)
@@ -2556,7 +3907,7 @@ hessianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor
             detail::scaleKernel(kernels[i], 1 / params_i.step_size());
             detail::scaleKernel(kernels[j], 1 / params_j.step_size());
             separableConvolveMultiArray(si, shape, src, di, ElementAccessor(b, dest),
-                                        kernels.begin(), opt.from_point, opt.to_point);
+                                        kernels.begin(), opt);
         }
     }
 }
@@ -43,6 +43,11 @@
 #include "navigator.hxx"
 #include "copyimage.hxx"
 #include "threading.hxx"
+#include "threadpool.hxx"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace vigra {
 
@@ -398,6 +403,338 @@ fftwPlanExecute(fftwl_plan plan, FFTWComplex<long double> * in,  long double * o
     fftwl_execute_dft_c2r(plan, (fftwl_complex *)in, out);
 }
 
+inline int fftwImportWisdom(char const * filename, double)
+{
+    return fftw_import_wisdom_from_filename(filename);
+}
+
+inline int fftwImportWisdom(char const * filename, float)
+{
+    return fftwf_import_wisdom_from_filename(filename);
+}
+
+inline int fftwImportWisdom(char const * filename, long double)
+{
+    return fftwl_import_wisdom_from_filename(filename);
+}
+
+inline int fftwExportWisdom(char const * filename, double)
+{
+    return fftw_export_wisdom_to_filename(filename);
+}
+
+inline int fftwExportWisdom(char const * filename, float)
+{
+    return fftwf_export_wisdom_to_filename(filename);
+}
+
+inline int fftwExportWisdom(char const * filename, long double)
+{
+    return fftwl_export_wisdom_to_filename(filename);
+}
+
+inline int fftwAlignmentOf(double * p)
+{
+    return fftw_alignment_of(p);
+}
+
+inline int fftwAlignmentOf(float * p)
+{
+    return fftwf_alignment_of(p);
+}
+
+inline int fftwAlignmentOf(long double * p)
+{
+    return fftwl_alignment_of(p);
+}
+
+inline void fftwForgetWisdom(double)
+{
+    fftw_forget_wisdom();
+}
+
+inline void fftwForgetWisdom(float)
+{
+    fftwf_forget_wisdom();
+}
+
+inline void fftwForgetWisdom(long double)
+{
+    fftwl_forget_wisdom();
+}
+
+    // destroys a plan owned by a shared pointer (fftw_destroy_plan() is not thread-safe)
+template <class PlanType>
+struct FFTWPlanDeleter
+{
+    void operator()(void * plan) const
+    {
+        FFTWLock<> lock;
+        fftwPlanDestroy((PlanType)plan);
+    }
+};
+
+    // Process-wide cache of FFTW plans. Plans are only executed via the
+    // new-array interface (fftw_execute_dft() etc.), so a plan can be shared
+    // between all FFTWPlan objects whose arrays agree in precision, transform
+    // kind, shape, strides, in-place-ness, alignment, sign and planner flags.
+    // The cache has its own mutex, so that cache hits don't wait for
+    // planning in other threads (which holds the global FFTWLock).
+template <int DUMMY=0>
+class FFTWPlanCacheImpl
+{
+  public:
+    typedef std::vector<std::ptrdiff_t>     Key;
+    typedef VIGRA_SHARED_PTR<void>          Handle;
+
+    struct Entry
+    {
+        Handle plan;
+        std::size_t last_use;
+    };
+
+    typedef std::map<Key, Entry> Map;
+
+    static Handle find(Key const & key)
+    {
+        Lock lock;
+        if(!enabled_)
+            return Handle();
+        typename Map::iterator i = plans().find(key);
+        if(i == plans().end())
+            return Handle();
+        i->second.last_use = ++clock_;
+        return i->second.plan;
+    }
+
+        // returns the plan already stored under 'key' if another thread was faster
+    static Handle insert(Key const & key, Handle const & plan)
+    {
+        Lock lock;
+        if(!enabled_ || capacity_ == 0 || !plan)
+            return plan;
+        Entry & e = plans()[key];
+        if(!e.plan)
+            e.plan = plan;
+        e.last_use = ++clock_;
+        shrink(capacity_);
+        return e.plan;
+    }
+
+    static void enable(bool e)
+    {
+        Lock lock;
+        enabled_ = e;
+        if(!e)
+            plans().clear();
+    }
+
+    static bool isEnabled()
+    {
+        Lock lock;
+        return enabled_;
+    }
+
+    static void setCapacity(std::size_t c)
+    {
+        Lock lock;
+        capacity_ = c;
+        shrink(c);
+    }
+
+    static std::size_t capacity()
+    {
+        Lock lock;
+        return capacity_;
+    }
+
+    static std::size_t size()
+    {
+        Lock lock;
+        return plans().size();
+    }
+
+    static void clear()
+    {
+        Lock lock;
+        plans().clear();
+    }
+
+  private:
+#ifndef VIGRA_SINGLE_THREADED
+    struct Lock
+    {
+        threading::lock_guard<threading::mutex> guard_;
+
+        Lock()
+        : guard_(mutex_)
+        {}
+    };
+
+    static threading::mutex mutex_;
+#else
+    struct Lock
+    {};
+#endif
+
+    static Map & plans()
+    {
+        static Map map;
+        return map;
+    }
+
+        // evict least recently used plans (plans still held by an
+        // FFTWPlan remain alive until that object releases them)
+    static void shrink(std::size_t c)
+    {
+        while(plans().size() > c)
+        {
+            typename Map::iterator oldest = plans().begin();
+            for(typename Map::iterator i = plans().begin(); i != plans().end(); ++i)
+                if(i->second.last_use < oldest->second.last_use)
+                    oldest = i;
+            plans().erase(oldest);
+        }
+    }
+
+    static bool enabled_;
+    static std::size_t capacity_, clock_;
+};
+
+#ifndef VIGRA_SINGLE_THREADED
+template <int DUMMY>
+threading::mutex FFTWPlanCacheImpl<DUMMY>::mutex_;
+#endif
+
+template <int DUMMY>
+bool FFTWPlanCacheImpl<DUMMY>::enabled_ = true;
+
+template <int DUMMY>
+std::size_t FFTWPlanCacheImpl<DUMMY>::capacity_ = 128;
+
+template <int DUMMY>
+std::size_t FFTWPlanCacheImpl<DUMMY>::clock_ = 0;
+
+    // FFTW's threaded planner is a separate library for each precision:
+    // HasFFTW3Threads (libfftw3_threads), HasFFTW3FThreads (libfftw3f_threads),
+    // and HasFFTW3LThreads (libfftw3l_threads) enable it for double, float,
+    // and long double respectively.
+template <class Real>
+struct FFTWHasThreads
+{
+    static const bool value = false;
+};
+
+template <class Real>
+inline void fftwPlanWithThreads(int, Real)
+{}
+
+#ifdef HasFFTW3Threads
+
+template <>
+struct FFTWHasThreads<double>
+{
+    static const bool value = true;
+};
+
+inline void fftwPlanWithThreads(int threads, double)
+{
+    static bool initialized = (fftw_init_threads() != 0);
+    if(initialized)
+        fftw_plan_with_nthreads(threads);
+}
+
+#endif // HasFFTW3Threads
+
+#ifdef HasFFTW3FThreads
+
+template <>
+struct FFTWHasThreads<float>
+{
+    static const bool value = true;
+};
+
+inline void fftwPlanWithThreads(int threads, float)
+{
+    static bool initialized = (fftwf_init_threads() != 0);
+    if(initialized)
+        fftwf_plan_with_nthreads(threads);
+}
+
+#endif // HasFFTW3FThreads
+
+#ifdef HasFFTW3LThreads
+
+template <>
+struct FFTWHasThreads<long double>
+{
+    static const bool value = true;
+};
+
+inline void fftwPlanWithThreads(int threads, long double)
+{
+    static bool initialized = (fftwl_init_threads() != 0);
+    if(initialized)
+        fftwl_plan_with_nthreads(threads);
+}
+
+#endif // HasFFTW3LThreads
+
+    // Look up a plan in the cache or create it. 'threads' is only used when
+    // FFTW's threaded planner is available for the given precision.
+template <class Real, class I, class O>
+VIGRA_SHARED_PTR<void>
+fftwCachedPlan(int N, int * shape,
+               I * in,  int * itotal, int istride,
+               O * out, int * ototal, int ostride,
+               int sign, unsigned int planner_flags, int threads)
+{
+    typedef typename FFTWReal2Complex<Real>::plan_type PlanType;
+    typedef FFTWPlanCacheImpl<> Cache;
+
+    if(!FFTWHasThreads<Real>::value)
+        threads = 1;
+
+    typename Cache::Key key;
+    key.push_back(sizeof(Real));
+    key.push_back(IsSameType<I, Real>::value ? 0 : 1);
+    key.push_back(IsSameType<O, Real>::value ? 0 : 1);
+    key.push_back(sign);
+    key.push_back(planner_flags);
+    key.push_back(threads);
+    key.insert(key.end(), shape, shape + N);
+    key.insert(key.end(), itotal, itotal + N);
+    key.insert(key.end(), ototal, ototal + N);
+    key.push_back(istride);
+    key.push_back(ostride);
+    // the plan is only valid for arrays with the same in-place-ness and SIMD alignment
+    key.push_back((void*)in == (void*)out);
+    if((planner_flags & FFTW_UNALIGNED) == 0)
+    {
+        key.push_back(fftwAlignmentOf((Real*)in));
+        key.push_back(fftwAlignmentOf((Real*)out));
+    }
+
+    VIGRA_SHARED_PTR<void> res = Cache::find(key);
+    if(!res)
+    {
+        PlanType newPlan;
+        {
+            FFTWLock<> lock;
+            fftwPlanWithThreads(threads, Real());
+            newPlan = fftwPlanCreate(N, shape,
+                                     in, itotal, istride,
+                                     out, ototal, ostride,
+                                     sign, planner_flags);
+            fftwPlanWithThreads(1, Real());
+        }
+        if(newPlan != 0)
+            res = Cache::insert(key,
+                      VIGRA_SHARED_PTR<void>((void*)newPlan, FFTWPlanDeleter<PlanType>()));
+    }
+    return res;
+}
+
 template <int DUMMY>
 struct FFTWPaddingSize
 {
@@ -815,6 +1152,143 @@ fftwCorrespondingShapeC2R(TinyVector<T, N> shape, bool oddDimension0 = false)
     return shape;
 }
 
+/********************************************************/
+/*                                                      */
+/*               FFTWPlanCache, FFTW wisdom             */
+/*                                                      */
+/********************************************************/
+
+/** \brief Control the process-wide cache of FFTW plans.
+
+    Planning an FFT with <tt>FFTW_MEASURE</tt> or stronger flags can take seconds, and even
+    <tt>FFTW_ESTIMATE</tt> planning must hold a global lock because the FFTW planner is not
+    thread-safe. Therefore, \ref FFTWPlan (and thus \ref FFTWConvolvePlan, \ref fourierTransform()
+    and \ref convolveFFT()) looks up its plans in a process-wide cache first. Plans are
+    identified by precision, transform kind and direction, shape, strides, in-place-ness,
+    memory alignment, and planner flags. Cache hits are served under a separate lock, so
+    they don't wait for planning in other threads. When the cache is full, the least recently
+    used plan is evicted (it stays alive as long as some \ref FFTWPlan still uses it).
+
+    The cache is enabled by default and holds up to 128 plans.
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    FFTWPlanCache::setCapacity(512);  // many different shapes are expected
+    ...
+    FFTWPlanCache::clear();           // release all plans that are no longer in use
+    \endcode
+*/
+class FFTWPlanCache
+{
+  public:
+        /** Enable or disable the cache. Disabling also clears the cache.
+        */
+    static void enable(bool e = true)
+    {
+        detail::FFTWPlanCacheImpl<>::enable(e);
+    }
+
+        /** Check if plans are currently cached.
+        */
+    static bool isEnabled()
+    {
+        return detail::FFTWPlanCacheImpl<>::isEnabled();
+    }
+
+        /** Set the maximum number of cached plans (default: 128).
+            Zero means that no plans are cached.
+        */
+    static void setCapacity(std::size_t c)
+    {
+        detail::FFTWPlanCacheImpl<>::setCapacity(c);
+    }
+
+        /** Get the maximum number of cached plans.
+        */
+    static std::size_t capacity()
+    {
+        return detail::FFTWPlanCacheImpl<>::capacity();
+    }
+
+        /** Get the number of plans currently in the cache.
+        */
+    static std::size_t size()
+    {
+        return detail::FFTWPlanCacheImpl<>::size();
+    }
+
+        /** Remove all plans from the cache.
+        */
+    static void clear()
+    {
+        detail::FFTWPlanCacheImpl<>::clear();
+    }
+};
+
+/** \brief Load FFTW wisdom from a file.
+
+    FFTW remembers the results of <tt>FFTW_MEASURE</tt> (and stronger) planning in its
+    <a href="http://www.fftw.org/doc/Words-of-Wisdom_002dSaving-Plans.html">wisdom</a>.
+    When the wisdom of a previous run is imported at program start, planning the same
+    transforms again takes almost no time. Wisdom is separate for each precision,
+    so the template parameter <tt>Real</tt> (<tt>double</tt>, <tt>float</tt>, or
+    <tt>long double</tt>) selects which FFTW library receives the wisdom.
+
+    Returns <tt>false</tt> if the file doesn't exist or contains no valid wisdom
+    for the given precision.
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    importFFTWWisdom<float>("fftwf_wisdom.txt");  // at startup, a missing file is fine
+
+    FFTWPlan<3, float> plan(in, out, FFTW_MEASURE); // fast when wisdom exists
+    ...
+    exportFFTWWisdom<float>("fftwf_wisdom.txt");  // at shutdown
+    \endcode
+*/
+template <class Real>
+inline bool
+importFFTWWisdom(std::string const & filename)
+{
+    detail::FFTWLock<> lock;
+    return detail::fftwImportWisdom(filename.c_str(), Real()) != 0;
+}
+
+/** \brief Save the accumulated FFTW wisdom to a file.
+
+    See \ref importFFTWWisdom() for details. Returns <tt>false</tt> if the file
+    could not be written.
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+*/
+template <class Real>
+inline bool
+exportFFTWWisdom(std::string const & filename)
+{
+    detail::FFTWLock<> lock;
+    return detail::fftwExportWisdom(filename.c_str(), Real()) != 0;
+}
+
+/** \brief Discard the accumulated FFTW wisdom of the given precision.
+
+    Plans that already exist (including those in the \ref FFTWPlanCache) remain valid.
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+*/
+template <class Real>
+inline void
+forgetFFTWWisdom()
+{
+    detail::FFTWLock<> lock;
+    detail::fftwForgetWisdom(Real());
+}
+
 /********************************************************/
 /*                                                      */
 /*                       FFTWPlan                       */
@@ -856,8 +1330,11 @@ class FFTWPlan
     typedef typename FFTWComplex<Real>::complex_type Complex;
 
     PlanType plan;
+    VIGRA_SHARED_PTR<void> handle;  // owns 'plan', possibly shared with the FFTWPlanCache
+    ArrayVector<PlanType> line_plans;  // 1D passes when the transform is split between threads
+    ArrayVector<VIGRA_SHARED_PTR<void> > line_handles;
     Shape shape, instrides, outstrides;
-    int sign;
+    int sign, threads;
 
   public:
         /** \brief Create an empty plan.
@@ -865,7 +1342,32 @@ class FFTWPlan
             The plan can be initialized later by one of the init() functions.
         */
     FFTWPlan()
-    : plan(0)
+    : plan(0),
+      threads(1)
+    {}
+
+        /** \brief Create an empty plan that will use multiple threads.
+
+            The plan is initialized later by one of the init() functions, and all transforms
+            will be executed with <tt>options.getActualNumThreads()</tt> threads. When
+            VIGRA is compiled with <tt>HasFFTW3Threads</tt> resp. <tt>HasFFTW3FThreads</tt>
+            defined (and linked against <tt>libfftw3_threads</tt> resp. <tt>libfftw3f_threads</tt>),
+            FFTW's threaded planner is used for double resp. float transforms. Otherwise, multi-dimensional transforms are split into passes
+            of 1D transforms along each axis, and the 1D transforms of each pass are
+            distributed over a \ref ThreadPool.
+
+            \code
+            MultiArray<3, float> volume(Shape3(256, 256, 256));
+            MultiArray<3, FFTWComplex<float> > fourier(fftwCorrespondingShapeR2C(volume.shape()));
+
+            FFTWPlan<3, float> plan(ParallelOptions().numThreads(8));
+            plan.init(volume, fourier, FFTW_MEASURE);
+            plan.execute(volume, fourier);
+            \endcode
+        */
+    explicit FFTWPlan(ParallelOptions const & options)
+    : plan(0),
+      threads(options.getActualNumThreads())
     {}
 
         /** \brief Create a plan for a complex-to-complex transform.
@@ -880,7 +1382,8 @@ class FFTWPlan
     FFTWPlan(MultiArrayView<N, FFTWComplex<Real>, C1> in,
              MultiArrayView<N, FFTWComplex<Real>, C2> out,
              int SIGN, unsigned int planner_flags = FFTW_ESTIMATE)
-    : plan(0)
+    : plan(0),
+      threads(1)
     {
         init(in, out, SIGN, planner_flags);
     }
@@ -900,7 +1403,8 @@ class FFTWPlan
     FFTWPlan(MultiArrayView<N, Real, C1> in,
              MultiArrayView<N, FFTWComplex<Real>, C2> out,
              unsigned int planner_flags = FFTW_ESTIMATE)
-    : plan(0)
+    : plan(0),
+      threads(1)
     {
         init(in, out, planner_flags);
     }
@@ -920,7 +1424,8 @@ class FFTWPlan
     FFTWPlan(MultiArrayView<N, FFTWComplex<Real>, C1> in,
              MultiArrayView<N, Real, C2> out,
              unsigned int planner_flags = FFTW_ESTIMATE)
-    : plan(0)
+    : plan(0),
+      threads(1)
     {
         init(in, out, planner_flags);
     }
@@ -929,9 +1434,13 @@ class FFTWPlan
         */
     FFTWPlan(FFTWPlan const & other)
     : plan(other.plan),
-      sign(other.sign)
+      sign(other.sign),
+      threads(other.threads)
     {
         FFTWPlan & o = const_cast<FFTWPlan &>(other);
+        handle.swap(o.handle);
+        line_plans.swap(o.line_plans);
+        line_handles.swap(o.line_handles);
         shape.swap(o.shape);
         instrides.swap(o.instrides);
         outstrides.swap(o.outstrides);
@@ -946,10 +1455,14 @@ class FFTWPlan
         {
             FFTWPlan & o = const_cast<FFTWPlan &>(other);
             plan = o.plan;
+            handle.swap(o.handle);
+            line_plans.swap(o.line_plans);
+            line_handles.swap(o.line_handles);
             shape.swap(o.shape);
             instrides.swap(o.instrides);
             outstrides.swap(o.outstrides);
             sign = o.sign;
+            threads = o.threads;
             o.plan = 0; // act like std::auto_ptr
         }
         return *this;
@@ -958,10 +1471,7 @@ class FFTWPlan
         /** \brief Destructor.
         */
     ~FFTWPlan()
-    {
-        detail::FFTWLock<> lock;
-        detail::fftwPlanDestroy(plan);
-    }
+    {}
 
         /** \brief Init a complex-to-complex transform.
 
@@ -1061,6 +1571,65 @@ class FFTWPlan
     template <class MI, class MO>
     void executeImpl(MI ins, MO outs) const;
 
+    typedef MultiArrayView<N, Real, StridedArrayTag>                RView;
+    typedef MultiArrayView<N, FFTWComplex<Real>, StridedArrayTag>   CView;
+
+        // Split transforms: the first pass transforms the innermost axis from 'ins' to
+        // 'outs' (a complex-to-real transform does this last, after transforming the
+        // other axes of 'ins' in-place), the remaining passes work in-place.
+    template <class I, class O>
+    static VIGRA_SHARED_PTR<void>
+    createLinePlan(I * in, int istride, O * out, int ostride, int size,
+                   int SIGN, unsigned int planner_flags)
+    {
+        int n = size;
+        return detail::fftwCachedPlan<Real>(1, &n, in, &n, istride, out, &n, ostride,
+                                            SIGN, planner_flags | FFTW_UNALIGNED, 1);
+    }
+
+    template <class I, class O>
+    void executeLines(PlanType linePlan,
+                      MultiArrayView<N, I, StridedArrayTag> ins,
+                      MultiArrayView<N, O, StridedArrayTag> outs, int axis) const;
+
+    template <class I>
+    static void initLines(MultiArrayView<N, I, StridedArrayTag> ins, CView outs,
+                          Shape const & lshape, int SIGN, unsigned int planner_flags,
+                          ArrayVector<VIGRA_SHARED_PTR<void> > & res)
+    {
+        res.push_back(createLinePlan(ins.data(), ins.stride(N-1), outs.data(), outs.stride(N-1),
+                                     lshape[N-1], SIGN, planner_flags));
+        for(int k=N-2; k>=0; --k)
+            res.push_back(createLinePlan(outs.data(), outs.stride(k), outs.data(), outs.stride(k),
+                                         lshape[k], SIGN, planner_flags));
+    }
+
+    static void initLines(CView ins, RView outs,
+                          Shape const & lshape, int SIGN, unsigned int planner_flags,
+                          ArrayVector<VIGRA_SHARED_PTR<void> > & res)
+    {
+        for(int k=0; k<(int)N-1; ++k)
+            res.push_back(createLinePlan(ins.data(), ins.stride(k), ins.data(), ins.stride(k),
+                                         lshape[k], SIGN, planner_flags));
+        res.push_back(createLinePlan(ins.data(), ins.stride(N-1), outs.data(), outs.stride(N-1),
+                                     lshape[N-1], SIGN, planner_flags));
+    }
+
+    template <class I>
+    void executeSplit(MultiArrayView<N, I, StridedArrayTag> ins, CView outs) const
+    {
+        executeLines(line_plans[0], ins, outs, N-1);
+        for(int k=N-2; k>=0; --k)
+            executeLines(line_plans[N-1-k], outs, outs, k);
+    }
+
+    void executeSplit(CView ins, RView outs) const
+    {
+        for(int k=0; k<(int)N-1; ++k)
+            executeLines(line_plans[k], ins, ins, k);
+        executeLines(line_plans[N-1], ins, outs, N-1);
+    }
+
     void checkShapes(MultiArrayView<N, FFTWComplex<Real>, StridedArrayTag> in,
                      MultiArrayView<N, FFTWComplex<Real>, StridedArrayTag> out) const
     {
@@ -1112,16 +1681,28 @@ FFTWPlan<N, Real>::initImpl(MI ins, MO outs, int SIGN, unsigned int planner_flag
         ototal[j] = outs.stride(j-1) / outs.stride(j);
     }
 
+    VIGRA_SHARED_PTR<void> newHandle;
+    ArrayVector<VIGRA_SHARED_PTR<void> > newLineHandles;
+    if(threads > 1 && N > 1 && !detail::FFTWHasThreads<Real>::value)
     {
-        detail::FFTWLock<> lock;
-        PlanType newPlan = detail::fftwPlanCreate(N, newShape.begin(),
+        // no threaded FFTW: split the transform into passes of 1D transforms
+        initLines(ins, outs, newShape, SIGN, planner_flags, newLineHandles);
+    }
+    else
+    {
+        newHandle = detail::fftwCachedPlan<Real>(N, newShape.begin(),
                                       ins.data(), itotal.begin(), ins.stride(N-1),
                                       outs.data(), ototal.begin(), outs.stride(N-1),
-                                      SIGN, planner_flags);
-        detail::fftwPlanDestroy(plan);
-        plan = newPlan;
+                                      SIGN, planner_flags, threads);
     }
 
+    plan = (PlanType)newHandle.get();
+    handle.swap(newHandle);
+    line_plans.clear();
+    for(unsigned int k=0; k<newLineHandles.size(); ++k)
+        line_plans.push_back((PlanType)newLineHandles[k].get());
+    line_handles.swap(newLineHandles);
+
     shape.swap(newShape);
     instrides.swap(newIStrides);
     outstrides.swap(newOStrides);
@@ -1132,7 +1713,11 @@ template <unsigned int N, class Real>
 template <class MI, class MO>
 void FFTWPlan<N, Real>::executeImpl(MI ins, MO outs) const
 {
-    vigra_precondition(plan != 0, "FFTWPlan::execute(): plan is NULL.");
+    bool split = line_plans.size() > 0;
+    for(unsigned int k=0; k<line_plans.size(); ++k)
+        if(line_plans[k] == 0)
+            split = false;
+    vigra_precondition(plan != 0 || split, "FFTWPlan::execute(): plan is NULL.");
 
     typename MultiArrayShape<N>::type lshape(sign == FFTW_FORWARD
                                                 ? ins.shape()
@@ -1145,13 +1730,58 @@ void FFTWPlan<N, Real>::executeImpl(MI ins, MO outs) const
     vigra_precondition((outs.stride() == TinyVectorView<int, N>(outstrides.data())),
         "FFTWPlan::execute(): strides mismatch between plan and output data.");
 
-    detail::fftwPlanExecute(plan, ins.data(), outs.data());
+    if(split)
+        executeSplit(ins, outs);
+    else
+        detail::fftwPlanExecute(plan, ins.data(), outs.data());
 
     typedef typename MO::value_type V;
     if(sign == FFTW_BACKWARD)
         outs *= V(1.0) / Real(outs.size());
 }
 
+template <unsigned int N, class Real>
+template <class I, class O>
+void
+FFTWPlan<N, Real>::executeLines(PlanType linePlan,
+                                MultiArrayView<N, I, StridedArrayTag> ins,
+                                MultiArrayView<N, O, StridedArrayTag> outs, int axis) const
+{
+    typedef typename MultiArrayShape<N>::type IndexShape;
+
+    // all lines along 'axis' are enumerated in scan order of the remaining axes,
+    // neighboring lines form one task to keep the thread pool overhead low
+    IndexShape lineShape(ins.shape());
+    lineShape[axis] = 1;
+    MultiArrayIndex lineCount = prod(lineShape),
+                    chunkSize = std::max<MultiArrayIndex>(1, lineCount / (8*threads)),
+                    chunkCount = (lineCount + chunkSize - 1) / chunkSize;
+
+    parallel_foreach(threads, chunkCount,
+        [&](int /* thread_id */, MultiArrayIndex chunk)
+        {
+            MultiArrayIndex begin = chunk*chunkSize,
+                            end = std::min(begin + chunkSize, lineCount);
+            for(MultiArrayIndex l=begin; l<end; ++l)
+            {
+                MultiArrayIndex rest = l,
+                                ioffset = 0,
+                                ooffset = 0;
+                for(int d=(int)N-1; d>=0; --d)
+                {
+                    if(d == axis)
+                        continue;
+                    MultiArrayIndex c = rest % lineShape[d];
+                    rest /= lineShape[d];
+                    ioffset += c*ins.stride(d);
+                    ooffset += c*outs.stride(d);
+                }
+                detail::fftwPlanExecute(linePlan, ins.data() + ioffset, outs.data() + ooffset);
+            }
+        }
+    );
+}
+
 /********************************************************/
 /*                                                      */
 /*                  FFTWConvolvePlan                    */
@@ -1202,6 +1832,10 @@ class FFTWConvolvePlan
     RArray realArray, realKernel;
     CArray fourierArray, fourierKernel;
     bool useFourierKernel;
+    int threads;
+
+    template <unsigned int, class>
+    friend class FFTWConvolveWorkspace;
 
   public:
 
@@ -1212,7 +1846,19 @@ class FFTWConvolvePlan
             The plan can be initialized later by one of the init() functions.
         */
     FFTWConvolvePlan()
-    : useFourierKernel(false)
+    : useFourierKernel(false),
+      threads(1)
+    {}
+
+        /** \brief Create an empty plan that will use multiple threads.
+
+            The plan can be initialized later by one of the init() functions. All Fourier
+            transforms of the convolution will use <tt>options.getActualNumThreads()</tt> threads
+            (see \ref FFTWPlan::FFTWPlan(ParallelOptions const &) for details).
+        */
+    explicit FFTWConvolvePlan(ParallelOptions const & options)
+    : useFourierKernel(false),
+      threads(options.getActualNumThreads())
     {}
 
         /** \brief Create a plan to convolve a real array with a real kernel.
@@ -1231,7 +1877,8 @@ class FFTWConvolvePlan
                      MultiArrayView<N, Real, C2> kernel,
                      MultiArrayView<N, Real, C3> out,
                      unsigned int planner_flags = FFTW_ESTIMATE)
-    : useFourierKernel(false)
+    : useFourierKernel(false),
+      threads(1)
     {
         init(in, kernel, out, planner_flags);
     }
@@ -1252,7 +1899,8 @@ class FFTWConvolvePlan
                      MultiArrayView<N, FFTWComplex<Real>, C2> kernel,
                      MultiArrayView<N, Real, C3> out,
                      unsigned int planner_flags = FFTW_ESTIMATE)
-    : useFourierKernel(true)
+    : useFourierKernel(true),
+      threads(1)
     {
         init(in, kernel, out, planner_flags);
     }
@@ -1275,6 +1923,7 @@ class FFTWConvolvePlan
                      MultiArrayView<N, FFTWComplex<Real>, C3> out,
                      bool fourierDomainKernel,
                      unsigned int planner_flags = FFTW_ESTIMATE)
+    : threads(1)
     {
         init(in, kernel, out, fourierDomainKernel, planner_flags);
     }
@@ -1296,6 +1945,7 @@ class FFTWConvolvePlan
     FFTWConvolvePlan(Shape inOut, Shape kernel,
                      bool useFourierKernel = false,
                      unsigned int planner_flags = FFTW_ESTIMATE)
+    : threads(1)
     {
         if(useFourierKernel)
             init(inOut, kernel, planner_flags);
@@ -1416,8 +2066,10 @@ class FFTWConvolvePlan
 
         CArray newFourierArray(paddedShape), newFourierKernel(paddedShape);
 
-        FFTWPlan<N, Real> fplan(newFourierArray, newFourierArray, FFTW_FORWARD, planner_flags);
-        FFTWPlan<N, Real> bplan(newFourierArray, newFourierArray, FFTW_BACKWARD, planner_flags);
+        FFTWPlan<N, Real> fplan(ParallelOptions().numThreads(threads));
+        fplan.init(newFourierArray, newFourierArray, FFTW_FORWARD, planner_flags);
+        FFTWPlan<N, Real> bplan(ParallelOptions().numThreads(threads));
+        bplan.init(newFourierArray, newFourierArray, FFTW_BACKWARD, planner_flags);
 
         forward_plan = fplan;
         backward_plan = bplan;
@@ -1579,8 +2231,10 @@ FFTWConvolvePlan<N, Real>::init(Shape in, Shape kernel,
     RArray newRealArray(paddedShape, realStrides, (Real*)newFourierArray.data());
     RArray newRealKernel(paddedShape, realStrides, (Real*)newFourierKernel.data());
 
-    FFTWPlan<N, Real> fplan(newRealArray, newFourierArray, planner_flags);
-    FFTWPlan<N, Real> bplan(newFourierArray, newRealArray, planner_flags);
+    FFTWPlan<N, Real> fplan(ParallelOptions().numThreads(threads));
+    fplan.init(newRealArray, newFourierArray, planner_flags);
+    FFTWPlan<N, Real> bplan(ParallelOptions().numThreads(threads));
+    bplan.init(newFourierArray, newRealArray, planner_flags);
 
     forward_plan = fplan;
     backward_plan = bplan;
@@ -1610,8 +2264,10 @@ FFTWConvolvePlan<N, Real>::initFourierKernel(Shape in, Shape kernel,
     RArray newRealArray(paddedShape, realStrides, (Real*)newFourierArray.data());
     RArray newRealKernel(paddedShape, realStrides, (Real*)newFourierKernel.data());
 
-    FFTWPlan<N, Real> fplan(newRealArray, newFourierArray, planner_flags);
-    FFTWPlan<N, Real> bplan(newFourierArray, newRealArray, planner_flags);
+    FFTWPlan<N, Real> fplan(ParallelOptions().numThreads(threads));
+    fplan.init(newRealArray, newFourierArray, planner_flags);
+    FFTWPlan<N, Real> bplan(ParallelOptions().numThreads(threads));
+    bplan.init(newFourierArray, newRealArray, planner_flags);
 
     forward_plan = fplan;
     backward_plan = bplan;
@@ -1644,8 +2300,10 @@ FFTWConvolvePlan<N, Real>::initComplex(Shape in, Shape kernel,
 
     CArray newFourierArray(paddedShape), newFourierKernel(paddedShape);
 
-    FFTWPlan<N, Real> fplan(newFourierArray, newFourierArray, FFTW_FORWARD, planner_flags);
-    FFTWPlan<N, Real> bplan(newFourierArray, newFourierArray, FFTW_BACKWARD, planner_flags);
+    FFTWPlan<N, Real> fplan(ParallelOptions().numThreads(threads));
+    fplan.init(newFourierArray, newFourierArray, FFTW_FORWARD, planner_flags);
+    FFTWPlan<N, Real> bplan(ParallelOptions().numThreads(threads));
+    bplan.init(newFourierArray, newFourierArray, FFTW_BACKWARD, planner_flags);
 
     forward_plan = fplan;
     backward_plan = bplan;
@@ -1984,6 +2642,216 @@ FFTWConvolvePlan<N, Real>::checkShapesComplex(Shape in,
     }
 }
 
+/********************************************************/
+/*                                                      */
+/*                 FFTWConvolveWorkspace                */
+/*                                                      */
+/********************************************************/
+
+/** \brief Workspace to repeatedly convolve real arrays with a fixed bank of kernels.
+
+    FFTWConvolvePlan::executeMany() transforms the input only once, but it transforms
+    each spatial kernel again in every call. This class instead computes the kernel spectra
+    once at initialization and keeps them together with a convolution plan and
+    its buffers. Each call to execute() then needs a single real-to-complex
+    transform of the input plus one complex multiplication and one complex-to-real
+    transform per kernel, and it allocates no memory. This is the method of choice when a
+    filter bank (e.g. a set of Gabor filters) is applied to many arrays of the same shape.
+
+    The kernels may be given in the spatial domain (real-valued, arbitrary shapes) or
+    in the Fourier domain (complex-valued half-space format, identical shapes). Shapes
+    and padding are the same as in \ref convolveFFTMany(), so the results are identical.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br>
+    Namespace: vigra
+
+    \code
+    ArrayVector<MultiArray<2, double> > kernels(...);   // e.g. a bank of Gabor kernels
+    ArrayVector<MultiArray<2, double> > results(kernels.size(), MultiArray<2, double>(Shape2(w, h)));
+
+    // plan the transforms and compute the kernel spectra only once
+    FFTWConvolveWorkspace<2, double> workspace(Shape2(w, h), kernels.begin(), kernels.end());
+
+    for(int i=0; i<imageCount; ++i)
+    {
+        MultiArray<2, double> const & image = ...;
+        workspace.execute(image, results.begin());
+        ...
+    }
+    \endcode
+*/
+template <unsigned int N, class Real = double>
+class FFTWConvolveWorkspace
+{
+    typedef FFTWComplex<Real> Complex;
+    typedef MultiArray<N, Complex, FFTWAllocator<Complex> > CArray;
+
+    FFTWConvolvePlan<N, Real> plan;
+    ArrayVector<CArray> spectra;
+
+  public:
+
+    typedef typename MultiArrayShape<N>::type Shape;
+
+        /** \brief Create an empty workspace.
+
+            The transforms will use <tt>options.getActualNumThreads()</tt> threads.
+            Call init() before execute().
+        */
+    explicit FFTWConvolveWorkspace(ParallelOptions const & options = ParallelOptions().numThreads(1))
+    : plan(options)
+    {}
+
+        /** \brief Create a workspace for arrays of shape <tt>inOut</tt> and the given
+            kernels.
+
+            The kernel sequence must contain either real-valued spatial kernels or
+            complex-valued Fourier kernels (see \ref convolveFFT() for details).
+            <tt>planner_flags</tt> are passed to FFTW, and the transforms use
+            <tt>options.getActualNumThreads()</tt> threads.
+        */
+    template <class KernelIterator>
+    FFTWConvolveWorkspace(Shape inOut,
+                          KernelIterator kernels, KernelIterator kernelsEnd,
+                          unsigned int planner_flags = FFTW_ESTIMATE,
+                          ParallelOptions const & options = ParallelOptions().numThreads(1))
+    : plan(options)
+    {
+        init(inOut, kernels, kernelsEnd, planner_flags);
+    }
+
+        /** \brief Init the workspace for arrays of shape <tt>inOut</tt> and the given
+            kernels.
+
+            See the constructor with the same signature for details.
+        */
+    template <class KernelIterator>
+    void init(Shape inOut,
+              KernelIterator kernels, KernelIterator kernelsEnd,
+              unsigned int planner_flags = FFTW_ESTIMATE)
+    {
+        typedef typename std::iterator_traits<KernelIterator>::value_type KernelArray;
+        typedef typename KernelArray::value_type KernelValue;
+        typedef typename IsSameType<KernelValue, Complex>::type UseFourierKernel;
+
+        vigra_precondition((IsSameType<KernelValue, Real>::value || IsSameType<KernelValue, Complex>::value),
+             "FFTWConvolveWorkspace::init(): kernels have unsuitable value_type.");
+        vigra_precondition(kernels != kernelsEnd,
+             "FFTWConvolveWorkspace::init(): empty kernel sequence.");
+
+        initImpl(inOut, kernels, kernelsEnd, planner_flags, UseFourierKernel());
+        shape_ = inOut;
+    }
+
+        /** \brief Convolve <tt>in</tt> with all kernels.
+
+            The i-th result is written to <tt>outs[i]</tt>. All arrays must have the
+            shape given to init().
+        */
+    template <class C1, class OutIterator>
+    void execute(MultiArrayView<N, Real, C1> in, OutIterator outs)
+    {
+        typedef typename std::iterator_traits<OutIterator>::value_type OutArray;
+        typedef typename OutArray::value_type OutValue;
+
+        vigra_precondition((IsSameType<OutValue, Real>::value),
+             "FFTWConvolveWorkspace::execute(): outputs have unsuitable value_type.");
+        vigra_precondition(in.shape() == shape_,
+             "FFTWConvolveWorkspace::execute(): shape mismatch between input and workspace.");
+
+        Shape diff = plan.realArray.shape() - in.shape(),
+              left = div(diff, MultiArrayIndex(2)),
+              right = in.shape() + left;
+
+        detail::fftEmbedArray(in, plan.realArray);
+        plan.forward_plan.execute(plan.realArray, plan.fourierArray);
+
+        for(unsigned int k=0; k<spectra.size(); ++k, ++outs)
+        {
+            vigra_precondition(outs->shape() == shape_,
+                 "FFTWConvolveWorkspace::execute(): shape mismatch between input and (one) output.");
+
+            plan.fourierKernel = spectra[k];
+            plan.fourierKernel *= plan.fourierArray;
+
+            plan.backward_plan.execute(plan.fourierKernel, plan.realKernel);
+
+            *outs = plan.realKernel.subarray(left, right);
+        }
+    }
+
+        /** \brief Number of kernels in the workspace.
+        */
+    unsigned int size() const
+    {
+        return spectra.size();
+    }
+
+        /** \brief Shape of input and output arrays.
+        */
+    Shape const & shape() const
+    {
+        return shape_;
+    }
+
+        /** \brief Shape of the (padded) arrays that are actually transformed.
+        */
+    Shape paddedShape() const
+    {
+        return plan.realArray.shape();
+    }
+
+  private:
+
+    template <class KernelIterator>
+    void initImpl(Shape inOut,
+                  KernelIterator kernels, KernelIterator kernelsEnd,
+                  unsigned int planner_flags, VigraFalseType /* useFourierKernel */)
+    {
+        Shape kernelMax;
+        for(KernelIterator k = kernels; k != kernelsEnd; ++k)
+            kernelMax = max(kernelMax, k->shape());
+        vigra_precondition(prod(kernelMax) > 0,
+             "FFTWConvolveWorkspace::init(): all kernels have size 0.");
+
+        plan.init(inOut, kernelMax, planner_flags);
+
+        spectra.clear();
+        for(; kernels != kernelsEnd; ++kernels)
+        {
+            detail::fftEmbedKernel(*kernels, plan.realKernel);
+            plan.forward_plan.execute(plan.realKernel, plan.fourierKernel);
+            spectra.push_back(plan.fourierKernel);
+        }
+    }
+
+    template <class KernelIterator>
+    void initImpl(Shape inOut,
+                  KernelIterator kernels, KernelIterator kernelsEnd,
+                  unsigned int planner_flags, VigraTrueType /* useFourierKernel */)
+    {
+        Shape complexShape = kernels->shape();
+        for(KernelIterator k = kernels; k != kernelsEnd; ++k)
+            vigra_precondition(complexShape == k->shape(),
+                 "FFTWConvolveWorkspace::init(): Fourier domain kernels must have identical size.");
+
+        plan.initFourierKernel(inOut, complexShape, planner_flags);
+        vigra_precondition(plan.realArray.shape() == fftwCorrespondingShapeC2R(complexShape, odd(inOut[0])),
+             "FFTWConvolveWorkspace::init(): kernel shape doesn't match the padded input shape.");
+
+        spectra.clear();
+        for(; kernels != kernelsEnd; ++kernels)
+        {
+            spectra.push_back(CArray(*kernels));
+            moveDCToHalfspaceUpperLeft(spectra.back());
+        }
+    }
+
+    Shape shape_;
+};
+
 /********************************************************/
 /*                                                      */
 /*                  FFTWCorrelatePlan                   */
@@ -2113,33 +2981,43 @@ public:
 template <unsigned int N, class Real, class C1, class C2>
 inline void
 fourierTransform(MultiArrayView<N, FFTWComplex<Real>, C1> in,
-                 MultiArrayView<N, FFTWComplex<Real>, C2> out)
+                 MultiArrayView<N, FFTWComplex<Real>, C2> out,
+                 ParallelOptions const & options = ParallelOptions().numThreads(1))
 {
-    FFTWPlan<N, Real>(in, out, FFTW_FORWARD).execute(in, out);
+    FFTWPlan<N, Real> plan(options);
+    plan.init(in, out, FFTW_FORWARD);
+    plan.execute(in, out);
 }
 
 template <unsigned int N, class Real, class C1, class C2>
 inline void
 fourierTransformInverse(MultiArrayView<N, FFTWComplex<Real>, C1> in,
-                        MultiArrayView<N, FFTWComplex<Real>, C2> out)
+                        MultiArrayView<N, FFTWComplex<Real>, C2> out,
+                        ParallelOptions const & options = ParallelOptions().numThreads(1))
 {
-    FFTWPlan<N, Real>(in, out, FFTW_BACKWARD).execute(in, out);
+    FFTWPlan<N, Real> plan(options);
+    plan.init(in, out, FFTW_BACKWARD);
+    plan.execute(in, out);
 }
 
 template <unsigned int N, class Real, class C1, class C2>
 void
 fourierTransform(MultiArrayView<N, Real, C1> in,
-                 MultiArrayView<N, FFTWComplex<Real>, C2> out)
+                 MultiArrayView<N, FFTWComplex<Real>, C2> out,
+                 ParallelOptions const & options = ParallelOptions().numThreads(1))
 {
+    FFTWPlan<N, Real> plan(options);
     if(in.shape() == out.shape())
     {
         // copy the input array into the output and then perform an in-place FFT
         out = in;
-        FFTWPlan<N, Real>(out, out, FFTW_FORWARD).execute(out, out);
+        plan.init(out, out, FFTW_FORWARD);
+        plan.execute(out, out);
     }
     else if(out.shape() == fftwCorrespondingShapeR2C(in.shape()))
     {
-        FFTWPlan<N, Real>(in, out).execute(in, out);
+        plan.init(in, out);
+        plan.execute(in, out);
     }
     else
         vigra_precondition(false,
@@ -2149,11 +3027,14 @@ fourierTransform(MultiArrayView<N, Real, C1> in,
 template <unsigned int N, class Real, class C1, class C2>
 void
 fourierTransformInverse(MultiArrayView<N, FFTWComplex<Real>, C1> in,
-                        MultiArrayView<N, Real, C2> out)
+                        MultiArrayView<N, Real, C2> out,
+                        ParallelOptions const & options = ParallelOptions().numThreads(1))
 {
     vigra_precondition(in.shape() == fftwCorrespondingShapeR2C(out.shape()),
         "fourierTransformInverse(): shape mismatch between input and output.");
-    FFTWPlan<N, Real>(in, out).execute(in, out);
+    FFTWPlan<N, Real> plan(options);
+    plan.init(in, out);
+    plan.execute(in, out);
 }
 
 //@}
@@ -2246,6 +3127,9 @@ fourierTransformInverse(MultiArrayView<N, FFTWComplex<Real>, C1> in,
     optimal settings are guessed or read from saved "wisdom" files. If you need more control over planning,
     you can use the class \ref FFTWConvolvePlan.
 
+    The optional argument <tt>options</tt> determines how many threads the Fourier transforms
+    use (default: single-threaded, see \ref FFTWPlan::FFTWPlan(ParallelOptions const &)).
+
     See also \ref applyFourierFilter() for corresponding functionality on the basis of the
     old image iterator interface.
 
@@ -2258,7 +3142,8 @@ fourierTransformInverse(MultiArrayView<N, FFTWComplex<Real>, C1> in,
         void
         convolveFFT(MultiArrayView<N, Real, C1> in,
                     MultiArrayView<N, Real, C2> kernel,
-                    MultiArrayView<N, Real, C3> out);
+                    MultiArrayView<N, Real, C3> out,
+                    ParallelOptions const & options = ParallelOptions().numThreads(1));
     }
     \endcode
 
@@ -2269,7 +3154,8 @@ fourierTransformInverse(MultiArrayView<N, FFTWComplex<Real>, C1> in,
         void
         convolveFFT(MultiArrayView<N, Real, C1> in,
                     MultiArrayView<N, FFTWComplex<Real>, C2> kernel,
-                    MultiArrayView<N, Real, C3> out);
+                    MultiArrayView<N, Real, C3> out,
+                    ParallelOptions const & options = ParallelOptions().numThreads(1));
     }
     \endcode
 
@@ -2351,18 +3237,24 @@ template <unsigned int N, class Real, class C1, class C2, class C3>
 void
 convolveFFT(MultiArrayView<N, Real, C1> in,
             MultiArrayView<N, Real, C2> kernel,
-            MultiArrayView<N, Real, C3> out)
+            MultiArrayView<N, Real, C3> out,
+            ParallelOptions const & options = ParallelOptions().numThreads(1))
 {
-    FFTWConvolvePlan<N, Real>(in, kernel, out).execute(in, kernel, out);
+    FFTWConvolvePlan<N, Real> plan(options);
+    plan.init(in, kernel, out);
+    plan.execute(in, kernel, out);
 }
 
 template <unsigned int N, class Real, class C1, class C2, class C3>
 void
 convolveFFT(MultiArrayView<N, Real, C1> in,
             MultiArrayView<N, FFTWComplex<Real>, C2> kernel,
-            MultiArrayView<N, Real, C3> out)
+            MultiArrayView<N, Real, C3> out,
+            ParallelOptions const & options = ParallelOptions().numThreads(1))
 {
-    FFTWConvolvePlan<N, Real>(in, kernel, out).execute(in, kernel, out);
+    FFTWConvolvePlan<N, Real> plan(options);
+    plan.init(in, kernel, out);
+    plan.execute(in, kernel, out);
 }
 
 /** \brief Convolve a complex-valued array by means of the Fourier transform.
@@ -2383,7 +3275,8 @@ convolveFFTComplex(MultiArrayView<N, FFTWComplex<Real>, C1> in,
 
 /** \brief Convolve a real-valued array with a sequence of kernels by means of the Fourier transform.
 
-    See \ref convolveFFT() for details.
+    See \ref convolveFFT() for details. When the same kernels are applied to many arrays,
+    \ref FFTWConvolveWorkspace avoids re-planning and re-transforming the kernels in every call.
 */
 doxygen_overloaded_function(template <...> void convolveFFTMany)
 
@@ -0,0 +1,448 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2026 by the VIGRA contributors               */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_SCALESPACE_HXX
+#define VIGRA_MULTI_SCALESPACE_HXX
+
+#include <cmath>
+#include "array_vector.hxx"
+#include "multi_array.hxx"
+#include "multi_convolution.hxx"
+#include "multi_resize.hxx"
+
+namespace vigra {
+
+/** \addtogroup ConvolutionFilters
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*                  ScaleSpaceOptions                   */
+/*                                                      */
+/********************************************************/
+
+/** \brief Options for \ref vigra::GaussianScaleSpace.
+
+    <b>\#include</b> \<vigra/multi_scalespace.hxx\><br/>
+    Namespace: vigra
+*/
+class ScaleSpaceOptions
+{
+  public:
+
+    ScaleSpaceOptions()
+    : resolution_std_dev(0.0),
+      window_ratio(0.0),
+      downsampling_threshold(2.0),
+      min_derivative_std_dev(1.0),
+      min_shape(8),
+      allow_downsampling(true)
+    {}
+
+        /** Scale of the input data, i.e. a supposed pre-existing Gaussian
+            filtering by this standard deviation (see
+            \ref ConvolutionOptions::resolutionStdDev()).
+
+            Default: <tt>0.0</tt>
+        */
+    ScaleSpaceOptions & resolutionStdDev(double sigma)
+    {
+        vigra_precondition(sigma >= 0.0,
+            "ScaleSpaceOptions::resolutionStdDev(): sigma must not be negative.");
+        resolution_std_dev = sigma;
+        return *this;
+    }
+
+        /** Size of the filter windows as a multiple of the scale parameter
+            (see \ref ConvolutionOptions::filterWindowSize()).
+
+            Default: <tt>0.0</tt> (i.e. determine the window size automatically)
+        */
+    ScaleSpaceOptions & filterWindowSize(double ratio)
+    {
+        vigra_precondition(ratio >= 0.0,
+            "ScaleSpaceOptions::filterWindowSize(): ratio must not be negative.");
+        window_ratio = ratio;
+        return *this;
+    }
+
+        /** Allow levels to be stored at reduced resolution.
+
+            When a level's scale (in pixels of the grid it is stored on)
+            reaches <tt>threshold</tt>, the next level is computed on a grid
+            that has been subsampled by a factor of 2 along every axis.
+            Subsampling stops when an axis would get shorter than
+            <tt>minShape</tt>. The larger the threshold, the smaller
+            the aliasing and interpolation errors.
+
+            Default: <tt>allowDownsampling(true, 2.0, 8)</tt>
+        */
+    ScaleSpaceOptions & allowDownsampling(bool allow, double threshold = 2.0,
+                                          MultiArrayIndex minShape = 8)
+    {
+        vigra_precondition(threshold > 0.0 && minShape > 1,
+            "ScaleSpaceOptions::allowDownsampling(): invalid threshold or minimal shape.");
+        allow_downsampling = allow;
+        downsampling_threshold = threshold;
+        min_shape = minShape;
+        return *this;
+    }
+
+        /** Smallest Gaussian that is applied on top of a level when
+            derivatives are computed, in pixels of the level's grid.
+
+            Derivatives at scale <tt>sigma</tt> are computed from the
+            coarsest level whose scale <tt>s</tt> still leaves room for a
+            derivative filter of at least this size, i.e.
+            \f$\sqrt{\sigma^2 - s^2} \ge {\rm minDerivativeStdDev}\f$.
+            Small derivative filters are inaccurate.
+
+            Default: <tt>1.0</tt>
+        */
+    ScaleSpaceOptions & minDerivativeStdDev(double sigma)
+    {
+        vigra_precondition(sigma >= 0.0,
+            "ScaleSpaceOptions::minDerivativeStdDev(): sigma must not be negative.");
+        min_derivative_std_dev = sigma;
+        return *this;
+    }
+
+    double resolution_std_dev, window_ratio, downsampling_threshold, min_derivative_std_dev;
+    MultiArrayIndex min_shape;
+    bool allow_downsampling;
+};
+
+namespace detail {
+
+struct ScaleSpaceSmoothing
+{
+    template <class SRC, class DEST, class OPTIONS>
+    void operator()(SRC const & src, DEST const & dest, OPTIONS const & opt) const
+    {
+        gaussianSmoothMultiArray(src, dest, opt);
+    }
+};
+
+struct ScaleSpaceGradient
+{
+    template <class SRC, class DEST, class OPTIONS>
+    void operator()(SRC const & src, DEST const & dest, OPTIONS const & opt) const
+    {
+        gaussianGradientMultiArray(src, dest, opt);
+    }
+};
+
+struct ScaleSpaceGradientMagnitude
+{
+    template <class SRC, class DEST, class OPTIONS>
+    void operator()(SRC const & src, DEST const & dest, OPTIONS const & opt) const
+    {
+        gaussianGradientMagnitude(src, dest, opt);
+    }
+};
+
+struct ScaleSpaceHessian
+{
+    template <class SRC, class DEST, class OPTIONS>
+    void operator()(SRC const & src, DEST const & dest, OPTIONS const & opt) const
+    {
+        hessianOfGaussianMultiArray(src, dest, opt);
+    }
+};
+
+struct ScaleSpaceLaplacian
+{
+    template <class SRC, class DEST, class OPTIONS>
+    void operator()(SRC const & src, DEST const & dest, OPTIONS const & opt) const
+    {
+        laplacianOfGaussianMultiArray(src, dest, opt);
+    }
+};
+
+} // namespace detail
+
+/********************************************************/
+/*                                                      */
+/*                  GaussianScaleSpace                  */
+/*                                                      */
+/********************************************************/
+
+/** \brief Incrementally computed Gaussian scale space of a multi-dimensional array.
+
+    Feature computations often need the same filters at several scales,
+    e.g. <tt>sigma = {0.7, 1.0, 1.6, 3.5, 5.0, 10.0}</tt>. Instead of
+    convolving the original data at every scale, the scale space computes
+    its levels in a cascade, exploiting the semigroup property of the
+    Gaussian: level <tt>k</tt> is obtained from level <tt>k-1</tt> by a
+    Gaussian of standard deviation \f$\sqrt{\sigma_k^2 - \sigma_{k-1}^2}\f$.
+    Moreover, coarse levels are stored at reduced resolution (see
+    \ref ScaleSpaceOptions::allowDownsampling()), so that the kernels
+    remain small even for large scales.
+
+    Gaussian derivatives at any scale above the data's resolution can then
+    be queried. They are computed from the coarsest suitable level by
+    a filter of the remaining scale and interpolated back to the original
+    resolution by cubic splines when the level has been subsampled.
+    Results from subsampled levels are therefore only approximations. Errors
+    are typically well below 1% of the signal range, except for odd-order
+    derivatives within a few pixels of the array border, where the
+    interpolation is less accurate.
+
+    <b>\#include</b> \<vigra/multi_scalespace.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float> volume(Shape3(300, 300, 200));
+    ... // fill volume
+
+    double scales[] = { 0.7, 1.0, 1.6, 3.5, 5.0, 10.0 };
+    GaussianScaleSpace<3> scaleSpace(volume, ArrayVector<double>(scales, scales+6));
+
+    MultiArray<3, TinyVector<float, 3> > gradient(volume.shape());
+    MultiArray<3, TinyVector<float, 6> > hessian(volume.shape());
+    for(int k=0; k<6; ++k)
+    {
+        scaleSpace.gaussianGradient(scales[k], gradient);
+        scaleSpace.hessianOfGaussian(scales[k], hessian);
+        ...
+    }
+    \endcode
+*/
+template <unsigned int N, class T = float>
+class GaussianScaleSpace
+{
+  public:
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef TinyVector<double, N>             StepSize;
+    typedef MultiArrayView<N, T>              LevelView;
+
+        /** Compute the levels at the given scales (which must be
+            in ascending order and above the data's resolution).
+        */
+    template <class U, class S>
+    GaussianScaleSpace(MultiArrayView<N, U, S> const & data,
+                       ArrayVector<double> const & scales,
+                       ScaleSpaceOptions const & options = ScaleSpaceOptions())
+    : options_(options),
+      shape_(data.shape())
+    {
+        levels_.reserve(scales.size() + 1);
+        scales_.reserve(scales.size() + 1);
+        steps_.reserve(scales.size() + 1);
+
+        // level 0 is the data itself
+        levels_.push_back(MultiArray<N, T>(data));
+        scales_.push_back(options.resolution_std_dev);
+        steps_.push_back(StepSize(1.0));
+
+        for(unsigned int k=0; k<scales.size(); ++k)
+        {
+            vigra_precondition(scales[k] >= scales_.back(),
+                "GaussianScaleSpace(): scales must be ascending and not below the data's resolution.");
+            addLevel(scales[k]);
+        }
+    }
+
+        /** Number of levels (i.e. the number of scales given to the constructor).
+        */
+    unsigned int levelCount() const
+    {
+        return scales_.size() - 1;
+    }
+
+        /** Scale of level <tt>k</tt>.
+        */
+    double levelScale(unsigned int k) const
+    {
+        return scales_[k+1];
+    }
+
+        /** Distance between the pixels of level <tt>k</tt>, measured in
+            pixels of the original data.
+        */
+    StepSize const & levelStepSize(unsigned int k) const
+    {
+        return steps_[k+1];
+    }
+
+        /** Level <tt>k</tt>, possibly at reduced resolution.
+        */
+    LevelView level(unsigned int k) const
+    {
+        return levels_[k+1];
+    }
+
+        /** Shape of the original data, and thus of all query results.
+        */
+    Shape const & shape() const
+    {
+        return shape_;
+    }
+
+        /** Gaussian smoothing at scale <tt>sigma</tt>.
+        */
+    template <class T2, class S2>
+    void gaussianSmooth(double sigma, MultiArrayView<N, T2, S2> dest) const
+    {
+        apply(sigma, 0.0, dest, detail::ScaleSpaceSmoothing());
+    }
+
+        /** Gradient of Gaussian at scale <tt>sigma</tt>.
+        */
+    template <class T2, class S2>
+    void gaussianGradient(double sigma, MultiArrayView<N, TinyVector<T2, int(N)>, S2> dest) const
+    {
+        apply(sigma, options_.min_derivative_std_dev, dest, detail::ScaleSpaceGradient());
+    }
+
+        /** Gradient magnitude of Gaussian at scale <tt>sigma</tt>.
+        */
+    template <class T2, class S2>
+    void gaussianGradientMagnitude(double sigma, MultiArrayView<N, T2, S2> dest) const
+    {
+        apply(sigma, options_.min_derivative_std_dev, dest, detail::ScaleSpaceGradientMagnitude());
+    }
+
+        /** Hessian of Gaussian at scale <tt>sigma</tt>.
+        */
+    template <class T2, class S2>
+    void hessianOfGaussian(double sigma, MultiArrayView<N, TinyVector<T2, int(N*(N+1)/2)>, S2> dest) const
+    {
+        apply(sigma, options_.min_derivative_std_dev, dest, detail::ScaleSpaceHessian());
+    }
+
+        /** Laplacian of Gaussian at scale <tt>sigma</tt>.
+        */
+    template <class T2, class S2>
+    void laplacianOfGaussian(double sigma, MultiArrayView<N, T2, S2> dest) const
+    {
+        apply(sigma, options_.min_derivative_std_dev, dest, detail::ScaleSpaceLaplacian());
+    }
+
+  private:
+    void addLevel(double sigma)
+    {
+        unsigned int prev = levels_.size() - 1;
+        StepSize step = steps_[prev];
+
+        MultiArray<N, T> subsampled;
+        bool subsample = canSubsample(prev);
+        if(subsample)
+        {
+            // the level is smooth enough to be subsampled without prefiltering
+            Shape shape = levels_[prev].shape();
+            subsampled.reshape((shape + Shape(1)) / 2);
+            resizeMultiArraySplineInterpolation(levels_[prev], subsampled);
+            for(unsigned int d=0; d<N; ++d)
+                step[d] *= double(shape[d] - 1) / (subsampled.shape(d) - 1);
+        }
+        LevelView source = subsample ? LevelView(subsampled) : LevelView(levels_[prev]);
+
+        MultiArray<N, T> level(source.shape());
+        gaussianSmoothMultiArray(source, level,
+                                 ConvolutionOptions<N>().stdDev(sigma)
+                                                        .resolutionStdDev(scales_[prev])
+                                                        .stepSize(step)
+                                                        .filterWindowSize(options_.window_ratio));
+        levels_.push_back(MultiArray<N, T>());
+        levels_.back().swap(level);
+        scales_.push_back(sigma);
+        steps_.push_back(step);
+    }
+
+    bool canSubsample(unsigned int k) const
+    {
+        if(!options_.allow_downsampling)
+            return false;
+        for(unsigned int d=0; d<N; ++d)
+            if(scales_[k] / steps_[k][d] < options_.downsampling_threshold ||
+               (levels_[k].shape(d) + 1) / 2 < options_.min_shape)
+                return false;
+        return true;
+    }
+
+        // the coarsest level that leaves at least 'minRemaining' for
+        // the final filter (0 is the data itself)
+    unsigned int selectLevel(double sigma, double minRemaining) const
+    {
+        unsigned int res = 0;
+        for(unsigned int k=1; k<scales_.size() && scales_[k] <= sigma; ++k)
+        {
+            double remaining = std::sqrt(sq(sigma) - sq(scales_[k])) / max(steps_[k]);
+            if(remaining >= minRemaining)
+                res = k;
+        }
+        return res;
+    }
+
+    template <class T2, class S2, class FILTER>
+    void apply(double sigma, double minRemaining,
+               MultiArrayView<N, T2, S2> dest, FILTER const & filter) const
+    {
+        vigra_precondition(dest.shape() == shape_,
+            "GaussianScaleSpace: shape mismatch between input and output.");
+        vigra_precondition(sigma >= scales_[0],
+            "GaussianScaleSpace: scale must not be below the data's resolution.");
+
+        unsigned int k = selectLevel(sigma, minRemaining);
+        ConvolutionOptions<N> opt;
+        opt.stdDev(sigma).resolutionStdDev(scales_[k]).stepSize(steps_[k])
+           .filterWindowSize(options_.window_ratio);
+
+        if(levels_[k].shape() == shape_)
+        {
+            filter(levels_[k], dest, opt);
+        }
+        else
+        {
+            MultiArray<N, T2> tmp(levels_[k].shape());
+            filter(levels_[k], tmp, opt);
+            resizeMultiArraySplineInterpolation(tmp, dest);
+        }
+    }
+
+    ScaleSpaceOptions options_;
+    Shape shape_;
+    ArrayVector<MultiArray<N, T> > levels_;
+    ArrayVector<double> scales_;
+    ArrayVector<StepSize> steps_;
+};
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_SCALESPACE_HXX
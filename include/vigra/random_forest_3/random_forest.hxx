@@ -307,12 +307,18 @@ void RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::predict_probabilities(
     if (n_threads < 1)
         n_threads = 1;
     
-    parallel_foreach(
+    // The cost of an instance is dominated by the tree traversals,
+    // so let parallel_for() choose pieces that amortize the scheduling.
+    parallel_for(
         n_threads,
-        num_instances,
-        [&features,&probs,&tree_indices_cpy,this](size_t, size_t i) {
-            this->predict_probabilities_impl(features, probs, i, tree_indices_cpy);
-        }
+        range(num_instances),
+        0,
+        [&features,&probs,&tree_indices_cpy,this](int, CountingIterator<size_t> piece) {
+            for (auto i : piece)
+                this->predict_probabilities_impl(features, probs, i, tree_indices_cpy);
+        },
+        GuidedChunking,
+        std::max(1.0, 100.0 * tree_indices_cpy.size())  // costHint must be positive, even without trees
     );
 }
 
@@ -381,20 +387,19 @@ double RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::leaf_ids(
         n_threads = std::thread::hardware_concurrency();
     if (n_threads < 1)
         n_threads = 1;
-    std::vector<double> split_comparisons(n_threads, 0.0);
-    std::vector<size_t> indices(num_instances);
-    std::iota(indices.begin(), indices.end(), 0);
     std::fill(ids.begin(), ids.end(), -1);
-    parallel_foreach(
+    double const sum_split_comparisons = parallel_reduce(
         n_threads,
-        indices.begin(),
-        indices.end(),
-        [this, &features, &ids, &split_comparisons, &tree_indices](size_t thread_id, size_t i) {
-            split_comparisons[thread_id] += this->leaf_ids_impl(features, ids, i, i+1, tree_indices);
-        }
+        range(num_instances),
+        0,
+        0.0,
+        [this, &features, &ids, &tree_indices](double & split_comparisons, CountingIterator<size_t> piece) {
+            split_comparisons += this->leaf_ids_impl(features, ids, *piece.begin(), *piece.end(), tree_indices);
+        },
+        [](double a, double b) { return a + b; },
+        GuidedChunking,
+        std::max(1.0, 100.0 * tree_indices.size())  // costHint must be positive, even without trees
     );
-
-    double const sum_split_comparisons = std::accumulate(split_comparisons.begin(), split_comparisons.end(), 0.0);
     return sum_split_comparisons / features.shape()[0];
 }
 
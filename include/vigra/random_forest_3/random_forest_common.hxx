@@ -83,6 +83,8 @@ public:
     template <typename ITER, typename OUTITER>
     void operator()(ITER begin, ITER end, OUTITER out)
     {
+        if (begin == end)
+            return; // no trees, no votes
         std::fill(buffer_.begin(), buffer_.end(), 0);
         size_t max_v = 0;
         size_t n = 0;
@@ -118,6 +120,8 @@ public:
     template <typename ITER, typename OUTITER>
     void operator()(ITER begin, ITER end, OUTITER out)
     {
+        if (begin == end)
+            return; // no trees, no votes
         std::fill(buffer_.begin(), buffer_.end(), 0);
         size_t max_v = 0;
         for (ITER it = begin; it != end; ++it)
@@ -51,6 +51,114 @@ namespace vigra {
 template <class ARITHTYPE>
 class Kernel1D;
 
+/** \brief Symmetry of a 1D kernel.
+
+    Symmetric kernels satisfy <tt>k[-i] == k[i]</tt> and antisymmetric
+    kernels <tt>k[-i] == -k[i]</tt> (and thus <tt>k[0] == 0</tt>) for all <tt>i</tt>.
+    The convolution functions exploit symmetry by adding (resp. subtracting)
+    the two values under a pair of equal coefficients first, which halves
+    the number of multiplications.
+
+    <b>\#include</b> \<vigra/separableconvolution.hxx\><br/>
+    Namespace: vigra
+*/
+enum KernelSymmetry
+{
+    KERNEL_ASYMMETRIC,
+    KERNEL_SYMMETRIC,
+    KERNEL_ANTISYMMETRIC
+};
+
+namespace detail {
+
+// Determine the symmetry of the kernel [kernel+kleft, kernel+kright].
+template <class KernelIterator, class KernelAccessor>
+KernelSymmetry
+kernelSymmetry(KernelIterator kernel, KernelAccessor ka, int kleft, int kright)
+{
+    typedef typename KernelAccessor::value_type KernelValue;
+
+    if(kleft != -kright || kright == 0)
+        return KERNEL_ASYMMETRIC;
+
+    bool symmetric = true,
+         antisymmetric = (ka(kernel) == NumericTraits<KernelValue>::zero());
+    for(int i=1; i<=kright; ++i)
+    {
+        KernelValue l = ka(kernel - i),
+                    r = ka(kernel + i);
+        symmetric = symmetric && (l == r);
+        antisymmetric = antisymmetric && (l == -r);
+    }
+    return symmetric
+               ? KERNEL_SYMMETRIC
+               : antisymmetric
+                   ? KERNEL_ANTISYMMETRIC
+                   : KERNEL_ASYMMETRIC;
+}
+
+// Convolution at a single point with a (anti)symmetric kernel: the two source
+// values belonging to a pair of coefficients are combined before the multiplication.
+// RADIUS > 0 fixes the kernel radius at compile time, so that the loop can be
+// completely unrolled. RADIUS == 0 means that the radius is only known at run time.
+template <int RADIUS>
+struct FoldedKernel
+{
+    template <class SumType, class SrcIterator, class SrcAccessor,
+              class KernelIterator, class KernelAccessor>
+    static SumType
+    exec(SrcIterator is, SrcAccessor sa, KernelIterator kernel, KernelAccessor ka,
+         KernelSymmetry symmetry, int radius = RADIUS)
+    {
+        const int r = RADIUS > 0 ? RADIUS : radius;
+        SumType sum = NumericTraits<SumType>::zero();
+        if(symmetry == KERNEL_SYMMETRIC)
+        {
+            sum += ka(kernel) * sa(is);
+            for(int i=1; i<=r; ++i)
+            {
+                SumType t = sa(is - i);
+                t += sa(is + i);
+                sum += ka(kernel + i) * t;
+            }
+        }
+        else
+        {
+            for(int i=1; i<=r; ++i)
+            {
+                SumType t = sa(is - i);
+                t -= sa(is + i);
+                sum += ka(kernel + i) * t;
+            }
+        }
+        return sum;
+    }
+};
+
+// Dispatch to the specializations for common small radii.
+template <class SumType, class SrcIterator, class SrcAccessor,
+          class KernelIterator, class KernelAccessor>
+inline SumType
+convolveFolded(SrcIterator is, SrcAccessor sa, KernelIterator kernel, KernelAccessor ka,
+               int radius, KernelSymmetry symmetry)
+{
+    switch(radius)
+    {
+      case 1:
+        return FoldedKernel<1>::template exec<SumType>(is, sa, kernel, ka, symmetry);
+      case 2:
+        return FoldedKernel<2>::template exec<SumType>(is, sa, kernel, ka, symmetry);
+      case 3:
+        return FoldedKernel<3>::template exec<SumType>(is, sa, kernel, ka, symmetry);
+      case 4:
+        return FoldedKernel<4>::template exec<SumType>(is, sa, kernel, ka, symmetry);
+      default:
+        return FoldedKernel<0>::template exec<SumType>(is, sa, kernel, ka, symmetry, radius);
+    }
+}
+
+} // namespace detail
+
 /********************************************************/
 /*                                                      */
 /*            internalConvolveLineOptimistic            */
@@ -75,15 +183,23 @@ void internalConvolveLineOptimistic(SrcIterator is, SrcIterator iend, SrcAccesso
 
     int w = std::distance( is, iend );
     int kw = kright - kleft + 1;
+    KernelSymmetry symmetry = detail::kernelSymmetry(kernel, ka, kleft, kright);
     for(int x=0; x<w; ++x, ++is, ++id)
     {
         SrcIterator iss = is + (-kright);
         KernelIterator ik = kernel + kright;
         SumType sum = NumericTraits<SumType>::zero();
 
-        for(int k = 0; k < kw; ++k, --ik, ++iss)
+        if(symmetry != KERNEL_ASYMMETRIC)
         {
-            sum += ka(ik) * sa(iss);
+            sum = detail::convolveFolded<SumType>(is, sa, kernel, ka, kright, symmetry);
+        }
+        else
+        {
+            for(int k = 0; k < kw; ++k, --ik, ++iss)
+            {
+                sum += ka(ik) * sa(iss);
+            }
         }
 
         da.set(detail::RequiresExplicitCast<typename
@@ -234,6 +350,8 @@ void internalConvolveLineWrap(SrcIterator is, SrcIterator iend, SrcAccessor sa,
             typename SrcAccessor::value_type,
             typename KernelAccessor::value_type>::Promote SumType;
 
+    KernelSymmetry symmetry = detail::kernelSymmetry(kernel, ka, kleft, kright);
+
     SrcIterator ibegin = is;
 
     if(stop == 0)
@@ -298,6 +416,10 @@ void internalConvolveLineWrap(SrcIterator is, SrcIterator iend, SrcAccessor sa,
                 sum += ka(ik) * sa(iss);
             }
         }
+        else if(symmetry != KERNEL_ASYMMETRIC)
+        {
+            sum = detail::convolveFolded<SumType>(is, sa, kernel, ka, kright, symmetry);
+        }
         else
         {
             SrcIterator iss = is - kright;
@@ -335,6 +457,8 @@ void internalConvolveLineClip(SrcIterator is, SrcIterator iend, SrcAccessor sa,
             typename SrcAccessor::value_type,
             typename KernelAccessor::value_type>::Promote SumType;
 
+    KernelSymmetry symmetry = detail::kernelSymmetry(kernel, ka, kleft, kright);
+
     SrcIterator ibegin = is;
 
     if(stop == 0)
@@ -403,6 +527,10 @@ void internalConvolveLineClip(SrcIterator is, SrcIterator iend, SrcAccessor sa,
 
             sum = norm / (norm - clipped) * sum;
         }
+        else if(symmetry != KERNEL_ASYMMETRIC)
+        {
+            sum = detail::convolveFolded<SumType>(is, sa, kernel, ka, kright, symmetry);
+        }
         else
         {
             SrcIterator iss = is + (-kright);
@@ -439,6 +567,8 @@ void internalConvolveLineZeropad(SrcIterator is, SrcIterator iend, SrcAccessor s
             typename SrcAccessor::value_type,
             typename KernelAccessor::value_type>::Promote SumType;
 
+    KernelSymmetry symmetry = detail::kernelSymmetry(kernel, ka, kleft, kright);
+
     SrcIterator ibegin = is;
 
     if(stop == 0)
@@ -481,6 +611,10 @@ void internalConvolveLineZeropad(SrcIterator is, SrcIterator iend, SrcAccessor s
                 sum += ka(ik) * sa(iss);
             }
         }
+        else if(symmetry != KERNEL_ASYMMETRIC)
+        {
+            sum = detail::convolveFolded<SumType>(is, sa, kernel, ka, kright, symmetry);
+        }
         else
         {
             KernelIterator ik = kernel + kright;
@@ -518,6 +652,8 @@ void internalConvolveLineReflect(SrcIterator is, SrcIterator iend, SrcAccessor s
             typename SrcAccessor::value_type,
             typename KernelAccessor::value_type>::Promote SumType;
 
+    KernelSymmetry symmetry = detail::kernelSymmetry(kernel, ka, kleft, kright);
+
     SrcIterator ibegin = is;
 
     if(stop == 0)
@@ -581,6 +717,10 @@ void internalConvolveLineReflect(SrcIterator is, SrcIterator iend, SrcAccessor s
                 sum += ka(ik) * sa(iss);
             }
         }
+        else if(symmetry != KERNEL_ASYMMETRIC)
+        {
+            sum = detail::convolveFolded<SumType>(is, sa, kernel, ka, kright, symmetry);
+        }
         else
         {
             SrcIterator iss = is + (-kright);
@@ -617,6 +757,8 @@ void internalConvolveLineRepeat(SrcIterator is, SrcIterator iend, SrcAccessor sa
             typename SrcAccessor::value_type,
             typename KernelAccessor::value_type>::Promote SumType;
 
+    KernelSymmetry symmetry = detail::kernelSymmetry(kernel, ka, kleft, kright);
+
     SrcIterator ibegin = is;
 
     if(stop == 0)
@@ -680,6 +822,10 @@ void internalConvolveLineRepeat(SrcIterator is, SrcIterator iend, SrcAccessor sa
                 sum += ka(ik) * sa(iss);
             }
         }
+        else if(symmetry != KERNEL_ASYMMETRIC)
+        {
+            sum = detail::convolveFolded<SumType>(is, sa, kernel, ka, kright, symmetry);
+        }
         else
         {
             SrcIterator iss = is + (-kright);
@@ -732,6 +878,8 @@ void internalConvolveLineAvoid(SrcIterator is, SrcIterator iend, SrcAccessor sa,
             typename SrcAccessor::value_type,
             typename KernelAccessor::value_type>::Promote SumType;
 
+    KernelSymmetry symmetry = detail::kernelSymmetry(kernel, ka, kleft, kright);
+
     is += start;
 
     for(int x=start; x<stop; ++x, ++is, ++id)
@@ -739,11 +887,18 @@ void internalConvolveLineAvoid(SrcIterator is, SrcIterator iend, SrcAccessor sa,
         KernelIterator ik = kernel + kright;
         SumType sum = NumericTraits<SumType>::zero();
 
-        SrcIterator iss = is + (-kright);
-        SrcIterator isend = is + (1 - kleft);
-        for(; iss != isend ; --ik, ++iss)
+        if(symmetry != KERNEL_ASYMMETRIC)
+        {
+            sum = detail::convolveFolded<SumType>(is, sa, kernel, ka, kright, symmetry);
+        }
+        else
         {
-            sum += ka(ik) * sa(iss);
+            SrcIterator iss = is + (-kright);
+            SrcIterator isend = is + (1 - kleft);
+            for(; iss != isend ; --ik, ++iss)
+            {
+                sum += ka(ik) * sa(iss);
+            }
         }
 
         da.set(detail::RequiresExplicitCast<typename
@@ -2165,6 +2320,15 @@ class Kernel1D
     BorderTreatmentMode borderTreatment() const
     { return border_treatment_; }
 
+        /** Symmetry of the kernel's current coefficients
+            (see \ref KernelSymmetry). The convolution functions use
+            this to combine pairs of equal coefficients.
+        */
+    KernelSymmetry symmetry() const
+    {
+        return detail::kernelSymmetry(center(), ConstAccessor(), left_, right_);
+    }
+
         /** Set border treatment mode.
         */
     void setBorderTreatment( BorderTreatmentMode new_mode)
@@ -2420,6 +2584,17 @@ Kernel1D<ARITHTYPE>::initGaussianDerivative(double std_dev,
     }
     dc = ARITHTYPE(dc / (2.0*radius + 1.0));
 
+    // Make the kernel exactly symmetric (even order) resp. antisymmetric
+    // (odd order), so that convolution can fold its coefficient pairs.
+    // The DC of an antisymmetric kernel vanishes.
+    for(int i=1; i<=radius; ++i)
+        kernel_[radius-i] = (order % 2) ? -kernel_[radius+i] : kernel_[radius+i];
+    if(order % 2)
+    {
+        kernel_[radius] = 0.0;
+        dc = 0.0;
+    }
+
     // remove DC, but only if kernel correction is permitted by a non-zero
     // value for norm
     if(norm != 0.0)
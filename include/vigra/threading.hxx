@@ -73,6 +73,7 @@
 #elif defined(VIGRA_NO_STD_THREADING)
 #  error "Your compiler does not support std::thread. If the boost libraries are available, consider running cmake with -DWITH_BOOST_THREAD=1"
 #else
+#  include <chrono>
 #  include <condition_variable>
 #  include <future>
 #  include <thread>
@@ -147,6 +148,11 @@ using VIGRA_THREADING_NAMESPACE::call_once;
 // Futures.
 
 using VIGRA_THREADING_NAMESPACE::future;
+using VIGRA_THREADING_NAMESPACE::future_status;
+
+// Durations for timed waits.
+
+namespace chrono = VIGRA_THREADING_NAMESPACE::chrono;
 
 // Condition variables.
 
@@ -156,6 +162,10 @@ using VIGRA_THREADING_NAMESPACE::condition_variable;
 
 using VIGRA_THREADING_NAMESPACE::packaged_task;
 
+// Promises.
+
+using VIGRA_THREADING_NAMESPACE::promise;
+
 #ifdef VIGRA_HAS_ATOMIC
 
 // contents of <atomic>
@@ -38,12 +38,39 @@
 
 #include <vector>
 #include <queue>
+#include <deque>
+#include <memory>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
 #include "mathutil.hxx"
 #include "counting_iterator.hxx"
 #include "threading.hxx"
 
+#if defined(__linux__)
+#  include <sched.h>
+#  include <pthread.h>
+#elif defined(_WIN32)
+// Declare the few Win32 functions needed for thread pinning instead of including
+// <windows.h>, whose macros (min, max, ...) would leak into every user of this header.
+// The declarations match those in <windows.h>, so that both may be included.
+extern "C" {
+#  ifdef _WIN64
+typedef unsigned __int64 vigra_ulong_ptr;
+#  else
+typedef unsigned long vigra_ulong_ptr;
+#  endif
+__declspec(dllimport) void * __stdcall GetCurrentProcess(void);
+__declspec(dllimport) void * __stdcall GetCurrentThread(void);
+__declspec(dllimport) int __stdcall GetProcessAffinityMask(void *, vigra_ulong_ptr *, vigra_ulong_ptr *);
+__declspec(dllimport) vigra_ulong_ptr __stdcall SetThreadAffinityMask(void *, vigra_ulong_ptr);
+__declspec(dllimport) int __stdcall GetNumaProcessorNode(unsigned char, unsigned char *);
+}
+#endif
+
 
 namespace vigra
 {
@@ -70,8 +97,33 @@ class ParallelOptions
         NoThreads  =  0  ///< Switch off multi-threading (i.e. execute tasks sequentially)
     };
 
+        /** Task scheduling strategies of the \ref ThreadPool.
+        */
+    enum Scheduling {
+        SharedQueue,   ///< All workers take their tasks from a single, mutex-protected queue.
+        WorkStealing   ///< Every worker owns a task deque and steals from the others when idle.
+    };
+
+        /** Placement of the worker threads on the CPUs.
+        */
+    enum ThreadPinning {
+        NoPinning,      ///< Let the operating system schedule the workers freely.
+        CompactPinning, ///< Pin worker <tt>i</tt> to the <tt>i</tt>-th CPU, filling one NUMA node after the other.
+        ScatterPinning  ///< Pin consecutive workers to CPUs on different NUMA nodes in round-robin fashion.
+    };
+
+        /** Memory placement policies of blockwise algorithms on NUMA machines.
+        */
+    enum NumaPolicy {
+        NumaAgnostic,   ///< Blocks are assigned to whichever worker is idle.
+        NumaFirstTouch  ///< Every block has a fixed home NUMA node whose workers process it preferably.
+    };
+
     ParallelOptions()
     :   numThreads_(actualNumThreads(Auto))
+    ,   scheduling_(SharedQueue)
+    ,   pinning_(NoPinning)
+    ,   numaPolicy_(NumaAgnostic)
     {}
 
         /** \brief Get desired number of threads.
@@ -114,6 +166,90 @@ class ParallelOptions
         return *this;
     }
 
+        /** \brief Get the desired scheduling strategy.
+        */
+    Scheduling getScheduling() const
+    {
+        return scheduling_;
+    }
+
+        /** \brief Select the scheduling strategy of the thread pool.
+
+            Default: <tt>ParallelOptions::SharedQueue</tt>
+
+            With <tt>SharedQueue</tt>, all tasks are pushed into one queue, and
+            all workers compete for its lock. This is adequate for a moderate number
+            of coarse-grained tasks. With <tt>WorkStealing</tt>, each worker owns a
+            separate deque. Tasks enqueued from inside a worker go to that worker's
+            deque and are executed in LIFO order, tasks enqueued from outside the pool
+            are distributed round-robin, and idle workers steal the oldest tasks from
+            their peers. This greatly reduces lock contention for many small tasks
+            on machines with many cores.
+        */
+    ParallelOptions & scheduling(Scheduling s)
+    {
+        scheduling_ = s;
+        return *this;
+    }
+
+        /** \brief Get the desired thread placement.
+        */
+    ThreadPinning getThreadPinning() const
+    {
+        return pinning_;
+    }
+
+        /** \brief Pin the workers of the thread pool to CPUs.
+
+            Default: <tt>ParallelOptions::NoPinning</tt>
+
+            Only the CPUs in the affinity mask of the process are used, so that
+            pinning respects restrictions imposed by <tt>taskset</tt>, <tt>numactl</tt>,
+            or batch schedulers. If there are more workers than CPUs, the CPUs are
+            reused cyclically. <tt>CompactPinning</tt> keeps the workers close together
+            (sharing caches and memory controllers), whereas <tt>ScatterPinning</tt>
+            spreads them over all NUMA nodes to maximize the available memory bandwidth.
+            Pinning is currently implemented on Linux and Windows, it is
+            silently ignored on other platforms.
+        */
+    ParallelOptions & threadPinning(ThreadPinning p)
+    {
+        pinning_ = p;
+        return *this;
+    }
+
+        /** \brief Get the desired NUMA memory policy.
+        */
+    NumaPolicy getNumaPolicy() const
+    {
+        return numaPolicy_;
+    }
+
+        /** \brief Select the NUMA memory policy of blockwise algorithms.
+
+            Default: <tt>ParallelOptions::NumaAgnostic</tt>
+
+            With <tt>NumaFirstTouch</tt>, blockwise algorithms assign a fixed, contiguous
+            range of blocks to every NUMA node (see \ref parallel_foreach_numa()). The
+            workers of a node process their own blocks first, but help the other nodes
+            when they run out of work, so the assignment is a preference, not a guarantee.
+            Since the assignment is the same in every pass with the same blocking,
+            repeated passes tend to access each block from the same node.
+
+            The name refers to the "first touch" page placement of the operating systems:
+            a memory page is placed on the node of the thread which first writes to it.
+            The policy does <i>not</i> move memory. In particular, a \ref MultiArray is
+            initialized by the thread constructing it, so its pages already reside on that
+            thread's node before any blockwise algorithm runs. Only memory whose pages are
+            first written by the blockwise algorithm itself benefits from the placement.
+            The policy is only effective in combination with thread pinning, because
+            workers of an unpinned pool are considered to reside on a single node.
+        */
+    ParallelOptions & numaPolicy(NumaPolicy p)
+    {
+        numaPolicy_ = p;
+        return *this;
+    }
 
   private:
         // helper function to compute the actual number of threads
@@ -131,8 +267,166 @@ class ParallelOptions
     }
 
     int numThreads_;
+    Scheduling scheduling_;
+    ThreadPinning pinning_;
+    NumaPolicy numaPolicy_;
 };
 
+namespace detail {
+
+// A logical CPU the process may run on, and the NUMA node it belongs to.
+struct CpuDescriptor
+{
+    int cpu, node;
+
+    bool operator<(CpuDescriptor const & other) const
+    {
+        return node < other.node || (node == other.node && cpu < other.cpu);
+    }
+};
+
+#if defined(__linux__)
+
+// parse a Linux CPU list such as "0-3,8-11"
+inline std::vector<int> parseCpuList(std::string const & list)
+{
+    std::vector<int> res;
+    std::string::size_type pos = 0;
+    while(pos < list.size())
+    {
+        std::string::size_type next = list.find(',', pos);
+        if(next == std::string::npos)
+            next = list.size();
+        std::string item = list.substr(pos, next - pos);
+        std::string::size_type dash = item.find('-');
+        if(item.find_first_of("0123456789") != std::string::npos)
+        {
+            int first = std::atoi(item.c_str()),
+                last  = dash == std::string::npos
+                           ? first
+                           : std::atoi(item.c_str() + dash + 1);
+            for(int c = first; c <= last; ++c)
+                res.push_back(c);
+        }
+        pos = next + 1;
+    }
+    return res;
+}
+
+#endif
+
+// Determine the usable CPUs, sorted by NUMA node. The result is computed only once.
+inline std::vector<CpuDescriptor> const & availableCpus()
+{
+    static const std::vector<CpuDescriptor> cpus = []()
+    {
+        std::vector<CpuDescriptor> res;
+#if defined(__linux__)
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if(sched_getaffinity(0, sizeof(mask), &mask) == 0)
+        {
+            std::vector<int> nodeOf(CPU_SETSIZE, 0);
+            for(int node = 0; node < 1024; ++node)
+            {
+                std::ifstream f(("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist").c_str());
+                if(!f)
+                {
+                    // node numbers may have gaps, but not many
+                    if(node > 64)
+                        break;
+                    continue;
+                }
+                std::string list;
+                std::getline(f, list);
+                for(int c : parseCpuList(list))
+                    if(c < CPU_SETSIZE)
+                        nodeOf[c] = node;
+            }
+            for(int c = 0; c < CPU_SETSIZE; ++c)
+                if(CPU_ISSET(c, &mask))
+                    res.push_back(CpuDescriptor{c, nodeOf[c]});
+        }
+#elif defined(_WIN32)
+        vigra_ulong_ptr processMask = 0, systemMask = 0;
+        if(GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+        {
+            for(int c = 0; c < (int)(8*sizeof(vigra_ulong_ptr)); ++c)
+            {
+                if((processMask >> c) & 1)
+                {
+                    unsigned char node = 0;
+                    GetNumaProcessorNode((unsigned char)c, &node);
+                    res.push_back(CpuDescriptor{c, node == 0xff ? 0 : (int)node});
+                }
+            }
+        }
+#endif
+        if(res.empty())
+        {
+            // no topology information: a single node with all CPUs
+            for(int c = 0; c < (int)threading::thread::hardware_concurrency(); ++c)
+                res.push_back(CpuDescriptor{c, 0});
+        }
+        std::sort(res.begin(), res.end());
+        return res;
+    }();
+    return cpus;
+}
+
+// Assign a CPU to each of n workers according to the pinning policy.
+inline std::vector<CpuDescriptor>
+workerCpus(size_t n, ParallelOptions::ThreadPinning pinning)
+{
+    std::vector<CpuDescriptor> const & cpus = availableCpus();
+    std::vector<CpuDescriptor> order;
+    if(pinning == ParallelOptions::ScatterPinning)
+    {
+        // take the first CPU of every node, then the second CPU of every node etc.
+        std::vector<std::vector<CpuDescriptor> > byNode;
+        for(CpuDescriptor const & c : cpus)
+        {
+            if(byNode.empty() || byNode.back().front().node != c.node)
+                byNode.push_back(std::vector<CpuDescriptor>());
+            byNode.back().push_back(c);
+        }
+        for(size_t k = 0; order.size() < cpus.size(); ++k)
+            for(auto const & node : byNode)
+                if(k < node.size())
+                    order.push_back(node[k]);
+    }
+    else
+    {
+        order = cpus;
+    }
+    std::vector<CpuDescriptor> res;
+    for(size_t i = 0; i < n; ++i)
+        res.push_back(order[i % order.size()]);
+    return res;
+}
+
+// Pin the calling thread to the given CPU. Returns false if this is not supported.
+inline bool pinCurrentThread(int cpu)
+{
+#if defined(__linux__)
+    if(cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#elif defined(_WIN32)
+    if(cpu >= (int)(8*sizeof(vigra_ulong_ptr)))
+        return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (vigra_ulong_ptr)1 << cpu) != 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+} // namespace detail
+
 /********************************************************/
 /*                                                      */
 /*                      ThreadPool                      */
@@ -155,6 +449,7 @@ class ThreadPool
      */
     ThreadPool(const ParallelOptions & options)
     :   stop(false)
+    ,   scheduling(options.getScheduling())
     {
         init(options);
     }
@@ -171,6 +466,7 @@ class ThreadPool
      */
     ThreadPool(const int n)
     :   stop(false)
+    ,   scheduling(ParallelOptions::SharedQueue)
     {
         init(ParallelOptions().numThreads(n));
     }
@@ -202,9 +498,20 @@ class ThreadPool
     void waitFinished()
     {
         threading::unique_lock<threading::mutex> lock(queue_mutex);
-        finish_condition.wait(lock, [this](){ return tasks.empty() && (busy == 0); });
+        finish_condition.wait(lock, [this](){ return tasks.empty() && queued.load() == 0 && busy.load() == 0; });
     }
 
+    /**
+     * Block until the given future is ready.
+     * When called from within a task running on this pool, the calling worker
+     * executes other pending tasks while waiting. Therefore, tasks may
+     * enqueue sub-tasks into their own pool (e.g. by nested calls to
+     * <tt>parallel_foreach</tt>) and wait for them without deadlocking.
+     * When called from any other thread, this is equivalent to <tt>fut.wait()</tt>.
+     */
+    template<class T>
+    void waitFor(threading::future<T> & fut);
+
     /**
      * Return the number of worker threads.
      */
@@ -213,36 +520,191 @@ class ThreadPool
         return workers.size();
     }
 
+    /**
+     * Return the scheduling strategy of this pool.
+     */
+    ParallelOptions::Scheduling getScheduling() const
+    {
+        return scheduling;
+    }
+
+    /**
+     * Return the number of NUMA nodes the workers are distributed over.
+     * This is 1 unless the workers are pinned (see <tt>ParallelOptions::threadPinning()</tt>).
+     */
+    int numaNodeCount() const
+    {
+        return numa_node_count;
+    }
+
+    /**
+     * Return the NUMA node worker \arg ti resides on, as an index between 0 and
+     * <tt>numaNodeCount()-1</tt> (i.e. nodes not used by this pool are skipped
+     * in the enumeration).
+     */
+    int numaNode(int ti) const
+    {
+        return worker_nodes.empty()
+                   ? 0
+                   : worker_nodes[ti];
+    }
+
 private:
 
+    // per-worker task deque for the work-stealing scheduler
+    struct WorkerQueue
+    {
+        threading::mutex mutex;
+        std::deque<std::function<void(int)> > tasks;
+    };
+
+    // the pool and worker index the current thread belongs to (if any)
+    struct WorkerIdentity
+    {
+        ThreadPool const * pool;
+        int index;
+    };
+
+    static WorkerIdentity & currentWorker()
+    {
+        static thread_local WorkerIdentity identity = { 0, -1 };
+        return identity;
+    }
+
+    // index of the calling thread in this pool, or -1 for outside threads
+    int currentWorkerIndex() const
+    {
+        WorkerIdentity const & identity = currentWorker();
+        return identity.pool == this
+                   ? identity.index
+                   : -1;
+    }
+
     // helper function to init the thread pool
     void init(const ParallelOptions & options);
 
+    // put a task into the appropriate queue and wake up a worker
+    void pushTask(std::function<void(int)> && task);
+
+    // take a task from worker ti's own deque or steal one from another worker
+    bool popTask(int ti, std::function<void(int)> & task);
+
+    // execute a task that has already been counted as busy
+    void runTask(int ti, std::function<void(int)> & task);
+
+    // execute one pending task on behalf of worker ti, if there is one
+    bool runPendingTask(int ti);
+
     // need to keep track of threads so we can join them
     std::vector<threading::thread> workers;
 
     // the task queue
     std::queue<std::function<void(int)> > tasks;
 
+    // the per-worker task deques (work-stealing mode only)
+    std::vector<std::unique_ptr<WorkerQueue> > local_queues;
+
+    // CPU assignment of pinned workers (empty if unpinned)
+    std::vector<int> worker_cpus, worker_nodes;
+    int numa_node_count;
+
     // synchronization
     threading::mutex queue_mutex;
     threading::condition_variable worker_condition;
     threading::condition_variable finish_condition;
     bool stop;
+    ParallelOptions::Scheduling scheduling;
     threading::atomic_long busy, processed;
+
+    // work-stealing bookkeeping: tasks waiting in the local deques,
+    // workers blocked on worker_condition, and the round-robin target
+    // for tasks enqueued from outside the pool
+    threading::atomic_long queued, sleeping, next_queue;
+
+    // workers blocked in waitFor()
+    threading::atomic_long waiting;
 };
 
 inline void ThreadPool::init(const ParallelOptions & options)
 {
     busy.store(0);
     processed.store(0);
+    queued.store(0);
+    sleeping.store(0);
+    next_queue.store(0);
+    waiting.store(0);
+    numa_node_count = 1;
 
     const size_t actualNThreads = options.getNumThreads();
+
+    if(options.getThreadPinning() != ParallelOptions::NoPinning && actualNThreads > 0)
+    {
+        // renumber the nodes actually used by the workers as 0, 1, ...
+        std::vector<int> nodeIds;
+        for(detail::CpuDescriptor const & c : detail::workerCpus(actualNThreads, options.getThreadPinning()))
+        {
+            std::vector<int>::iterator k = std::find(nodeIds.begin(), nodeIds.end(), c.node);
+            if(k == nodeIds.end())
+                k = nodeIds.insert(nodeIds.end(), c.node);
+            worker_cpus.push_back(c.cpu);
+            worker_nodes.push_back((int)(k - nodeIds.begin()));
+        }
+        numa_node_count = (int)nodeIds.size();
+    }
+
+    if(scheduling == ParallelOptions::WorkStealing)
+    {
+        for(size_t ti = 0; ti<actualNThreads; ++ti)
+            local_queues.emplace_back(new WorkerQueue);
+
+        for(size_t ti = 0; ti<actualNThreads; ++ti)
+        {
+            workers.emplace_back(
+                [ti,this]
+                {
+                    WorkerIdentity & identity = currentWorker();
+                    identity.pool = this;
+                    identity.index = (int)ti;
+                    if(!this->worker_cpus.empty())
+                        detail::pinCurrentThread(this->worker_cpus[ti]);
+
+                    for(;;)
+                    {
+                        std::function<void(int)> task;
+                        if(this->popTask((int)ti, task))
+                        {
+                            this->runTask((int)ti, task);
+                            continue;
+                        }
+
+                        threading::unique_lock<threading::mutex> lock(this->queue_mutex);
+
+                        // Announce that we are going to sleep before checking for new tasks.
+                        // Together with the reverse order in pushTask(), this ensures
+                        // that no wakeup gets lost.
+                        ++sleeping;
+                        this->worker_condition.wait(lock, [this]{ return this->stop || this->queued.load() > 0; });
+                        --sleeping;
+                        if(this->stop && this->queued.load() == 0)
+                            return;
+                    }
+                }
+            );
+        }
+        return;
+    }
+
     for(size_t ti = 0; ti<actualNThreads; ++ti)
     {
         workers.emplace_back(
             [ti,this]
             {
+                WorkerIdentity & identity = currentWorker();
+                identity.pool = this;
+                identity.index = (int)ti;
+                if(!this->worker_cpus.empty())
+                    detail::pinCurrentThread(this->worker_cpus[ti]);
+
                 for(;;)
                 {
                     std::function<void(int)> task;
@@ -261,10 +723,7 @@ inline void ThreadPool::init(const ParallelOptions & options)
                             task = std::move(this->tasks.front());
                             this->tasks.pop();
                             lock.unlock();
-                            task(ti);
-                            ++processed;
-                            --busy;
-                            finish_condition.notify_one();
+                            runTask((int)ti, task);
                         }
                         else if(stop)
                         {
@@ -277,6 +736,163 @@ inline void ThreadPool::init(const ParallelOptions & options)
     }
 }
 
+inline void ThreadPool::pushTask(std::function<void(int)> && task)
+{
+    if(scheduling == ParallelOptions::WorkStealing)
+    {
+        // tasks spawned by a worker stay local, others are distributed round-robin
+        int target = currentWorkerIndex();
+        if(target < 0)
+            target = (int)(next_queue.fetch_add(1) % (long)local_queues.size());
+
+        // check 'stop' under the same lock the workers use to decide
+        // whether to exit, so that no accepted task is left behind
+        threading::lock_guard<threading::mutex> lock(queue_mutex);
+
+        // don't allow enqueueing after stopping the pool
+        if(stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+
+        {
+            WorkerQueue & q = *local_queues[target];
+            threading::lock_guard<threading::mutex> queue_lock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        ++queued;
+        if(sleeping.load() > 0)
+            worker_condition.notify_one();
+        if(waiting.load() > 0)
+            finish_condition.notify_all();
+    }
+    else
+    {
+        {
+            threading::unique_lock<threading::mutex> lock(queue_mutex);
+
+            // don't allow enqueueing after stopping the pool
+            if(stop)
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+
+            tasks.emplace(std::move(task));
+            if(waiting.load() > 0)
+                finish_condition.notify_all();
+        }
+        worker_condition.notify_one();
+    }
+}
+
+inline bool ThreadPool::popTask(int ti, std::function<void(int)> & task)
+{
+    const int n = (int)local_queues.size();
+    for(int k = 0; k < n; ++k)
+    {
+        WorkerQueue & q = *local_queues[(ti + k) % n];
+        threading::lock_guard<threading::mutex> lock(q.mutex);
+        if(q.tasks.empty())
+            continue;
+        if(k == 0)
+        {
+            // own deque: newest task first (good cache locality for nested tasks)
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }
+        else
+        {
+            // steal the oldest task, which tends to represent the most work
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        // increment 'busy' before decrementing 'queued' so that
+        // waitFinished() never sees both counters at zero prematurely
+        ++busy;
+        --queued;
+        return true;
+    }
+    return false;
+}
+
+inline void ThreadPool::runTask(int ti, std::function<void(int)> & task)
+{
+    task(ti);
+    if(scheduling == ParallelOptions::WorkStealing)
+    {
+        ++processed;
+        --busy;
+        // waiters test their predicates while holding the lock, so acquiring it
+        // before the notification suffices to make sure that no wakeup gets lost
+        if(waiting.load() > 0 || (busy.load() == 0 && queued.load() == 0))
+        {
+            threading::lock_guard<threading::mutex> lock(queue_mutex);
+            finish_condition.notify_all();
+        }
+    }
+    else
+    {
+        // the shared queue needs the lock anyway: update the counters under it,
+        // so that no waiter can test its predicate between update and notification
+        threading::lock_guard<threading::mutex> lock(queue_mutex);
+        ++processed;
+        --busy;
+        // wake all waiters if a worker blocked in waitFor() may await this task,
+        // since notify_one() could pick the wrong one
+        if(waiting.load() > 0 || (busy.load() == 0 && tasks.empty()))
+            finish_condition.notify_all();
+    }
+}
+
+inline bool ThreadPool::runPendingTask(int ti)
+{
+    std::function<void(int)> task;
+    if(scheduling == ParallelOptions::WorkStealing)
+    {
+        if(!popTask(ti, task))
+            return false;
+    }
+    else
+    {
+        threading::unique_lock<threading::mutex> lock(queue_mutex);
+        if(tasks.empty())
+            return false;
+        ++busy;
+        task = std::move(tasks.front());
+        tasks.pop();
+    }
+    runTask(ti, task);
+    return true;
+}
+
+template<class T>
+inline void ThreadPool::waitFor(threading::future<T> & fut)
+{
+    const int ti = currentWorkerIndex();
+    if(ti >= 0)
+    {
+        // we are a worker of this pool: help processing the queue
+        // instead of blocking a thread the awaited task may depend on
+        auto ready = [&fut]()
+        {
+            return fut.wait_for(threading::chrono::seconds(0)) == threading::future_status::ready;
+        };
+        while(!ready())
+        {
+            if(runPendingTask(ti))
+                continue;
+
+            // nothing to do: sleep until a task finishes or a new one arrives
+            threading::unique_lock<threading::mutex> lock(queue_mutex);
+            ++waiting;
+            finish_condition.wait(lock, [&]{
+                return ready() ||
+                       (scheduling == ParallelOptions::WorkStealing
+                            ? queued.load() > 0
+                            : !tasks.empty());
+            });
+            --waiting;
+        }
+    }
+    fut.wait();
+}
+
 inline ThreadPool::~ThreadPool()
 {
     {
@@ -299,21 +915,12 @@ ThreadPool::enqueueReturning(F&& f) -> threading::future<decltype(f(0))>
     auto res = task->get_future();
 
     if(workers.size()>0){
-        {
-            threading::unique_lock<threading::mutex> lock(queue_mutex);
-
-            // don't allow enqueueing after stopping the pool
-            if(stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
-
-            tasks.emplace(
-                [task](int tid)
-                {
-                    (*task)(std::move(tid));
-                }
-            );
-        }
-        worker_condition.notify_one();
+        pushTask(
+            [task](int tid)
+            {
+                (*task)(std::move(tid));
+            }
+        );
     }
     else{
         (*task)(0);
@@ -343,26 +950,17 @@ ThreadPool::enqueue(F&& f)
 
     auto res = task->get_future();
     if(workers.size()>0){
-        {
-            threading::unique_lock<threading::mutex> lock(queue_mutex);
-
-            // don't allow enqueueing after stopping the pool
-            if(stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
-
-            tasks.emplace(
-               [task](int tid)
-               {
+        pushTask(
+           [task](int tid)
+           {
 #if defined(USE_BOOST_THREAD) && \
     !defined(BOOST_THREAD_PROVIDES_VARIADIC_THREAD)
-                    (*task)();
+                (*task)();
 #else
-                    (*task)(std::move(tid));
+                (*task)(std::move(tid));
 #endif
-               }
-            );
-        }
-        worker_condition.notify_one();
+           }
+        );
     }
     else{
 #if defined(USE_BOOST_THREAD) && \
@@ -417,6 +1015,7 @@ inline void parallel_foreach_impl(
     }
     for (auto & fut : futures)
     {
+        pool.waitFor(fut);
         fut.get();
     }
 }
@@ -471,7 +1070,10 @@ inline void parallel_foreach_impl(
             break;
     }
     for (auto & fut : futures)
+    {
+        pool.waitFor(fut);
         fut.get();
+    }
 }
 
 
@@ -502,7 +1104,10 @@ inline void parallel_foreach_impl(
     }
     vigra_postcondition(num_items == nItems || nItems == 0, "parallel_foreach(): Mismatch between num items and begin/end.");
     for (auto & fut : futures)
+    {
+        pool.waitFor(fut);
         fut.get();
+    }
 }
 
 // Runs foreach on a single thread.
@@ -677,6 +1282,466 @@ inline void parallel_foreach(
     parallel_foreach(threadpool, iter, iter.end(), f, nItems);
 }
 
+/** \brief Apply a functor to the integers <tt>0 ... nItems-1</tt>, with a fixed item-to-node assignment.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template<class F>
+        void parallel_foreach_numa(ThreadPool & pool,
+                                   std::ptrdiff_t nItems,
+                                   F && f);
+    }
+    \endcode
+
+    The items are divided into <tt>pool.numaNodeCount()</tt> contiguous ranges of
+    equal size, and the range with index <tt>k</tt> is preferably processed by the
+    workers on NUMA node <tt>k</tt>. Only when a node has finished its own items,
+    its workers help the other nodes, so that the load stays balanced. Since the
+    assignment only depends on <tt>nItems</tt> and the pool's topology, repeated calls
+    with the same arguments access the same data from the same node. This is the
+    basis of the <tt>ParallelOptions::NumaFirstTouch</tt> policy of the blockwise
+    algorithms. As in \ref parallel_foreach(), \arg f is called as
+    <tt>f(thread_id, item)</tt>.
+
+    If the pool is not pinned (and thus has a single node), this is equivalent to
+    \ref parallel_foreach() with dynamic, item-wise scheduling.
+*/
+template <class F>
+inline void
+parallel_foreach_numa(ThreadPool & pool, std::ptrdiff_t nItems, F && f)
+{
+    if(pool.nThreads() <= 1)
+    {
+        for(std::ptrdiff_t i = 0; i < nItems; ++i)
+            f(0, i);
+        return;
+    }
+
+    const int nNodes = pool.numaNodeCount();
+    std::vector<std::ptrdiff_t> nodeEnd(nNodes);
+    std::unique_ptr<threading::atomic_long[]> nodeNext(new threading::atomic_long[nNodes]);
+    for(int k = 0; k < nNodes; ++k)
+    {
+        nodeNext[k].store((long)(k * nItems / nNodes));
+        nodeEnd[k] = (k + 1) * nItems / nNodes;
+    }
+
+    std::vector<threading::future<void> > futures;
+    for(size_t t = 0; t < pool.nThreads(); ++t)
+    {
+        futures.emplace_back(
+            pool.enqueue(
+                [&f, &pool, &nodeNext, &nodeEnd, nNodes](int id)
+                {
+                    // own node first, then help the others
+                    const int home = pool.numaNode(id);
+                    for(int k = 0; k < nNodes; ++k)
+                    {
+                        const int node = (home + k) % nNodes;
+                        for(std::ptrdiff_t i = nodeNext[node].fetch_add(1); i < nodeEnd[node];
+                            i = nodeNext[node].fetch_add(1))
+                        {
+                            try
+                            {
+                                f(id, i);
+                            }
+                            catch(...)
+                            {
+                                // skip all remaining items
+                                for(int n = 0; n < nNodes; ++n)
+                                    nodeNext[n].store((long)nodeEnd[n]);
+                                throw;
+                            }
+                        }
+                    }
+                }
+            )
+        );
+    }
+    for (auto & fut : futures)
+        pool.waitFor(fut);
+    for (auto & fut : futures)
+        fut.get();
+}
+
+/********************************************************/
+/*                                                      */
+/*             parallel_for, parallel_reduce            */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Chunking strategies for \ref parallel_for() and \ref parallel_reduce().
+    */
+enum ParallelChunking
+{
+    StaticChunking,  ///< One contiguous piece per thread (least overhead, for uniform item cost).
+    DynamicChunking, ///< Pieces of exactly <tt>grain</tt> items, handed out on demand.
+    GuidedChunking   ///< Pieces of <tt>remaining/(2*nThreads)</tt> items, shrinking down to <tt>grain</tt>.
+};
+
+namespace detail {
+
+// Total amount of work (in units of the cost hint) that a piece should at least
+// represent to amortize the scheduling overhead. Smaller ranges are processed
+// sequentially.
+static const double parallel_for_min_chunk_cost = 16384.0;
+
+// Hands out consecutive pieces of [0, size) to the tasks of parallel_for()
+// and parallel_reduce(). Pieces are obtained lock-free from a shared counter,
+// so only one task per thread is enqueued, regardless of the number of pieces.
+class ParallelChunkScheduler
+{
+  public:
+    ParallelChunkScheduler(std::ptrdiff_t size, std::ptrdiff_t grain,
+                           std::ptrdiff_t nTasks, ParallelChunking chunking)
+    :   size_(size)
+    ,   grain_(grain)
+    ,   nTasks_(nTasks)
+    ,   chunking_(chunking)
+    ,   next_(0)
+    {
+        if(chunking_ == StaticChunking)
+            grain_ = (size_ + nTasks_ - 1) / nTasks_;
+    }
+
+        // get the next piece [begin, end), return false when the range is exhausted
+    bool next(std::ptrdiff_t & begin, std::ptrdiff_t & end)
+    {
+        if(chunking_ == GuidedChunking)
+        {
+            std::ptrdiff_t current = next_.load();
+            for(;;)
+            {
+                if(current >= size_)
+                    return false;
+                std::ptrdiff_t piece = std::max<std::ptrdiff_t>(grain_, (size_ - current) / (2*nTasks_));
+                std::ptrdiff_t stop  = std::min<std::ptrdiff_t>(size_, current + piece);
+                if(next_.compare_exchange_weak(current, stop))
+                {
+                    begin = current;
+                    end   = stop;
+                    return true;
+                }
+            }
+        }
+        begin = next_.fetch_add(grain_);
+        if(begin >= size_)
+            return false;
+        end = std::min<std::ptrdiff_t>(size_, begin + grain_);
+        return true;
+    }
+
+        // make all subsequent calls to next() fail (e.g. after an exception)
+    void cancel()
+    {
+        next_.store(size_);
+    }
+
+  private:
+    std::ptrdiff_t size_, grain_, nTasks_;
+    ParallelChunking chunking_;
+    // not atomic_long, which has only 32 bits on 64-bit Windows
+    threading::atomic<std::ptrdiff_t> next_;
+};
+
+// Compute the grain size and the number of tasks for a range of the given size.
+// Returns 0 when the range should be processed sequentially.
+inline std::ptrdiff_t
+parallelForTaskCount(ThreadPool const & pool, std::ptrdiff_t size,
+                     std::ptrdiff_t & grain, double costHint)
+{
+    vigra_precondition(costHint > 0.0,
+        "parallel_for(): costHint must be positive.");
+    if(grain <= 0)
+        grain = std::max<std::ptrdiff_t>(1, (std::ptrdiff_t)std::ceil(parallel_for_min_chunk_cost / costHint));
+    if(pool.nThreads() <= 1 || size <= grain ||
+       (double)size * costHint <= parallel_for_min_chunk_cost)
+        return 0;
+    return std::min<std::ptrdiff_t>(pool.nThreads(), (size + grain - 1) / grain);
+}
+
+template <class T>
+inline CountingIterator<T>
+countingSubrange(CountingIterator<T> const & r, std::ptrdiff_t begin, std::ptrdiff_t end)
+{
+    return CountingIterator<T>(r[begin], r[end], r[1] - r[0]);
+}
+
+} // namespace detail
+
+/** \brief Apply a functor to all pieces of an index range in parallel.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        // use an existing thread pool
+        template<class T, class F>
+        void parallel_for(ThreadPool & pool,
+                          CountingIterator<T> const & range,
+                          std::ptrdiff_t grain,
+                          F && f,
+                          ParallelChunking chunking = GuidedChunking,
+                          double costHint = 1.0);
+
+        // pass the desired number of threads or ParallelOptions::Auto
+        // (creates an internal thread pool accordingly)
+        template<class T, class F>
+        void parallel_for(int64_t nThreads,
+                          CountingIterator<T> const & range,
+                          std::ptrdiff_t grain,
+                          F && f,
+                          ParallelChunking chunking = GuidedChunking,
+                          double costHint = 1.0);
+    }
+    \endcode
+
+    The index range (usually created by one of the <tt>range()</tt> factory functions)
+    is split into contiguous pieces which are passed to the functor \arg f.
+    \arg f must be callable with two arguments: the thread index (starting at 0)
+    and a <tt>CountingIterator<T></tt> representing the piece, which can be
+    traversed by a range-based for-loop. In contrast to \ref parallel_foreach(), only
+    one task per thread is enqueued. The tasks fetch pieces from a shared atomic
+    counter until the range is exhausted, so no futures are allocated per piece,
+    and the tight inner loop over a piece can be optimized by the compiler.
+
+    The <tt>chunking</tt> parameter determines the piece sizes:
+
+    <ul>
+    <li><tt>StaticChunking</tt>: one piece of size <tt>range_size / nThreads</tt> per thread.
+         This has the least overhead when all items are equally expensive.
+    <li><tt>DynamicChunking</tt>: pieces of exactly <tt>grain</tt> items are handed out
+         to the threads on demand. This compensates for strongly varying item cost.
+    <li><tt>GuidedChunking</tt> (default): pieces start with <tt>range_size / (2*nThreads)</tt>
+         items and become smaller as the range is consumed, but never smaller
+         than <tt>grain</tt>. This combines low overhead with good load balancing.
+    </ul>
+
+    <tt>costHint</tt> is the estimated cost of a single item in units of an elementary
+    arithmetic operation (e.g. 1 for a per-pixel addition, some thousands for the
+    prediction of a random forest). If <tt>grain <= 0</tt>, the grain size is
+    derived from <tt>costHint</tt> such that every piece represents enough work
+    to amortize the scheduling overhead. Likewise, if the total work is below
+    that threshold, or the pool has at most one thread, the functor is simply called
+    once with the entire range in the present thread.
+
+    If the functor throws an exception, the remaining pieces are skipped, and the
+    exception is re-thrown in the calling thread.
+
+    <b>Usage:</b>
+
+    \code
+    std::vector<float> a(n), b(n);
+    ...
+    ThreadPool pool(ParallelOptions::Auto);
+    parallel_for(pool, range(n), 0,
+        [&](int thread_id, CountingIterator<std::ptrdiff_t> piece)
+        {
+            for(auto i: piece)
+                b[i] = std::sqrt(a[i]);
+        },
+        StaticChunking);
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void parallel_for)
+
+template <class T, class F>
+inline void
+parallel_for(ThreadPool & pool,
+             CountingIterator<T> const & range,
+             std::ptrdiff_t grain,
+             F && f,
+             ParallelChunking chunking = GuidedChunking,
+             double costHint = 1.0)
+{
+    const std::ptrdiff_t size = range.end() - range.begin();
+    if(size <= 0)
+        return;
+    const std::ptrdiff_t nTasks = detail::parallelForTaskCount(pool, size, grain, costHint);
+    if(nTasks == 0)
+    {
+        f(0, range);
+        return;
+    }
+
+    detail::ParallelChunkScheduler scheduler(size, grain, nTasks, chunking);
+    std::vector<threading::future<void> > futures;
+    for(std::ptrdiff_t k = 0; k < nTasks; ++k)
+    {
+        futures.emplace_back(
+            pool.enqueue(
+                [&f, &range, &scheduler](int id)
+                {
+                    std::ptrdiff_t begin, end;
+                    try
+                    {
+                        while(scheduler.next(begin, end))
+                            f(id, detail::countingSubrange(range, begin, end));
+                    }
+                    catch(...)
+                    {
+                        scheduler.cancel();
+                        throw;
+                    }
+                }
+            )
+        );
+    }
+    // all tasks refer to local variables, so wait for all of them before re-throwing
+    for (auto & fut : futures)
+        pool.waitFor(fut);
+    for (auto & fut : futures)
+        fut.get();
+}
+
+template <class T, class F>
+inline void
+parallel_for(int64_t nThreads,
+             CountingIterator<T> const & range,
+             std::ptrdiff_t grain,
+             F && f,
+             ParallelChunking chunking = GuidedChunking,
+             double costHint = 1.0)
+{
+    ThreadPool pool(nThreads);
+    parallel_for(pool, range, grain, f, chunking, costHint);
+}
+
+/** \brief Reduce an index range in parallel, using thread-local accumulators.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        // use an existing thread pool
+        template<class T, class ACC, class F, class COMBINE>
+        ACC parallel_reduce(ThreadPool & pool,
+                            CountingIterator<T> const & range,
+                            std::ptrdiff_t grain,
+                            ACC const & identity,
+                            F && f,
+                            COMBINE && combine,
+                            ParallelChunking chunking = GuidedChunking,
+                            double costHint = 1.0);
+
+        // pass the desired number of threads or ParallelOptions::Auto
+        // (creates an internal thread pool accordingly)
+        template<class T, class ACC, class F, class COMBINE>
+        ACC parallel_reduce(int64_t nThreads,
+                            CountingIterator<T> const & range,
+                            std::ptrdiff_t grain,
+                            ACC const & identity,
+                            F && f,
+                            COMBINE && combine,
+                            ParallelChunking chunking = GuidedChunking,
+                            double costHint = 1.0);
+    }
+    \endcode
+
+    Splits the range into pieces exactly like \ref parallel_for(). Each task owns
+    a private accumulator, initialized with \arg identity, and calls
+    <tt>f(accumulator, piece)</tt> for every piece it obtains. Thus, the
+    accumulators are never shared between threads, and no locking or atomic
+    operations are needed in \arg f. Finally, the task results are merged by
+    <tt>accumulator = combine(accumulator, other)</tt> in the calling thread.
+
+    \arg identity must be the neutral element of \arg combine (e.g. 0 for a sum),
+    because it is used to initialize every task's accumulator. Since the
+    assignment of pieces to tasks is not deterministic, the order of combination
+    may vary between calls, which is visible for non-associative operations
+    such as floating-point sums.
+
+    <b>Usage:</b>
+
+    \code
+    std::vector<double> data(n);
+    ...
+    double sum = parallel_reduce(ParallelOptions::Auto, range(n), 0, 0.0,
+        [&data](double & acc, CountingIterator<std::ptrdiff_t> piece)
+        {
+            for(auto i: piece)
+                acc += data[i];
+        },
+        [](double a, double b) { return a + b; });
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void parallel_reduce)
+
+template <class T, class ACC, class F, class COMBINE>
+inline ACC
+parallel_reduce(ThreadPool & pool,
+                CountingIterator<T> const & range,
+                std::ptrdiff_t grain,
+                ACC const & identity,
+                F && f,
+                COMBINE && combine,
+                ParallelChunking chunking = GuidedChunking,
+                double costHint = 1.0)
+{
+    ACC result(identity);
+    const std::ptrdiff_t size = range.end() - range.begin();
+    if(size <= 0)
+        return result;
+    const std::ptrdiff_t nTasks = detail::parallelForTaskCount(pool, size, grain, costHint);
+    if(nTasks == 0)
+    {
+        f(result, range);
+        return result;
+    }
+
+    detail::ParallelChunkScheduler scheduler(size, grain, nTasks, chunking);
+    std::vector<ACC> partialResults(nTasks, identity);
+    std::vector<threading::future<void> > futures;
+    for(std::ptrdiff_t k = 0; k < nTasks; ++k)
+    {
+        futures.emplace_back(
+            pool.enqueue(
+                [&f, &range, &scheduler, &identity, &partialResults, k](int)
+                {
+                    // accumulate on the stack to avoid false sharing in partialResults
+                    ACC acc(identity);
+                    std::ptrdiff_t begin, end;
+                    try
+                    {
+                        while(scheduler.next(begin, end))
+                            f(acc, detail::countingSubrange(range, begin, end));
+                    }
+                    catch(...)
+                    {
+                        scheduler.cancel();
+                        throw;
+                    }
+                    partialResults[k] = std::move(acc);
+                }
+            )
+        );
+    }
+    for (auto & fut : futures)
+        pool.waitFor(fut);
+    for (auto & fut : futures)
+        fut.get();
+    for(auto & partial : partialResults)
+        result = combine(result, partial);
+    return result;
+}
+
+template <class T, class ACC, class F, class COMBINE>
+inline ACC
+parallel_reduce(int64_t nThreads,
+                CountingIterator<T> const & range,
+                std::ptrdiff_t grain,
+                ACC const & identity,
+                F && f,
+                COMBINE && combine,
+                ParallelChunking chunking = GuidedChunking,
+                double costHint = 1.0)
+{
+    ThreadPool pool(nThreads);
+    return parallel_reduce(pool, range, grain, identity, f, combine, chunking, costHint);
+}
+
 //@}
 
 } // namespace vigra
@@ -39,12 +39,14 @@
 
 /*std*/
 #include <map>
+#include <vector>
 
 /*vigra*/
 #include "config.hxx"
 #include "error.hxx"
 #include "array_vector.hxx"
 #include "iteratoradapter.hxx"
+#include "threading.hxx"
 
 namespace vigra {
 
@@ -321,6 +323,170 @@ class UnionFindArray
     }
 };
 
+/********************************************************/
+/*                                                      */
+/*               ConcurrentUnionFindArray               */
+/*                                                      */
+/********************************************************/
+
+namespace detail {
+
+#ifdef VIGRA_SINGLE_THREADED
+
+    // stand-in for threading::atomic<T> when threading is disabled
+template <class T>
+class UnionFindEntry
+{
+    T value_;
+
+  public:
+    UnionFindEntry()
+    : value_()
+    {}
+
+    T load() const
+    {
+        return value_;
+    }
+
+    void store(T t)
+    {
+        value_ = t;
+    }
+
+    bool compare_exchange_weak(T & expected, T desired)
+    {
+        if(value_ != expected)
+        {
+            expected = value_;
+            return false;
+        }
+        value_ = desired;
+        return true;
+    }
+};
+
+#else
+
+template <class T>
+class UnionFindEntry
+: public threading::atomic<T>
+{};
+
+#endif
+
+} // namespace detail
+
+    /** \brief Union-find structure that can be modified by several threads concurrently.
+
+        In contrast to \ref UnionFindArray, the number of elements is fixed at construction,
+        and every element starts as a singleton set. makeUnion() and findIndex() may be called
+        from any number of threads at the same time without locking: roots are linked with
+        an atomic compare-and-swap (which is retried when another thread modified one of the
+        trees in the meantime), and findIndex() shortens the paths it traverses by
+        <i>path splitting</i> (every visited element is linked to its grandparent).
+
+        The larger root is always linked below the smaller one. Therefore, the representative
+        of each set is its smallest element, regardless of the order in which the unions
+        were performed. This makes it easy to derive a canonical labeling from the final
+        structure.
+
+        <b>\#include</b> \<vigra/union_find.hxx\><br>
+        Namespace: vigra
+    */
+template <class T>
+class ConcurrentUnionFindArray
+{
+    typedef detail::UnionFindEntry<T> Entry;
+
+    mutable std::vector<Entry> parents_;
+
+  public:
+
+        /** \brief Create a structure with <tt>size</tt> singleton sets.
+        */
+    explicit ConcurrentUnionFindArray(std::size_t size = 0)
+    {
+        reset(size);
+    }
+
+        /** \brief Re-initialize with <tt>size</tt> singleton sets.
+
+            This function must not be called concurrently with any other member function.
+        */
+    void reset(std::size_t size)
+    {
+        vigra_precondition(size == 0 || size - 1 <= (std::size_t)NumericTraits<T>::max(),
+           "ConcurrentUnionFindArray(): Need more labels than can be represented "
+           "in the index type.");
+
+        std::vector<Entry>(size).swap(parents_);
+        for(std::size_t k=0; k < size; ++k)
+            parents_[k].store((T)k);
+    }
+
+        /** \brief Number of elements.
+        */
+    std::size_t size() const
+    {
+        return parents_.size();
+    }
+
+        /** \brief Check if <tt>index</tt> is currently the representative of its set.
+        */
+    bool isRoot(T index) const
+    {
+        return parents_[index].load() == index;
+    }
+
+        /** \brief Find the representative of the set containing <tt>index</tt>.
+
+            Paths are shortened by path splitting as a side effect.
+        */
+    T findIndex(T index) const
+    {
+        T parent = parents_[index].load();
+        while(parent != index)
+        {
+            T grandparent = parents_[parent].load();
+            if(grandparent != parent)
+            {
+                // failure means that another thread shortened the path already,
+                // so we just continue from the grandparent in either case
+                T expected = parent;
+                parents_[index].compare_exchange_weak(expected, grandparent);
+            }
+            index = parent;
+            parent = grandparent;
+        }
+        return index;
+    }
+
+        /** \brief Merge the sets containing <tt>l1</tt> and <tt>l2</tt>.
+
+            Returns the smaller one of the two old representatives, which becomes the
+            representative of the merged set. When other threads call makeUnion()
+            at the same time, this set may already have been merged further by the
+            time the function returns.
+        */
+    T makeUnion(T l1, T l2)
+    {
+        while(true)
+        {
+            l1 = findIndex(l1);
+            l2 = findIndex(l2);
+            if(l1 == l2)
+                return l1;
+            if(l2 < l1)
+                std::swap(l1, l2);
+            // link l2 below l1, provided that l2 is still a root
+            T expected = l2;
+            if(parents_[l2].compare_exchange_weak(expected, l1))
+                return l1;
+        }
+    }
+};
+
 } // namespace vigra
 
 #endif // VIGRA_UNION_FIND_HXX
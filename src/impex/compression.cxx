@@ -41,8 +41,103 @@
 #include <zlib.h>
 #endif
 
+#ifdef HasZSTD
+#include <zstd.h>
+#endif
+
+#ifndef VIGRA_SINGLE_THREADED
+#include "vigra/threadpool.hxx"
+#endif
+
 namespace vigra {
 
+// Transpose the bytes of 'size/elementSize' elements, such that all first bytes
+// come first, followed by all second bytes etc. (like Blosc's shuffle filter).
+// If 'bits' is true, the bits within each byte plane are transposed as well,
+// so that bits of equal significance are grouped together (like Blosc's
+// bitshuffle). Incomplete elements at the end are copied unchanged.
+void shuffleImpl(char const * source, std::size_t size, char * dest,
+                 std::size_t elementSize, bool bits)
+{
+    std::size_t count = size / elementSize,
+                shuffled = count * elementSize;
+    if(!bits)
+    {
+        for(std::size_t b=0; b<elementSize; ++b)
+        {
+            char * d = dest + b*count;
+            char const * s = source + b;
+            for(std::size_t i=0; i<count; ++i, s += elementSize)
+                d[i] = *s;
+        }
+    }
+    else
+    {
+        ArrayVector<char> planes(shuffled);
+        shuffleImpl(source, shuffled, planes.data(), elementSize, false);
+        // transpose the bits of groups of 8 bytes within each byte plane
+        std::size_t groups = count / 8;
+        for(std::size_t b=0; b<elementSize; ++b)
+        {
+            unsigned char const * s = (unsigned char const *)planes.data() + b*count;
+            unsigned char * d = (unsigned char *)dest + b*count;
+            for(int k=0; k<8; ++k)
+            {
+                for(std::size_t j=0; j<groups; ++j)
+                {
+                    unsigned char v = 0;
+                    for(int l=0; l<8; ++l)
+                        v |= ((s[8*j+l] >> k) & 1) << l;
+                    d[k*groups+j] = v;
+                }
+            }
+            std::copy(s + 8*groups, s + count, d + 8*groups);
+        }
+    }
+    std::copy(source + shuffled, source + size, dest + shuffled);
+}
+
+// Inverse of shuffleImpl().
+void unshuffleImpl(char const * source, std::size_t size, char * dest,
+                   std::size_t elementSize, bool bits)
+{
+    std::size_t count = size / elementSize,
+                shuffled = count * elementSize;
+    if(!bits)
+    {
+        for(std::size_t b=0; b<elementSize; ++b)
+        {
+            char const * s = source + b*count;
+            char * d = dest + b;
+            for(std::size_t i=0; i<count; ++i, d += elementSize)
+                *d = s[i];
+        }
+    }
+    else
+    {
+        ArrayVector<char> planes(shuffled);
+        std::size_t groups = count / 8;
+        for(std::size_t b=0; b<elementSize; ++b)
+        {
+            unsigned char const * s = (unsigned char const *)source + b*count;
+            unsigned char * d = (unsigned char *)planes.data() + b*count;
+            for(std::size_t j=0; j<groups; ++j)
+            {
+                for(int l=0; l<8; ++l)
+                {
+                    unsigned char v = 0;
+                    for(int k=0; k<8; ++k)
+                        v |= ((s[k*groups+j] >> l) & 1) << k;
+                    d[8*j+l] = v;
+                }
+            }
+            std::copy(s + 8*groups, s + count, d + 8*groups);
+        }
+        unshuffleImpl(planes.data(), shuffled, dest, elementSize, false);
+    }
+    std::copy(source + shuffled, source + size, dest + shuffled);
+}
+
 std::size_t compressImpl(char const * source, std::size_t srcSize, 
                          ArrayVector<char> & buffer,
                          CompressionMethod method)
@@ -79,6 +174,23 @@ std::size_t compressImpl(char const * source, std::size_t srcSize,
         vigra_postcondition(destSize > 0, "compress(): lz4 compression failed.");
         return destSize;
       }
+      case ZSTD_FAST:
+      case ZSTD:
+      case ZSTD_BEST:
+      default:
+      {
+        vigra_precondition(isZstdCompression(method), "compress(): Unknown compression method.");
+    #ifdef HasZSTD
+        std::size_t destSize = ::ZSTD_compressBound(srcSize);
+        buffer.resize(destSize);
+        destSize = ::ZSTD_compress(buffer.data(), destSize, source, srcSize, method - ZSTD_FAST + 1);
+        vigra_postcondition(!::ZSTD_isError(destSize), "compress(): zstd compression failed.");
+        return destSize;
+    #else
+        vigra_precondition(false, "compress(): VIGRA was compiled without ZSTD compression.");
+        return 0;
+    #endif
+      }
 
 #if 0  // currently unsupported
       case SNAPPY:
@@ -112,29 +224,52 @@ std::size_t compressImpl(char const * source, std::size_t srcSize,
     #endif
       }
 #endif
-      default:
-        vigra_precondition(false, "compress(): Unknown compression method.");
     }
     return 0;
 }
 
-void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method)
+std::size_t compressShuffled(char const * source, std::size_t size,
+                             ArrayVector<char> & buffer, CompressionMethod method,
+                             CompressionShuffle shuffle, std::size_t elementSize)
+{
+    vigra_precondition(elementSize > 0, "compress(): elementSize must be positive.");
+    if(shuffle == NO_SHUFFLE || (shuffle == BYTE_SHUFFLE && elementSize == 1))
+        return compressImpl(source, size, buffer, method);
+
+    ArrayVector<char> shuffled(size);
+    shuffleImpl(source, size, shuffled.data(), elementSize, shuffle == BIT_SHUFFLE);
+    return compressImpl(shuffled.data(), size, buffer, method);
+}
+
+void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method,
+              CompressionShuffle shuffle, std::size_t elementSize)
 {
     ArrayVector<char> buffer;
-    std::size_t destSize = compressImpl(source, size, buffer, method);
+    std::size_t destSize = compressShuffled(source, size, buffer, method, shuffle, elementSize);
     dest.resize(destSize);
     std::copy(buffer.data(), buffer.data() + destSize, dest.begin());
 }
 
-void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method)
+void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method,
+              CompressionShuffle shuffle, std::size_t elementSize)
 {
     ArrayVector<char> buffer;
-    std::size_t destSize = compressImpl(source, size, buffer, method);
+    std::size_t destSize = compressShuffled(source, size, buffer, method, shuffle, elementSize);
     dest.insert(dest.begin(), buffer.data(), buffer.data() + destSize);
 }
 
-void uncompress(char const * source, std::size_t srcSize, 
-                char * dest, std::size_t destSize, CompressionMethod method)
+void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method)
+{
+    compress(source, size, dest, method, NO_SHUFFLE, 1);
+}
+
+void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method)
+{
+    compress(source, size, dest, method, NO_SHUFFLE, 1);
+}
+
+void uncompressImpl(char const * source, std::size_t srcSize, 
+                    char * dest, std::size_t destSize, CompressionMethod method)
 {
     switch(method)
     {
@@ -188,11 +323,225 @@ void uncompress(char const * source, std::size_t srcSize,
         break;
       }
 #endif
+      case ZSTD_FAST:
+      case ZSTD:
+      case ZSTD_BEST:
       default:
-        vigra_precondition(false, "uncompress(): Unknown compression method.");
+      {
+        vigra_precondition(isZstdCompression(method), "uncompress(): Unknown compression method.");
+    #ifdef HasZSTD
+        std::size_t res = ::ZSTD_decompress(dest, destSize, source, srcSize);
+        vigra_postcondition(!::ZSTD_isError(res) && res == destSize, "uncompress(): zstd decompression failed.");
+    #else
+        vigra_precondition(false, "uncompress(): VIGRA was compiled without ZSTD compression.");
+    #endif
+        break;
+      }
     }
 }
 
+void uncompress(char const * source, std::size_t srcSize, 
+                char * dest, std::size_t destSize, CompressionMethod method,
+                CompressionShuffle shuffle, std::size_t elementSize)
+{
+    vigra_precondition(elementSize > 0, "uncompress(): elementSize must be positive.");
+    if(shuffle == NO_SHUFFLE || (shuffle == BYTE_SHUFFLE && elementSize == 1))
+    {
+        uncompressImpl(source, srcSize, dest, destSize, method);
+        return;
+    }
+
+    ArrayVector<char> shuffled(destSize);
+    uncompressImpl(source, srcSize, shuffled.data(), destSize, method);
+    unshuffleImpl(shuffled.data(), destSize, dest, elementSize, shuffle == BIT_SHUFFLE);
+}
+
+void uncompress(char const * source, std::size_t srcSize, 
+                char * dest, std::size_t destSize, CompressionMethod method)
+{
+    uncompressImpl(source, srcSize, dest, destSize, method);
+}
+
+/********************************************************/
+/*                                                      */
+/*                   framed compression                 */
+/*                                                      */
+/********************************************************/
+
+/* Layout of a framed buffer (all integers little endian):
+
+     bytes  0- 3: magic "VFRM"
+     byte      4: format version (currently 1)
+     byte      5: shuffle mode
+     bytes  6- 7: element size
+     bytes  8-11: compression method (signed)
+     bytes 12-15: reserved
+     bytes 16-23: uncompressed size
+     bytes 24-31: frame size (uncompressed, the last frame may be shorter)
+     bytes 32-39: number of frames
+     then       : compressed size of each frame (8 bytes each)
+     then       : the compressed frames
+*/
+static const char framedMagic[4] = { 'V', 'F', 'R', 'M' };
+static const std::size_t framedHeaderSize = 40;
+
+static void writeLittleEndian(char * p, UInt64 v, int bytes)
+{
+    for(int k=0; k<bytes; ++k, v >>= 8)
+        p[k] = char(v & 0xff);
+}
+
+static UInt64 readLittleEndian(char const * p, int bytes)
+{
+    UInt64 v = 0;
+    for(int k=bytes-1; k>=0; --k)
+        v = (v << 8) | (unsigned char)p[k];
+    return v;
+}
+
+// Number of frames needed for 'size' bytes (without overflow for huge frame sizes).
+static std::size_t framedFrameCount(std::size_t size, std::size_t frameSize)
+{
+    return size / frameSize + (size % frameSize != 0 ? 1 : 0);
+}
+
+// Call f(k) for k in [0, count), in parallel if possible.
+template <class F>
+static void forEachFrame(std::size_t count, ParallelOptions const & options, F f)
+{
+#ifndef VIGRA_SINGLE_THREADED
+    if(count > 1 && options.getActualNumThreads() > 1)
+    {
+        ThreadPool pool(ParallelOptions(options).numThreads(
+                           std::min<int>(options.getActualNumThreads(), (int)count)));
+        parallel_foreach(pool, (std::ptrdiff_t)count,
+            [&f](int, std::ptrdiff_t k)
+            {
+                f((std::size_t)k);
+            });
+        return;
+    }
+#else
+    ignore_argument(options);
+#endif
+    for(std::size_t k=0; k<count; ++k)
+        f(k);
+}
+
+std::size_t compressFramedImpl(char const * source, std::size_t size, ArrayVector<char> & buffer,
+                               CompressionMethod method, ParallelOptions const & options,
+                               std::size_t frameSize, CompressionShuffle shuffle, std::size_t elementSize)
+{
+    vigra_precondition(elementSize > 0 && elementSize < (1 << 16),
+        "compressFramed(): elementSize must be in [1, 65535].");
+    if(method == DEFAULT_COMPRESSION)
+        method = LZ4;
+
+    // frames must contain complete elements, so that shuffling works frame by frame
+    frameSize = std::max(frameSize - frameSize % elementSize, elementSize);
+    std::size_t frameCount = framedFrameCount(size, frameSize);
+
+    ArrayVector<ArrayVector<char> > frames(frameCount);
+    forEachFrame(frameCount, options,
+        [&](std::size_t k)
+        {
+            std::size_t begin = k*frameSize,
+                        length = std::min(frameSize, size - begin);
+            compress(source + begin, length, frames[k], method, shuffle, elementSize);
+        });
+
+    std::size_t total = framedHeaderSize + 8*frameCount;
+    for(std::size_t k=0; k<frameCount; ++k)
+        total += frames[k].size();
+    buffer.resize(total);
+
+    char * p = buffer.data();
+    std::copy(framedMagic, framedMagic+4, p);
+    writeLittleEndian(p+4, 1, 1);
+    writeLittleEndian(p+5, (UInt64)shuffle, 1);
+    writeLittleEndian(p+6, elementSize, 2);
+    writeLittleEndian(p+8, (UInt32)(Int32)method, 4);
+    writeLittleEndian(p+12, 0, 4);
+    writeLittleEndian(p+16, size, 8);
+    writeLittleEndian(p+24, frameSize, 8);
+    writeLittleEndian(p+32, frameCount, 8);
+    p += framedHeaderSize;
+    for(std::size_t k=0; k<frameCount; ++k, p += 8)
+        writeLittleEndian(p, frames[k].size(), 8);
+    for(std::size_t k=0; k<frameCount; ++k)
+        p = std::copy(frames[k].begin(), frames[k].end(), p);
+    return total;
+}
+
+void compressFramed(char const * source, std::size_t size, ArrayVector<char> & dest,
+                    CompressionMethod method, ParallelOptions const & options,
+                    std::size_t frameSize, CompressionShuffle shuffle, std::size_t elementSize)
+{
+    compressFramedImpl(source, size, dest, method, options, frameSize, shuffle, elementSize);
+}
+
+void compressFramed(char const * source, std::size_t size, std::vector<char> & dest,
+                    CompressionMethod method, ParallelOptions const & options,
+                    std::size_t frameSize, CompressionShuffle shuffle, std::size_t elementSize)
+{
+    ArrayVector<char> buffer;
+    std::size_t destSize = compressFramedImpl(source, size, buffer, method, options,
+                                              frameSize, shuffle, elementSize);
+    dest.insert(dest.begin(), buffer.data(), buffer.data() + destSize);
+}
+
+std::size_t framedUncompressedSize(char const * source, std::size_t srcSize)
+{
+    vigra_precondition(srcSize >= framedHeaderSize && std::equal(framedMagic, framedMagic+4, source),
+        "framedUncompressedSize(): source is not a framed compression buffer.");
+    vigra_precondition(readLittleEndian(source+4, 1) == 1,
+        "framedUncompressedSize(): unsupported format version.");
+    return (std::size_t)readLittleEndian(source+16, 8);
+}
+
+void uncompressFramed(char const * source, std::size_t srcSize,
+                      char * dest, std::size_t destSize,
+                      ParallelOptions const & options)
+{
+    std::size_t size = framedUncompressedSize(source, srcSize);
+    vigra_precondition(size == destSize,
+        "uncompressFramed(): destination size doesn't match the uncompressed size.");
+
+    UInt64 shuffleMode          = readLittleEndian(source+5, 1);
+    std::size_t elementSize     = (std::size_t)readLittleEndian(source+6, 2);
+    CompressionMethod method    = (CompressionMethod)(Int32)(UInt32)readLittleEndian(source+8, 4);
+    std::size_t frameSize       = (std::size_t)readLittleEndian(source+24, 8),
+                frameCount      = (std::size_t)readLittleEndian(source+32, 8);
+    vigra_precondition(shuffleMode <= BIT_SHUFFLE && elementSize > 0 &&
+                       frameSize > 0 && frameCount == framedFrameCount(size, frameSize),
+        "uncompressFramed(): corrupted frame header.");
+    // divide instead of multiplying, so that a corrupted count cannot overflow
+    vigra_precondition(frameCount <= (srcSize - framedHeaderSize) / 8,
+        "uncompressFramed(): source buffer is truncated.");
+    CompressionShuffle shuffle  = (CompressionShuffle)shuffleMode;
+
+    // compute the position of each frame, checking every frame against the
+    // remaining input before adding it, so that the sum cannot overflow
+    ArrayVector<std::size_t> offsets(frameCount+1);
+    offsets[0] = framedHeaderSize + 8*frameCount;
+    for(std::size_t k=0; k<frameCount; ++k)
+    {
+        UInt64 frameBytes = readLittleEndian(source+framedHeaderSize+8*k, 8);
+        vigra_precondition(frameBytes <= (UInt64)(srcSize - offsets[k]),
+            "uncompressFramed(): source buffer is truncated.");
+        offsets[k+1] = offsets[k] + (std::size_t)frameBytes;
+    }
+
+    forEachFrame(frameCount, options,
+        [&](std::size_t k)
+        {
+            std::size_t begin = k*frameSize,
+                        length = std::min(frameSize, size - begin);
+            uncompress(source + offsets[k], offsets[k+1] - offsets[k],
+                       dest + begin, length, method, shuffle, elementSize);
+        });
+}
+
 /** Uncompress a data buffer when the uncompressed size is unknown.
 
     The destination array will be resized as required.
@@ -103,7 +103,195 @@ struct BlockwiseConvolutionTest
             1e-14
         );
 
+        // pinned workers with node-local block assignment
+        opt.threadPinning(ParallelOptions::ScatterPinning)
+           .numaPolicy(ParallelOptions::NumaFirstTouch);
+        Array resN(shape);
+        gaussianSmoothMultiArray(data, resN, opt);
+
+        shouldEqualSequenceTolerance(
+            res.begin(), 
+            res.end(), 
+            resN.begin(), 
+            1e-14
+        );
+    }
+
+    void testChunkedParallel()
+    {
+        typedef MultiArray<3, float> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(60, 50, 40);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        // small cache to make sure that halos are fetched through the cache
+        ChunkedArrayCompressed<3, float> source(shape, Shape(16),
+                                                ChunkedArrayOptions().cacheMax(4));
+        source.commitSubarray(Shape(0), data);
+
+        BlockwiseConvolutionOptions<3> opt;
+        opt.stdDev(1.5);
+        opt.numThreads(4);
+
+        {
+            Array res(shape);
+            gaussianSmoothMultiArray(data, res, 1.5);
+
+            ChunkedArrayLazy<3, float> dest(shape, Shape(16));
+            gaussianSmoothMultiArray(source, dest, opt);
+
+            Array resC(shape);
+            dest.checkoutSubarray(Shape(0), resC);
+            shouldEqualSequenceTolerance(res.begin(), res.end(), resC.begin(), 1e-5);
+        }
+        {
+            typedef TinyVector<float, 6> Tensor;
+            MultiArray<3, Tensor> res(shape);
+            hessianOfGaussianMultiArray(data, res, opt);
+
+            // block shape is rounded to a multiple of the chunk shape
+            opt.blockShape(Shape(20, 40, 30));
+            ChunkedArrayLazy<3, Tensor> dest(shape, Shape(16));
+            hessianOfGaussianMultiArray(source, dest, opt);
+
+            MultiArray<3, Tensor> resC(shape);
+            dest.checkoutSubarray(Shape(0), resC);
+            for(int k=0; k<res.size(); ++k)
+                should(norm(res[k] - resC[k]) < 1e-3);
+        }
+        shouldEqual(blockwise::chunkAlignedBlockShape(opt, Shape(16)), Shape(16, 48, 32));
+    }
+
+    template <class Iter1, class Iter2>
+    static double maxDifference(Iter1 i, Iter1 end, Iter2 j)
+    {
+        double res = 0.0;
+        for(; i != end; ++i, ++j)
+            res = std::max(res, std::abs(double(*i - *j)));
+        return res;
+    }
+
+    void testFilterBank()
+    {
+        typedef MultiArray<3, double> Array;
+        typedef Array::difference_type Shape;
+        typedef TinyVector<double, 3> Vector;
+        typedef TinyVector<double, 6> Tensor;
+
+        Shape shape(40, 35, 30);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        ArrayVector<FilterBankFeature> features;
+        features.push_back(FilterBankFeature(FilterBankFeature::GaussianSmoothing, 1.0));
+        features.push_back(FilterBankFeature(FilterBankFeature::LaplacianOfGaussian, 1.5));
+        features.push_back(FilterBankFeature(FilterBankFeature::GaussianGradientMagnitude, 1.0));
+        features.push_back(FilterBankFeature(FilterBankFeature::HessianOfGaussianEigenvalues, 1.5));
+        features.push_back(FilterBankFeature(FilterBankFeature::StructureTensorEigenvalues, 1.0, 2.0));
+        shouldEqual(filterBankChannelCount(features, 3), 9u);
+
+        BlockwiseOptions opt;
+        opt.blockShape(16).numThreads(4);
+        MultiArray<4, double> bank(Shape4(40, 35, 30, 9));
+        blockwiseFilterBank(data, bank, features, opt);
+
+        // compare with the individual filters
+        BlockwiseConvolutionOptions<3> fopt;
+        fopt.blockShape(Shape(16, 12, 20));
+
+        Array res(shape);
+        fopt.stdDev(1.0);
+        gaussianSmoothMultiArray(data, res, fopt);
+        shouldEqualTolerance(maxDifference(res.begin(), res.end(), bank.bindOuter(0).begin()), 0.0, 1e-10);
+        fopt.stdDev(1.5);
+        laplacianOfGaussianMultiArray(data, res, fopt);
+        shouldEqualTolerance(maxDifference(res.begin(), res.end(), bank.bindOuter(1).begin()), 0.0, 1e-10);
+        fopt.stdDev(1.0);
+        gaussianGradientMagnitudeMultiArray(data, res, fopt);
+        shouldEqualTolerance(maxDifference(res.begin(), res.end(), bank.bindOuter(2).begin()), 0.0, 1e-10);
+
+        MultiArray<3, Vector> ev(shape);
+        fopt.stdDev(1.5);
+        hessianOfGaussianEigenvaluesMultiArray(data, ev, fopt);
+        for(int d=0; d<3; ++d)
+            shouldEqualTolerance(maxDifference(ev.bindElementChannel(d).begin(), ev.bindElementChannel(d).end(),
+                                         bank.bindOuter(3+d).begin()), 0.0, 1e-10);
+
+        MultiArray<3, Tensor> st(shape);
+        structureTensorMultiArray(data, st, ConvolutionOptions<3>().stdDev(1.0).outerScale(2.0));
+        tensorEigenvaluesMultiArray(st, ev);
+        for(int d=0; d<3; ++d)
+            shouldEqualTolerance(maxDifference(ev.bindElementChannel(d).begin(), ev.bindElementChannel(d).end(),
+                                         bank.bindOuter(6+d).begin()), 0.0, 1e-6);
+
+        // chunked input and output
+        ChunkedArrayLazy<3, double> source(shape, Shape(16));
+        source.commitSubarray(Shape(0), data);
+        ChunkedArrayLazy<4, double> dest(Shape4(40, 35, 30, 9), Shape4(16, 16, 16, 16));
+        blockwiseFilterBank(source, dest, features, opt);
+
+        MultiArray<4, double> bankC(dest.shape());
+        dest.checkoutSubarray(Shape4(0), bankC);
+        shouldEqualSequence(bank.begin(), bank.end(), bankC.begin());
+    }
+
+#ifdef HasFFTW3
+    void testFFT()
+    {
+        typedef MultiArray<3, double> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(45, 38, 30);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        // asymmetric kernel with even and odd sizes
+        Array kernel(Shape(7, 4, 5));
+        fillRandom(kernel.begin(), kernel.end(), 20);
+
+        Array correct_output(shape);
+        convolveFFT(data, kernel, correct_output);
+
+        BlockwiseOptions opt;
+        opt.blockShape(Shape(8, 16, 12)).numThreads(4);
+
+        Array res(shape);
+        convolveFFTBlockwise(data, kernel, res, opt);
+        shouldEqualTolerance(maxDifference(correct_output.begin(), correct_output.end(), res.begin()), 0.0, 1e-9);
+
+        // a single block covering the whole array, float output
+        MultiArray<3, float> resf(shape);
+        convolveFFTBlockwise(data, kernel, resf, BlockwiseOptions().blockShape(64).numThreads(1));
+        shouldEqualTolerance(maxDifference(correct_output.begin(), correct_output.end(), resf.begin()), 0.0, 1e-2);
+
+        // kernel larger than the array
+        Array kernelL(Shape(51, 3, 3));
+        fillRandom(kernelL.begin(), kernelL.end(), 20);
+        convolveFFT(data, kernelL, correct_output);
+        convolveFFTBlockwise(data, kernelL, res, opt);
+        shouldEqualTolerance(maxDifference(correct_output.begin(), correct_output.end(), res.begin()), 0.0, 1e-9);
+
+        // in-place operation is rejected
+        try
+        {
+            convolveFFTBlockwise(res, kernel, res, opt);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+
+        // chunked input and output
+        convolveFFT(data, kernel, correct_output);
+        ChunkedArrayLazy<3, double> source(shape, Shape(16));
+        source.commitSubarray(Shape(0), data);
+        ChunkedArrayLazy<3, double> dest(shape, Shape(16));
+        convolveFFTBlockwise(source, kernel, dest, opt);
+        dest.checkoutSubarray(Shape(0), res);
+        shouldEqualTolerance(maxDifference(correct_output.begin(), correct_output.end(), res.begin()), 0.0, 1e-9);
     }
+#endif
 };
 
 struct BlockwiseConvolutionTestSuite
@@ -115,6 +303,11 @@ struct BlockwiseConvolutionTestSuite
         add(testCase(&BlockwiseConvolutionTest::simpleTest));
         add(testCase(&BlockwiseConvolutionTest::chunkedTest));
         add(testCase(&BlockwiseConvolutionTest::testParallel));
+        add(testCase(&BlockwiseConvolutionTest::testChunkedParallel));
+        add(testCase(&BlockwiseConvolutionTest::testFilterBank));
+#ifdef HasFFTW3
+        add(testCase(&BlockwiseConvolutionTest::testFFT));
+#endif
     }
 };
 
@@ -267,6 +267,111 @@ struct BlockwiseLabelingTest
                                      oldschool_label_array.begin(), oldschool_label_array.end()), true);
     }
 
+    void parallelMergeTest()
+    {
+        typedef MultiArray<3, int> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(60, 50, 40);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 3);
+
+        // small blocks, so that many faces are merged concurrently
+        BlockwiseLabelOptions options;
+        options.blockShape(Shape(7, 5, 6)).numThreads(4);
+
+        for(int k=0; k<4; ++k)
+        {
+            NeighborhoodType neighborhood = k % 2 == 0 ? DirectNeighborhood : IndirectNeighborhood;
+            bool with_background = k >= 2;
+            options.neighborhood(neighborhood);
+            if(with_background)
+                options.ignoreBackgroundValue(1);
+
+            MultiArray<3, UInt32> labels(shape), blockwise_labels(shape);
+            UInt32 count = with_background
+                               ? labelMultiArrayWithBackground(data, labels, neighborhood, 1)
+                               : labelMultiArray(data, labels, neighborhood);
+            UInt32 blockwise_count = labelMultiArrayBlockwise(data, blockwise_labels, options);
+
+            shouldEqual(count, blockwise_count);
+            shouldEqual(equivalentLabels(labels.begin(), labels.end(),
+                                         blockwise_labels.begin(), blockwise_labels.end()),
+                        true);
+        }
+
+        // chunked arrays
+        ChunkedArrayLazy<3, int> chunked_data(shape, Shape(16));
+        chunked_data.commitSubarray(Shape(0), data);
+        ChunkedArrayLazy<3, UInt32> chunked_labels(shape, Shape(16));
+
+        MultiArray<3, UInt32> labels(shape), blockwise_labels(shape);
+        UInt32 count = labelMultiArrayWithBackground(data, labels, DirectNeighborhood, 1);
+        shouldEqual(labelMultiArrayBlockwise(chunked_data, chunked_labels,
+                                             BlockwiseLabelOptions().ignoreBackgroundValue(1).numThreads(4)),
+                    count);
+        chunked_labels.checkoutSubarray(Shape(0), blockwise_labels);
+        shouldEqual(equivalentLabels(labels.begin(), labels.end(),
+                                     blockwise_labels.begin(), blockwise_labels.end()),
+                    true);
+    }
+
+    void streamingTest()
+    {
+        typedef MultiArray<3, int> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(40, 30, 45);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 3);
+
+        ChunkedArrayLazy<3, int> chunked_data(shape, Shape(16));
+        chunked_data.commitSubarray(Shape(0), data);
+
+        for(int k=0; k<4; ++k)
+        {
+            NeighborhoodType neighborhood = k % 2 == 0 ? DirectNeighborhood : IndirectNeighborhood;
+            bool with_background = k >= 2;
+            BlockwiseLabelOptions options;
+            options.neighborhood(neighborhood).numThreads(2);
+            if(with_background)
+                options.ignoreBackgroundValue(1);
+
+            MultiArray<3, UInt32> labels(shape), streaming_labels(shape);
+            UInt32 count = with_background
+                               ? labelMultiArrayWithBackground(data, labels, neighborhood, 1)
+                               : labelMultiArray(data, labels, neighborhood);
+
+            // slabs of thickness 8, table with small chunks
+            ChunkedArrayLazy<3, UInt32> chunked_labels(shape, Shape(16, 16, 8));
+            ChunkedArrayLazy<1, UInt32> equivalences(Shape1(data.size() + 1), Shape1(256));
+            shouldEqual(labelMultiArrayStreaming(chunked_data, chunked_labels, equivalences, options),
+                        count);
+            chunked_labels.checkoutSubarray(Shape(0), streaming_labels);
+            shouldEqualSequence(streaming_labels.begin(), streaming_labels.end(), labels.begin());
+
+            // thinner slabs, default table
+            ChunkedArrayLazy<3, UInt32> thin_labels(shape, Shape(8, 8, 4));
+            shouldEqual(labelMultiArrayStreaming(chunked_data, thin_labels, options),
+                        count);
+            thin_labels.checkoutSubarray(Shape(0), streaming_labels);
+            shouldEqualSequence(streaming_labels.begin(), streaming_labels.end(), labels.begin());
+
+            // disk-based labels and table, with caches too small to hold a slab
+            ChunkedArrayTmpFile<3, UInt32> file_labels(shape, Shape(16, 16, 8),
+                                                       ChunkedArrayOptions().cacheMax(2));
+            ChunkedArrayTmpFile<1, UInt32> file_equivalences(Shape1(data.size() + 1), Shape1(1024),
+                                                             ChunkedArrayOptions().cacheMax(2));
+            shouldEqual(labelMultiArrayStreaming(chunked_data, file_labels, file_equivalences, options),
+                        count);
+            file_labels.checkoutSubarray(Shape(0), streaming_labels);
+            shouldEqual(equivalentLabels(labels.begin(), labels.end(),
+                                         streaming_labels.begin(), streaming_labels.end()),
+                        true);
+            shouldEqualSequence(streaming_labels.begin(), streaming_labels.end(), labels.begin());
+        }
+    }
+
     void fiveDimensionalRandomTest()
     {
         testOnData(array_fives.begin(), array_fives.end(),
@@ -295,6 +400,8 @@ struct BlockwiseLabelingTestSuite
         add(testCase(&BlockwiseLabelingTest::fiveDimensionalRandomTest));
         add(testCase(&BlockwiseLabelingTest::debugTest));
         add(testCase(&BlockwiseLabelingTest::chunkedArrayTest));
+        add(testCase(&BlockwiseLabelingTest::parallelMergeTest));
+        add(testCase(&BlockwiseLabelingTest::streamingTest));
     }
 };
 
@@ -41,15 +41,64 @@
 #include <vigra/multi_gridgraph.hxx>
 #include <vigra/unittest.hxx>
 #include <vigra/multi_watersheds.hxx>
+#include <vigra/random.hxx>
 
 #include <iostream>
 #include <sstream>
+#include <queue>
+#include <functional>
 
 #include "utils.hxx"
 
 using namespace std;
 using namespace vigra;
 
+    // sequential seeded region growing with the tie-breaking rule of seededWatershedsBlockwise():
+    // nodes are flooded in the order of level, steps along the plateau, and scan-order index
+template <unsigned int N, class Data, class Label>
+void referenceSeededWatersheds(const MultiArray<N, Data>& data, MultiArray<N, Label>& labels,
+                               NeighborhoodType neighborhood, const WatershedOptions& options)
+{
+    typedef GridGraph<N, undirected_tag> Graph;
+    typedef typename Graph::Node Node;
+    typedef pair<pair<Data, UInt32>, MultiArrayIndex> Entry;
+
+    Graph graph(data.shape(), neighborhood);
+    MultiArray<N, UInt32> hops(data.shape());
+    priority_queue<Entry, vector<Entry>, greater<Entry> > pqueue;
+    for(MultiArrayIndex i = 0; i < data.size(); ++i)
+    {
+        Label label = labels[i];
+        if(label != 0)
+            pqueue.push(Entry(make_pair(data[i], 0), i));
+    }
+    while(!pqueue.empty())
+    {
+        Entry entry = pqueue.top();
+        pqueue.pop();
+        Data level = entry.first.first;
+        if((options.terminate & StopAtThreshold) && level > options.max_cost)
+            break;
+        Node node = labels.scanOrderIndexToCoordinate(entry.second);
+        Label label = labels[node];
+        for(typename Graph::OutArcIt arc(graph, node); arc != lemon::INVALID; ++arc)
+        {
+            Node target = graph.target(*arc);
+            if(labels[target] != 0)
+                continue;
+            Data target_level = data[target];
+            UInt32 target_hops = 0;
+            if(target_level <= level)
+            {
+                target_level = level;
+                target_hops = entry.first.second + 1;
+            }
+            labels[target] = label;
+            pqueue.push(Entry(make_pair(target_level, target_hops), labels.coordinateToScanOrderIndex(target)));
+        }
+    }
+}
+
 struct BlockwiseWatershedTest
 {
     void oneDimensionalTest()
@@ -202,6 +251,102 @@ struct BlockwiseWatershedTest
                                      correct_labels.begin(), correct_labels.end()),
                     true);
     }
+
+    void seededTest()
+    {
+        typedef MultiArray<3, int> Array;
+        typedef MultiArray<3, UInt32> LabelArray;
+        typedef Array::difference_type Shape;
+
+        RandomMT19937 random(42);
+        Shape shape(37, 29, 23);
+        Array data(shape);
+        for(auto & v: data)
+            v = random.uniformInt(4); // many plateaus
+        LabelArray seeds(shape);
+        for(UInt32 label = 1; label <= 40; ++label)
+            seeds(random.uniformInt(shape[0]), random.uniformInt(shape[1]), random.uniformInt(shape[2])) = label;
+
+        for(int k=0; k<2; ++k)
+        {
+            NeighborhoodType neighborhood = k == 0 ? DirectNeighborhood : IndirectNeighborhood;
+            LabelArray reference(seeds);
+            referenceSeededWatersheds(data, reference, neighborhood, WatershedOptions());
+
+            Shape block_shapes[] = { shape, Shape(8), Shape(5, 7, 3) };
+            for(int b=0; b<3; ++b)
+            {
+                LabelArray labels(seeds);
+                shouldEqual(seededWatershedsBlockwise(data, labels,
+                                                      BlockwiseLabelOptions().blockShape(block_shapes[b])
+                                                                             .neighborhood(neighborhood)
+                                                                             .numThreads(4)),
+                            40);
+                shouldEqualSequence(labels.begin(), labels.end(), reference.begin());
+            }
+        }
+
+        // floating-point data, with and without threshold
+        MultiArray<3, float> fdata(shape);
+        for(auto & v: fdata)
+            v = random.uniform();
+        WatershedOptions options[] = { WatershedOptions().stopAtThreshold(0.7),
+                                       WatershedOptions() };
+        for(int k=0; k<2; ++k)
+        {
+            LabelArray reference(seeds), labels(seeds);
+            referenceSeededWatersheds(fdata, reference, IndirectNeighborhood, options[k]);
+            seededWatershedsBlockwise(fdata, labels,
+                                      BlockwiseLabelOptions().blockShape(Shape(12, 10, 8)).neighborhood(IndirectNeighborhood),
+                                      options[k]);
+            shouldEqualSequence(labels.begin(), labels.end(), reference.begin());
+        }
+
+        // automatic seeds
+        MultiArray<2, int> data2D(data.bindOuter(4));
+        MultiArray<2, UInt32> reference2D(data2D.shape()), labels2D(data2D.shape());
+        UInt32 count = generateWatershedSeeds(data2D, reference2D, DirectNeighborhood, SeedOptions().minima());
+        referenceSeededWatersheds(data2D, reference2D, DirectNeighborhood, WatershedOptions());
+        shouldEqual(seededWatershedsBlockwise(data2D, labels2D, BlockwiseLabelOptions().blockShape(Shape2(10, 6))),
+                    count);
+        shouldEqualSequence(labels2D.begin(), labels2D.end(), reference2D.begin());
+    }
+
+    void serpentineTest()
+    {
+        // a low channel winding through many small blocks: the flood from its end crosses
+        // far more block borders than lie between opposite corners of the block grid
+        typedef MultiArray<2, int> Array;
+        typedef MultiArray<2, UInt32> LabelArray;
+
+        Shape2 shape(64, 64);
+        Array data(shape, 10);
+        for(int y = 1; y < shape[1] - 1; y += 4)
+        {
+            for(int x = 1; x < shape[0] - 1; ++x)
+                data(x, y) = 0;
+            int x = (y / 4) % 2 == 0 ? shape[0] - 2 : 1;
+            for(int k = 1; k < 4 && y + k < shape[1] - 1; ++k)
+                data(x, y + k) = 0;
+        }
+        LabelArray seeds(shape);
+        seeds(1, 1) = 1;
+        seeds(shape[0] - 1, shape[1] - 1) = 2;
+
+        for(int k=0; k<2; ++k)
+        {
+            NeighborhoodType neighborhood = k == 0 ? DirectNeighborhood : IndirectNeighborhood;
+            LabelArray reference(seeds), labels(seeds);
+            referenceSeededWatersheds(data, reference, neighborhood, WatershedOptions());
+            shouldEqual(seededWatershedsBlockwise(data, labels,
+                                                  BlockwiseLabelOptions().blockShape(Shape2(4, 4))
+                                                                         .neighborhood(neighborhood)
+                                                                         .numThreads(4)),
+                        2u);
+            shouldEqualSequence(labels.begin(), labels.end(), reference.begin());
+            shouldEqual(labels(1, shape[1] - 3), 1u);
+        }
+    }
 };
 
 struct BlockwiseWatershedTestSuite
@@ -213,6 +358,8 @@ struct BlockwiseWatershedTestSuite
         add(testCase(&BlockwiseWatershedTest::fourDimensionalRandomTest));
         add(testCase(&BlockwiseWatershedTest::oneDimensionalTest));
         add(testCase(&BlockwiseWatershedTest::chunkedTest));
+        add(testCase(&BlockwiseWatershedTest::seededTest));
+        add(testCase(&BlockwiseWatershedTest::serpentineTest));
     }
 };
 
@@ -1491,6 +1491,49 @@ struct ConvolutionTest
         }
     }
 
+    void symmetricKernelTest()
+    {
+        vigra::Kernel1D<double> k;
+        k.initGaussian(1.5);
+        shouldEqual(k.symmetry(), vigra::KERNEL_SYMMETRIC);
+        k.initGaussianDerivative(1.5, 2);
+        shouldEqual(k.symmetry(), vigra::KERNEL_SYMMETRIC);
+        k.initGaussianDerivative(1.5, 1);
+        shouldEqual(k.symmetry(), vigra::KERNEL_ANTISYMMETRIC);
+        shouldEqual(k[0], 0.0);
+        k.initSymmetricDifference();
+        shouldEqual(k.symmetry(), vigra::KERNEL_ANTISYMMETRIC);
+        k.initForwardDifference();
+        shouldEqual(k.symmetry(), vigra::KERNEL_ASYMMETRIC);
+        k.initExplicitly(-1, 1) = 1.0, 2.0, 3.0;
+        shouldEqual(k.symmetry(), vigra::KERNEL_ASYMMETRIC);
+
+        // the folded sums agree with the plain ones for all radii
+        // (including those that are not specialized)
+        int w = 40;
+        std::vector<double> src(w), dest(w);
+        for(int x=0; x<w; ++x)
+            src[x] = std::sin(0.3*x) + 0.01*x*x;
+        for(int order=0; order<3; ++order)
+        {
+            for(double sigma=0.3; sigma<2.5; sigma+=0.35)
+            {
+                k.initGaussianDerivative(sigma, order);
+                convolveLine(src.begin(), src.end(), vigra::StandardConstAccessor<double>(),
+                             dest.begin(), vigra::StandardAccessor<double>(), k.center(),
+                             vigra::StandardConstAccessor<double>(), k.left(), k.right(),
+                             vigra::BORDER_TREATMENT_REFLECT);
+                for(int x=k.right(); x<w+k.left(); ++x)
+                {
+                    double sum = 0.0;
+                    for(int i=k.left(); i<=k.right(); ++i)
+                        sum += k[i]*src[x-i];
+                    should(std::abs(dest[x] - sum) < 1e-12);
+                }
+            }
+        }
+    }
+
     void recursiveFilterTestWithAvoid()
     {
         Image src_const(25, 25);
@@ -2491,6 +2534,7 @@ struct ConvolutionTestSuite
         add( testCase( &ConvolutionTest::structureTensorRGBTest));
         add( testCase( &ConvolutionTest::stdConvolutionTest));
         add( testCase( &ConvolutionTest::stdVersusSeparableConvolutionTest));
+        add( testCase( &ConvolutionTest::symmetricKernelTest));
         add( testCase( &ConvolutionTest::recursiveFilterTestWithAvoid));
         add( testCase( &ConvolutionTest::recursiveFilterTestWithClipOnConstImage));
         add( testCase( &ConvolutionTest::recursiveFilterTestWithClipOnNonConstImage));
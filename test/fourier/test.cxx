@@ -691,6 +691,275 @@ struct MultiFFTTest
         shouldEqualSequenceTolerance(out2.data(), out2.data()+out2.size(),
                                      out4.data(), 1e-15);
     }
+
+    void testConvolveWorkspace()
+    {
+        typedef MultiArrayView<2, double> MV;
+        ImageImportInfo info("ghouse.gif");
+        Shape2 s(info.width(), info.height());
+        DArray2 in(s), in2(s), out(s), out2(s), ref(s), ref2(s);
+        importImage(info, destImage(in));
+        in2 = in;
+        in2 *= -0.5;
+        in2 += 3.0;
+
+        Kernel2D<double> gauss, gauss2;
+        gauss.initGaussian(2.0);
+        gauss2.initGaussian(1.0);
+        MV kernel(Shape2(gauss.width(), gauss.height()), &gauss[gauss.upperLeft()]);
+        MV kernel2(Shape2(gauss2.width(), gauss2.height()), &gauss2[gauss2.upperLeft()]);
+
+        MV kernels[] = { kernel, kernel2 };
+        MV outs[] = { out, out2 };
+        MV refs[] = { ref, ref2 };
+
+        FFTWConvolveWorkspace<2> workspace(s, kernels, kernels+2);
+        shouldEqual(workspace.size(), 2u);
+        shouldEqual(workspace.shape(), s);
+        shouldEqual(workspace.paddedShape(), fftwBestPaddedShapeR2C(s + kernel.shape() - Shape2(1)));
+
+        // the workspace can be re-used for different inputs
+        for(int k=0; k<2; ++k)
+        {
+            MV input = k == 0 ? MV(in) : MV(in2);
+            convolveFFTMany(input, kernels, kernels+2, refs);
+            workspace.execute(input, outs);
+
+            shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                         ref.data(), 1e-12);
+            shouldEqualSequenceTolerance(out2.data(), out2.data()+out2.size(),
+                                         ref2.data(), 1e-12);
+        }
+
+        // kernels in the Fourier domain
+        Shape2 paddedShape = fftwBestPaddedShapeR2C(s + Shape2(16)),
+               kernelShape = fftwCorrespondingShapeR2C(paddedShape);
+        Shape2 center = div(kernelShape, Shape2::value_type(2));
+        center[0] = 0;
+
+        CArray2 fkernel(kernelShape), fkernel2(kernelShape);
+        for(int y=0; y<kernelShape[1]; ++y)
+        {
+            for(int x=0; x<kernelShape[0]; ++x)
+            {
+                double xx = 2.0 * M_PI * (x - center[0]) / paddedShape[0];
+                double yy = 2.0 * M_PI * (y - center[1]) / paddedShape[1];
+                double r2 = sq(xx) + sq(yy);
+                fkernel(x,y) = std::exp(-0.5 * sq(2.0) * r2);
+                fkernel2(x,y) = C(0, xx*std::exp(-0.5 * r2));
+            }
+        }
+
+        MultiArrayView<2, C> fkernels[] = { fkernel, fkernel2 };
+        FFTWConvolveWorkspace<2> fworkspace(s, fkernels, fkernels+2);
+        shouldEqual(fworkspace.paddedShape(), paddedShape);
+
+        convolveFFTMany(in, fkernels, fkernels+2, refs);
+        fworkspace.execute(in, outs);
+
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+        shouldEqualSequenceTolerance(out2.data(), out2.data()+out2.size(),
+                                     ref2.data(), 1e-12);
+    }
+
+    static double maxDifference(CArray2 const & a, CArray2 const & b)
+    {
+        double res = 0.0;
+        for(int k=0; k<a.size(); ++k)
+            res = std::max(res, abs(a[k] - b[k]));
+        return res;
+    }
+
+    struct TransformThread
+    {
+        DArray2 const * in;
+        CArray2 * out;
+
+        void operator()() const
+        {
+            for(int k=0; k<20; ++k)
+                fourierTransform(*in, *out);
+        }
+    };
+
+    void testPlanCache()
+    {
+        FFTWPlanCache::clear();
+        shouldEqual(FFTWPlanCache::size(), 0u);
+        should(FFTWPlanCache::isEnabled());
+
+        Shape2 s(30, 20);
+        DArray2 in(s);
+        for(int k=0; k<in.size(); ++k)
+            in[k] = rand()/(double)RAND_MAX;
+        CArray2 ref(fftwCorrespondingShapeR2C(s)), out(ref.shape());
+
+        fourierTransform(in, ref);
+        shouldEqual(FFTWPlanCache::size(), 1u);
+
+        // same shape and strides => the cached plan is used
+        fourierTransform(in, out);
+        shouldEqual(FFTWPlanCache::size(), 1u);
+        shouldEqualSequence(out.begin(), out.end(), ref.begin());
+
+        // different flags or direction => new plans
+        // (FFTW_MEASURE planning overwrites the arrays)
+        DArray2 scratch(s);
+        FFTWPlan<2, double> measured(scratch, out, FFTW_MEASURE);
+        shouldEqual(FFTWPlanCache::size(), 2u);
+        DArray2 back(s);
+        CArray2 tmp(ref);
+        fourierTransformInverse(tmp, back);
+        shouldEqual(FFTWPlanCache::size(), 3u);
+        shouldEqualSequenceTolerance(back.begin(), back.end(), in.begin(), 1e-12);
+
+        // concurrent transforms share the cached plan
+        {
+            ArrayVector<CArray2> outs(4, CArray2(ref.shape()));
+            std::vector<threading::thread> threads;
+            for(int k=0; k<4; ++k)
+            {
+                TransformThread t = { &in, &outs[k] };
+                threads.emplace_back(t);
+            }
+            for(int k=0; k<4; ++k)
+            {
+                threads[k].join();
+                shouldEqualSequence(outs[k].begin(), outs[k].end(), ref.begin());
+            }
+        }
+        shouldEqual(FFTWPlanCache::size(), 3u);
+
+        // evicted plans remain valid while in use
+        FFTWPlanCache::setCapacity(1);
+        shouldEqual(FFTWPlanCache::size(), 1u);
+        measured.execute(in, out);
+        shouldEqualTolerance(maxDifference(out, ref), 0.0, 1e-12);
+        FFTWPlanCache::setCapacity(128);
+        shouldEqual(FFTWPlanCache::capacity(), 128u);
+
+        FFTWPlanCache::enable(false);
+        shouldEqual(FFTWPlanCache::size(), 0u);
+        fourierTransform(in, out);
+        shouldEqual(FFTWPlanCache::size(), 0u);
+        shouldEqualTolerance(maxDifference(out, ref), 0.0, 1e-12);
+        FFTWPlanCache::enable();
+    }
+
+    template <class Array>
+    static double maxDiff(Array const & a, Array const & b)
+    {
+        double res = 0.0;
+        for(int k=0; k<a.size(); ++k)
+            res = std::max(res, (double)abs(a[k] - b[k]));
+        return res;
+    }
+
+    void testThreadedFFT()
+    {
+        ParallelOptions options;
+        options.numThreads(4);
+
+        Shape3 s(30, 21, 16);
+        DArray3 in(s);
+        for(int k=0; k<in.size(); ++k)
+            in[k] = rand()/(double)RAND_MAX;
+        CArray3 cin(s);
+        cin = in;
+
+        // complex-to-complex, in both directions
+        CArray3 ref(s), res(s);
+        fourierTransform(cin, ref);
+        fourierTransform(cin, res, options);
+        shouldEqualTolerance(maxDiff(res, ref), 0.0, 1e-12);
+
+        fourierTransformInverse(ref, res, options);
+        shouldEqualTolerance(maxDiff(res, cin), 0.0, 1e-12);
+
+        // real-to-complex and back
+        CArray3 fref(fftwCorrespondingShapeR2C(s)), fres(fref.shape());
+        fourierTransform(in, fref);
+        fourierTransform(in, fres, options);
+        shouldEqualTolerance(maxDiff(fres, fref), 0.0, 1e-12);
+
+        DArray3 back(s);
+        fourierTransformInverse(fres, back, options);
+        shouldEqualTolerance(maxDiff(back, in), 0.0, 1e-12);
+
+        // strided input (transposed view) and a re-used plan
+        MultiArrayView<3, C, StridedArrayTag> tin = cin.transpose();
+        CArray3 tref(s), tres(s);
+        fourierTransform(tin, tref.transpose());
+        FFTWPlan<3, double> plan(options);
+        plan.init(tin, tres.transpose(), FFTW_FORWARD);
+        plan.execute(tin, tres.transpose());
+        plan.execute(tin, tres.transpose());
+        shouldEqualTolerance(maxDiff(tres, tref), 0.0, 1e-12);
+
+        // convolution
+        DArray3 kernel(Shape3(5, 7, 3)), cref(s), cres(s);
+        for(int k=0; k<kernel.size(); ++k)
+            kernel[k] = 1.0 / (1.0 + k);
+        convolveFFT(in, kernel, cref);
+        convolveFFT(in, kernel, cres, options);
+        shouldEqualTolerance(maxDiff(cres, cref), 0.0, 1e-12);
+    }
+
+#ifdef HasFFTW3F
+    void testThreadedFFTFloat()
+    {
+        typedef MultiArray<3, float, FFTWAllocator<float> > FArray3;
+        typedef MultiArray<3, FFTWComplex<float>, FFTWAllocator<FFTWComplex<float> > > FCArray3;
+
+        // float transforms use FFTW's threaded planner only with HasFFTW3FThreads
+    #ifdef HasFFTW3FThreads
+        should(detail::FFTWHasThreads<float>::value);
+    #else
+        should(!detail::FFTWHasThreads<float>::value);
+    #endif
+
+        ParallelOptions options;
+        options.numThreads(4);
+
+        Shape3 s(30, 21, 16);
+        FArray3 in(s);
+        for(int k=0; k<in.size(); ++k)
+            in[k] = rand()/(float)RAND_MAX;
+
+        FCArray3 fref(fftwCorrespondingShapeR2C(s)), fres(fref.shape());
+        fourierTransform(in, fref);
+        fourierTransform(in, fres, options);
+        shouldEqualTolerance(maxDiff(fres, fref), 0.0, 1e-2);
+
+        FArray3 back(s);
+        fourierTransformInverse(fres, back, options);
+        shouldEqualTolerance(maxDiff(back, in), 0.0, 1e-4);
+    }
+#endif
+
+    void testWisdom()
+    {
+        Shape2 s(48, 36);
+        DArray2 in(s);
+        CArray2 out(fftwCorrespondingShapeR2C(s));
+        FFTWPlan<2, double> plan(in, out, FFTW_MEASURE);
+
+        should(exportFFTWWisdom<double>("fftw_wisdom.txt"));
+        forgetFFTWWisdom<double>();
+        should(importFFTWWisdom<double>("fftw_wisdom.txt"));
+        should(!importFFTWWisdom<double>("no_such_wisdom_file.txt"));
+
+        // wisdom-only planning succeeds for the imported transform
+        FFTWPlanCache::clear();
+        FFTWPlan<2, double> wise(in, out, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+        for(int k=0; k<in.size(); ++k)
+            in[k] = k % 7;
+        CArray2 ref(out.shape());
+        fourierTransform(in, ref);
+        wise.execute(in, out);
+        shouldEqualTolerance(maxDifference(out, ref), 0.0, 1e-12);
+    }
 };
 
 struct FFTWTestSuite
@@ -715,6 +984,13 @@ struct FFTWTestSuite
         add( testCase(&MultiFFTTest::testConvolveFFT));
         add( testCase(&MultiFFTTest::testConvolveFFTComplex));
         add( testCase(&MultiFFTTest::testConvolveFourierKernel));
+        add( testCase(&MultiFFTTest::testConvolveWorkspace));
+        add( testCase(&MultiFFTTest::testPlanCache));
+        add( testCase(&MultiFFTTest::testWisdom));
+        add( testCase(&MultiFFTTest::testThreadedFFT));
+#ifdef HasFFTW3F
+        add( testCase(&MultiFFTTest::testThreadedFFTFloat));
+#endif
     }
 };
 
@@ -1109,6 +1109,55 @@ public:
         should (in_data_4_2 == out_data_4);
     }
 
+    // number of filters in the creation property list of a dataset
+    static int filterCount(HDF5File & file, std::string const & datasetName)
+    {
+        HDF5Handle dataset = file.getDatasetHandle(datasetName);
+        HDF5Handle plist(H5Dget_create_plist(dataset), &H5Pclose,
+                         "filterCount(): unable to get property list.");
+        return H5Pget_nfilters(plist);
+    }
+
+    void testHDF5FileCompressionMethods()
+    {
+        std::string file_name( "testfile_HDF5File_compression_methods.hdf5");
+
+        MultiArray<3, UInt16> out_data(Shape3(20, 30, 10));
+        for (int i = 0; i < out_data.size(); ++i)
+            out_data[i] = UInt16(1000 + i % 77);
+
+        HDF5File file (file_name, HDF5File::New);
+
+        // write path: zlib levels and LZ4 (which HDF5 doesn't support and therefore
+        // leaves the dataset uncompressed) are accepted as compression parameters
+        file.write("/zlib", out_data, Shape3(10, 10, 10), ZLIB_FAST);
+        file.write("/lz4", out_data, Shape3(10, 10, 10), LZ4);
+        shouldEqual(filterCount(file, "/zlib"), 1);
+        shouldEqual(filterCount(file, "/lz4"), 0);
+
+        // createDataset() with shuffling
+        file.createDataset<3, UInt16>("/shuffled", out_data.shape(), 0, Shape3(10, 10, 10),
+                                      ZLIB_FAST, BYTE_SHUFFLE);
+        file.writeBlock("/shuffled", Shape3(), out_data);
+        shouldEqual(filterCount(file, "/shuffled"), 2);
+
+        MultiArray<3, UInt16> in_data(out_data.shape());
+        file.read("/zlib", in_data);
+        should(in_data == out_data);
+        file.read("/lz4", in_data);
+        should(in_data == out_data);
+        file.read("/shuffled", in_data);
+        should(in_data == out_data);
+
+        // zstd requires the HDF5 filter plugin
+        if(H5Zfilter_avail(32015) > 0)
+        {
+            file.write("/zstd", out_data, Shape3(10, 10, 10), ZSTD);
+            file.read("/zstd", in_data);
+            should(in_data == out_data);
+        }
+    }
+
 
 
 
@@ -1406,6 +1455,7 @@ struct HDF5ImportExportTestSuite : public vigra::test_suite
         add(testCase(&HDF5ExportImportTest::testHDF5FileBlockAccess));
         add(testCase(&HDF5ExportImportTest::testHDF5FileChunks));
         add(testCase(&HDF5ExportImportTest::testHDF5FileCompression));
+        add(testCase(&HDF5ExportImportTest::testHDF5FileCompressionMethods));
         add(testCase(&HDF5ExportImportTest::testHDF5FileBrowsing));
         add(testCase(&HDF5ExportImportTest::testHDF5FileAttributes));
         add(testCase(&HDF5ExportImportTest::testHDF5FileTutorial));
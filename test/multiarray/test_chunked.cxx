@@ -47,6 +47,7 @@
 #include "vigra/algorithm.hxx"
 #include "vigra/random.hxx"
 #include "vigra/timing.hxx"
+#include "vigra/threadpool.hxx"
 //#include "marray.hxx"
 
 using namespace vigra;
@@ -739,6 +740,66 @@ public:
         shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
     }
 
+    void testPrefetch()
+    {
+        bool hasCache = array->cacheMaxSize() > 0;
+        if(hasCache)
+            array->setCacheMaxSize(prod(array->chunkArrayShape()));
+
+        // synchronous prefetch of the entire array
+        array->releaseChunks(Shape3(), shape);
+        shouldEqual(array->cacheSize(), 0);
+        array->prefetch(Shape3(), shape);
+        if(hasCache)
+            shouldEqual(array->cacheSize(), prod(array->chunkArrayShape()));
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+
+        ThreadPool pool(4);
+
+        // asynchronous prefetch of an ROI
+        Shape3 start(5,0,3), stop(shape[0], shape[1], shape[2]-3);
+        array->releaseChunks(Shape3(), shape);
+        threading::future<void> loading = array->prefetchAsync(pool, start, stop);
+        loading.get();
+        if(hasCache)
+            shouldEqual(array->cacheSize(), prod(array->chunkStop(stop) - array->chunkStart(start)));
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+
+        // chunk iterator prefetching two chunks ahead
+        array->releaseChunks(Shape3(), shape);
+        {
+            typename Array::chunk_iterator i = array->chunk_begin(start, stop),
+                                           end = array->chunk_end(start, stop);
+            i.prefetch(pool, 2);
+            int count = 0;
+            for(; i != end; ++i, ++count)
+            {
+                should(*i == ref.subarray(i.chunkStart(), i.chunkStop()));
+            }
+            shouldEqual(count, prod(array->chunkStop(stop) - array->chunkStart(start)));
+        }
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+
+        // copies of a prefetching iterator share its queue across threads
+        array->releaseChunks(Shape3(), shape);
+        {
+            typename Array::chunk_iterator i = array->chunk_begin(start, stop);
+            i.prefetch(pool, 2);
+            threading::atomic_long mismatches;
+            mismatches.store(0);
+            parallel_foreach(pool, prod(array->chunkStop(stop) - array->chunkStart(start)),
+                [&](int, std::ptrdiff_t k)
+                {
+                    typename Array::chunk_iterator c(i);
+                    c += k;
+                    if(*c != ref.subarray(c.chunkStart(), c.chunkStop()))
+                        ++mismatches;
+                });
+            shouldEqual(mismatches.load(), 0);
+        }
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+    }
+
     static void testMultiThreadedRun(BaseArray * v, int startIndex, int d,
                                      threading::atomic_long * go)
     {
@@ -1349,6 +1410,110 @@ public:
     // }
 // };
 
+struct ChunkedArrayMmapTest
+{
+    typedef MultiArray<3, int> PlainArray;
+
+    Shape3 shape, chunk_shape;
+    PlainArray ref;
+
+    ChunkedArrayMmapTest()
+    : shape(20, 21, 22)
+    , chunk_shape(8)
+    , ref(shape)
+    {
+        linearSequence(ref.begin(), ref.end());
+    }
+
+    void writeFile(std::string const & name, std::string const & header,
+                   ChunkedArrayMmap<3, int>::FileLayout layout)
+    {
+        FILE * file = fopen(name.c_str(), "wb");
+        should(file != 0);
+        fwrite(header.data(), 1, header.size(), file);
+        if(layout == ChunkedArrayMmap<3, int>::RawVolume)
+        {
+            fwrite(ref.data(), sizeof(int), ref.size(), file);
+        }
+        else
+        {
+            Shape3 chunks = (shape + chunk_shape - Shape3(1)) / chunk_shape;
+            for(MultiCoordinateIterator<3> c(chunks), end(c.getEndIterator()); c != end; ++c)
+            {
+                Shape3 start = *c * chunk_shape,
+                       stop  = min(start + chunk_shape, shape);
+                PlainArray chunk(ref.subarray(start, stop));
+                fwrite(chunk.data(), sizeof(int), chunk.size(), file);
+            }
+        }
+        fclose(file);
+    }
+
+    void testLayout(ChunkedArrayMmap<3, int>::FileLayout layout)
+    {
+        std::string header("HEADER01"), name("chunked_mmap_test.raw");
+        writeFile(name, header, layout);
+        {
+            ChunkedArrayMmap<3, int> a(name, shape, chunk_shape, ChunkedArrayOptions(),
+                                       layout, header.size());
+            should(a.isReadOnly());
+            shouldEqual(a.cacheMaxSize(), 0u);
+            shouldEqual(a.layout(), layout);
+            shouldEqualSequence(a.cbegin(), a.cend(), ref.begin());
+            shouldEqual(a.getItem(Shape3(19, 20, 21)), ref[Shape3(19, 20, 21)]);
+
+            Shape3 start(5,0,3), stop(shape[0], shape[1], shape[2]-3);
+            PlainArray sub(stop - start);
+            a.checkoutSubarray(start, sub);
+            should(sub == ref.subarray(start, stop));
+
+            ChunkedArrayMmap<3, int>::chunk_const_iterator
+                i = a.chunk_cbegin(start, stop), end = a.chunk_cend(start, stop);
+            for(; i != end; ++i)
+                should(*i == ref.subarray(i.chunkStart(), i.chunkStop()));
+
+            try
+            {
+                a.commitSubarray(start, sub);
+                failTest("no exception thrown");
+            }
+            catch(PreconditionViolation &)
+            {}
+        }
+
+        // file too small
+        try
+        {
+            ChunkedArrayMmap<3, int> a(name, shape + Shape3(1), chunk_shape, ChunkedArrayOptions(),
+                                       layout, header.size());
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+
+        // misaligned header
+        try
+        {
+            ChunkedArrayMmap<3, int> a(name, shape - Shape3(1), chunk_shape, ChunkedArrayOptions(),
+                                       layout, header.size() - 2);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+        remove(name.c_str());
+    }
+
+    void testRawVolume()
+    {
+        testLayout(ChunkedArrayMmap<3, int>::RawVolume);
+    }
+
+    void testChunkedLayout()
+    {
+        testLayout(ChunkedArrayMmap<3, int>::ChunkedLayout);
+    }
+};
+
 template <class Array>
 class ChunkedMultiArraySpeedTest
 {
@@ -1472,6 +1637,47 @@ public:
         testIteratorSpeed();
     }
 
+    void testMultiThreadedLoadSpeed()
+    {
+        std::cerr << "############ multi-threaded chunk loading #############\n";
+        Shape3 chunks = array->chunkArrayShape(),
+               chunk_shape = array->chunkShape();
+        std::ptrdiff_t chunk_count = prod(chunks);
+        std::vector<Shape3> chunk_starts;
+        MultiCoordinateIterator<3> c(chunks), cend(c.getEndIterator());
+        for(; c != cend; ++c)
+            chunk_starts.push_back(chunk_shape * *c);
+        int thread_counts[] = { 1, 2, 4, 8 };
+        for(int t=0; t<4; ++t)
+        {
+            array.reset(0);
+            array = createArray(shape, (Array *)0);
+            linearSequence(array->begin(), array->end());
+            array->releaseChunks(Shape3(), shape);
+
+            USETICTOC;
+            TIC;
+            parallel_foreach(thread_counts[t], chunk_count,
+                [&](int, std::ptrdiff_t k)
+                {
+                    Shape3 start = chunk_starts[k],
+                           stop  = min(start + chunk_shape, shape);
+                    MultiArray<3, T> block(stop - start);
+                    array->checkoutSubarray(start, block);
+                    T expected = T(start[0] + shape[0]*(start[1] + shape[1]*start[2]));
+                    if(block[0] != expected)
+                    {
+                        shouldEqual(block[0], expected);
+                    }
+                }
+            );
+            double t_ms = TOCN;
+            std::cerr << "    " << thread_counts[t] << " threads: "
+                      << chunk_count / t_ms * 1000.0 << " chunks/s (cache: "
+                      << array->cacheSize() << ")\n";
+        }
+    }
+
     void testIndexingBaselineSpeed()
     {
         std::cerr << "################## indexing speed ####################\n";
@@ -1526,6 +1732,7 @@ struct ChunkedMultiArrayTestSuite
         add( testCase( &ChunkedMultiArrayTest<Array>::test_subarray ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::test_iterator ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::testChunkIterator ) );
+        add( testCase( &ChunkedMultiArrayTest<Array>::testPrefetch ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::testMultiThreaded ) );
     }
 
@@ -1539,6 +1746,9 @@ struct ChunkedMultiArrayTestSuite
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayCompressed<3, T> >::testIteratorSpeed )));
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayTmpFile<3, T> >::testIteratorSpeed )));
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayTmpFile<3, T> >::testIteratorSpeed_LargeCache )));
+        add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayLazy<3, T> >::testMultiThreadedLoadSpeed )));
+        add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayCompressed<3, T> >::testMultiThreadedLoadSpeed )));
+        add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayTmpFile<3, T> >::testMultiThreadedLoadSpeed )));
 #ifdef HasHDF5
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayHDF5<3, T> >::testIteratorSpeed )));
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayHDF5<3, T> >::testIteratorSpeed_LargeCache )));
@@ -1577,6 +1787,9 @@ struct ChunkedMultiArrayTestSuite
         testImpl<ChunkedArrayHDF5<3, TinyVector<float, 3> > >();
 #endif
 
+        add( testCase( &ChunkedArrayMmapTest::testRawVolume ) );
+        add( testCase( &ChunkedArrayMmapTest::testChunkedLayout ) );
+
         testSpeedImpl<unsigned char>();
         testSpeedImpl<float>();
         testSpeedImpl<double>();
@@ -47,6 +47,7 @@
 #include "vigra/unittest.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/multi_convolution.hxx"
+#include "vigra/multi_scalespace.hxx"
 #include "vigra/basicimageview.hxx"
 #include "vigra/convolution.hxx" 
 #include "vigra/navigator.hxx"
@@ -545,6 +546,440 @@ struct MultiArraySeparableConvolutionTest
     }
 
 
+    void testLineBundles()
+    {
+        // odd shape, so that the last bundle of lines is incomplete
+        Size3 shape(37, 23, 19);
+        Image3D src(shape);
+        makeRandom(src);
+
+        BorderTreatmentMode modes[] = { BORDER_TREATMENT_REFLECT, BORDER_TREATMENT_REPEAT,
+                                        BORDER_TREATMENT_WRAP, BORDER_TREATMENT_ZEROPAD,
+                                        BORDER_TREATMENT_CLIP };
+        for(int m=0; m<5; ++m)
+        {
+            ArrayVector<Kernel1D<double> > kernels(3);
+            kernels[0].initGaussian(1.0);
+            kernels[1].initGaussianDerivative(2.0, 1);
+            kernels[2].initGaussian(2.5);
+            for(int d=0; d<3; ++d)
+                kernels[d].setBorderTreatment(modes[m]);
+            if(modes[m] == BORDER_TREATMENT_CLIP)
+                kernels[1].initGaussian(2.0, 1.0, BORDER_TREATMENT_CLIP);
+
+            Image3D res(shape);
+            separableConvolveMultiArray(src, res, kernels.begin());
+
+            // reference: convolve every line individually
+            Image3D ref(src);
+            ArrayVector<PixelType> tmp;
+            StandardValueAccessor<PixelType> acc;
+            for(int d=0; d<3; ++d)
+            {
+                typedef MultiArrayNavigator<Image3D::traverser, 3> Navigator;
+                tmp.resize(shape[d]);
+                for(Navigator nav(ref.traverser_begin(), shape, d); nav.hasMore(); ++nav)
+                {
+                    std::copy(nav.begin(), nav.end(), tmp.begin());
+                    convolveLine(srcIterRange(tmp.begin(), tmp.end(), acc),
+                                 destIter(nav.begin(), acc), kernel1d(kernels[d]));
+                }
+            }
+            shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        }
+    }
+
+    template <class Array1, class Array2>
+    static double maxDifference(Array1 const & a, Array2 const & b)
+    {
+        double res = 0.0;
+        for(int k=0; k<a.size(); ++k)
+            res = std::max(res, (double)norm(a[k] - b[k]));
+        return res;
+    }
+
+    void testTiled()
+    {
+        Size3 shape(37, 23, 19);
+        Image3D src(shape);
+        makeRandom(src);
+
+        ArrayVector<Kernel1D<double> > kernels(3);
+        kernels[0].initGaussian(1.0);
+        kernels[1].initGaussianDerivative(2.0, 1);
+        kernels[2].initGaussian(2.5);
+
+        ConvolutionOptions<3> opt;
+        opt.tileShape(Size3(16, 10, 8)).tileThreads(4);
+        should(opt.isTiled());
+
+        Image3D ref(shape), res(shape);
+        separableConvolveMultiArray(src, ref, kernels.begin());
+        separableConvolveMultiArray(src, res, kernels.begin(), opt);
+        shouldEqualSequence(ref.begin(), ref.end(), res.begin());
+
+        // tiles spanning entire axes, sequential processing
+        res = 0.0;
+        separableConvolveMultiArray(src, res, kernels.begin(),
+                                    ConvolutionOptions<3>().tileShape(Size3(0, 7, 0)).tileThreads(0));
+        should(maxDifference(ref, res) < 1e-5);
+
+        // kernels that are modified near the border
+        Image3D refClip(shape);
+        kernels[2].setBorderTreatment(BORDER_TREATMENT_CLIP);
+        separableConvolveMultiArray(src, refClip, kernels.begin());
+        separableConvolveMultiArray(src, res, kernels.begin(), opt);
+        should(maxDifference(refClip, res) < 1e-5);
+        kernels[2].setBorderTreatment(BORDER_TREATMENT_REFLECT);
+
+        // ROI
+        Size3 start(3, 4, 5), stop(-2, -3, -4);
+        Image3D resROI(shape - Size3(5, 7, 9));
+        opt.subarray(start, stop);
+        separableConvolveMultiArray(src, resROI, kernels.begin(), opt);
+        should(maxDifference(ref.subarray(start, shape + stop), resROI) < 1e-5);
+        opt.subarray(Size3(), Size3());
+
+        // in-place operation requires a copy of the source
+        gaussianSmoothMultiArray(src, ref, 1.5);
+        res = src;
+        gaussianSmoothMultiArray(res, res, 1.5, opt);
+        should(maxDifference(ref, res) < 1e-5);
+
+        Image3x3 grad(shape), gradT(shape);
+        gaussianGradientMultiArray(src, grad, 1.2);
+        gaussianGradientMultiArray(src, gradT, 1.2, opt);
+        should(maxDifference(grad, gradT) < 1e-5);
+
+        MultiArray<3, TinyVector<PixelType, 6> > hessian(shape), hessianT(shape);
+        hessianOfGaussianMultiArray(src, hessian, 2.0);
+        hessianOfGaussianMultiArray(src, hessianT, 2.0, opt);
+        should(maxDifference(hessian, hessianT) < 1e-5);
+    }
+
+    template <class Array1, class Array2>
+    static double relativeDifference(Array1 const & a, Array2 const & b, int border = 0)
+    {
+        double diff = 0.0, maximum = 0.0;
+        for(int y=border; y<a.shape(1)-border; ++y)
+        {
+            for(int x=border; x<a.shape(0)-border; ++x)
+            {
+                diff = std::max(diff, (double)norm(a(x,y) - b(x,y)));
+                maximum = std::max(maximum, (double)norm(a(x,y)));
+            }
+        }
+        return diff / maximum;
+    }
+
+    void testScaleSpace()
+    {
+        typedef MultiArray<2, PixelType> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(211, 180);
+        Array data(shape);
+        for(int y=0; y<shape[1]; ++y)
+            for(int x=0; x<shape[0]; ++x)
+                data(x,y) = 10.0*std::sin(0.05*x)*std::cos(0.08*y) + 5.0*std::sin(0.013*x*y/20.0);
+
+        double scales[] = { 0.7, 1.0, 1.6, 3.5, 5.0, 10.0 };
+        ArrayVector<double> scaleVector(scales, scales+6);
+
+        Array smooth(shape), smoothS(shape), laplacian(shape), laplacianS(shape);
+        MultiArray<2, TinyVector<PixelType, 2> > gradient(shape), gradientS(shape);
+        MultiArray<2, TinyVector<PixelType, 3> > hessian(shape), hessianS(shape);
+
+        for(int downsample=0; downsample<2; ++downsample)
+        {
+            GaussianScaleSpace<2> scaleSpace(data, scaleVector,
+                                             ScaleSpaceOptions().allowDownsampling(downsample == 1));
+            shouldEqual(scaleSpace.levelCount(), 6u);
+            shouldEqual(scaleSpace.level(3).shape(), shape);
+            if(downsample)
+            {
+                shouldEqual(scaleSpace.level(4).shape(), Shape(106, 91));
+                shouldEqual(scaleSpace.levelStepSize(4)[0], 2.0);
+                should(scaleSpace.level(5).shape(0) < 60);
+            }
+            else
+            {
+                shouldEqual(scaleSpace.level(5).shape(), shape);
+            }
+
+            for(int k=0; k<6; ++k)
+            {
+                // cascade and subsampling only introduce small errors,
+                // odd derivatives are interpolated less accurately near the border
+                double tolerance = scales[k] < 5.0 || !downsample ? 5e-3 : 5e-2;
+
+                gaussianSmoothMultiArray(data, smooth, scales[k]);
+                scaleSpace.gaussianSmooth(scales[k], smoothS);
+                should(relativeDifference(smooth, smoothS) < 5e-3);
+
+                gaussianGradientMultiArray(data, gradient, scales[k]);
+                scaleSpace.gaussianGradient(scales[k], gradientS);
+                should(relativeDifference(gradient, gradientS) < tolerance);
+                should(relativeDifference(gradient, gradientS, 5) < 5e-3);
+
+                gaussianGradientMagnitude(data, smooth, scales[k]);
+                scaleSpace.gaussianGradientMagnitude(scales[k], smoothS);
+                should(relativeDifference(smooth, smoothS) < tolerance);
+
+                hessianOfGaussianMultiArray(data, hessian, scales[k]);
+                scaleSpace.hessianOfGaussian(scales[k], hessianS);
+                should(relativeDifference(hessian, hessianS) < tolerance);
+
+                laplacianOfGaussianMultiArray(data, laplacian, scales[k]);
+                scaleSpace.laplacianOfGaussian(scales[k], laplacianS);
+                should(relativeDifference(laplacian, laplacianS) < 5e-3);
+            }
+
+            // scales in between the levels
+            gaussianGradientMultiArray(data, gradient, 7.0);
+            scaleSpace.gaussianGradient(7.0, gradientS);
+            should(relativeDifference(gradient, gradientS, 5) < 5e-3);
+        }
+
+        try
+        {
+            ArrayVector<double> unsorted(scaleVector.rbegin(), scaleVector.rend());
+            GaussianScaleSpace<2> scaleSpace(data, unsorted);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nGaussianScaleSpace(): scales must be ascending");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testRecursiveGaussian()
+    {
+        typedef MultiArray<2, PixelType> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(211, 180);
+        Array data(shape);
+        MersenneTwister random;
+        for(int y=0; y<shape[1]; ++y)
+            for(int x=0; x<shape[0]; ++x)
+                data(x,y) = 10.0*std::sin(0.05*x)*std::cos(0.08*y) + 5.0*std::sin(0.013*x*y/20.0) +
+                            random.uniform();
+
+        Array smooth(shape), smoothR(shape), laplacian(shape), laplacianR(shape);
+        MultiArray<2, TinyVector<PixelType, 2> > gradient(shape), gradientR(shape);
+        MultiArray<2, TinyVector<PixelType, 3> > hessian(shape), hessianR(shape);
+
+        double scales[] = { 1.5, 3.0, 10.0 };
+        for(int k=0; k<3; ++k)
+        {
+            // anisotropic data: the scale is reduced along the second axis
+            ConvolutionOptions<2> opt, optR;
+            opt.stepSize(1.0, 1.2);
+            optR.stepSize(1.0, 1.2).recursiveGaussian();
+
+            gaussianSmoothMultiArray(data, smooth, scales[k], opt);
+            gaussianSmoothMultiArray(data, smoothR, scales[k], optR);
+            should(relativeDifference(smooth, smoothR) < 1e-2);
+
+            gaussianGradientMultiArray(data, gradient, scales[k], opt);
+            gaussianGradientMultiArray(data, gradientR, scales[k], optR);
+            should(relativeDifference(gradient, gradientR) < 1e-2);
+
+            hessianOfGaussianMultiArray(data, hessian, scales[k], opt);
+            hessianOfGaussianMultiArray(data, hessianR, scales[k], optR);
+            should(relativeDifference(hessian, hessianR) < 1e-2);
+
+            laplacianOfGaussianMultiArray(data, laplacian, scales[k], opt);
+            laplacianOfGaussianMultiArray(data, laplacianR, scales[k], optR);
+            should(relativeDifference(laplacian, laplacianR) < 1e-2);
+        }
+
+        // ROI
+        {
+            Shape start(30, 50), stop(120, 100);
+            ConvolutionOptions<2> optR;
+            optR.stdDev(3.0).recursiveGaussian();
+            gaussianGradientMultiArray(data, gradientR, optR);
+
+            MultiArray<2, TinyVector<PixelType, 2> > gradientROI(stop - start);
+            gaussianGradientMultiArray(data, gradientROI, optR.subarray(start, stop));
+            should(relativeDifference(gradientR.subarray(start, stop), gradientROI) < 1e-4);
+        }
+
+        // FIR filters are used at small scales
+        gaussianGradientMultiArray(data, gradient, 0.8);
+        gaussianGradientMultiArray(data, gradientR, 0.8, ConvolutionOptions<2>().recursiveGaussian());
+        shouldEqualSequence(gradient.begin(), gradient.end(), gradientR.begin());
+
+        // 3D, with scale compensation for the resolution of the data
+        {
+            typedef MultiArray<3, PixelType> Volume;
+            Volume volume(Shape3(40, 30, 35)), res(volume.shape()), resR(volume.shape());
+            for(int k=0; k<volume.size(); ++k)
+                volume[k] = random.uniform();
+
+            ConvolutionOptions<3> opt;
+            opt.resolutionStdDev(0.5).stepSize(1.0, 1.0, 2.0);
+            gaussianSmoothMultiArray(volume, res, 4.0, opt);
+            gaussianSmoothMultiArray(volume, resR, 4.0, opt.recursiveGaussian());
+            should(maxDifference(res, resR) < 1e-2 * *argMax(res.begin(), res.end()));
+        }
+
+        // 1D
+        {
+            ArrayVector<double> line(data.bindOuter(90).begin(), data.bindOuter(90).end()),
+                                resR(line.size()), res(line.size());
+            for(unsigned int order=0; order<3; ++order)
+            {
+                Kernel1D<double> kernel;
+                kernel.initGaussianDerivative(5.0, order);
+                convolveLine(srcIterRange(line.begin(), line.end(), StandardConstValueAccessor<double>()),
+                             destIter(res.begin(), StandardValueAccessor<double>()),
+                             kernel1d(kernel, BORDER_TREATMENT_REFLECT));
+                recursiveGaussianDerivativeLine(line.begin(), line.end(), StandardConstValueAccessor<double>(),
+                                                resR.begin(), StandardValueAccessor<double>(),
+                                                5.0, order);
+                double diff = 0.0, maximum = 0.0;
+                for(unsigned int x=0; x<line.size(); ++x)
+                {
+                    diff = std::max(diff, std::abs(res[x] - resR[x]));
+                    maximum = std::max(maximum, std::abs(res[x]));
+                }
+                should(diff < 1e-2*maximum);
+            }
+        }
+    }
+
+    void testConvolutionMethod()
+    {
+        typedef MultiArray<3, PixelType> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(60, 50, 40);
+        Array data(shape), res(shape), resD(shape), resR(shape);
+        MersenneTwister random;
+        for(int k=0; k<data.size(); ++k)
+            data[k] = random.uniform();
+
+        ConvolutionCostModel & model = ConvolutionCostModel::global();
+        ConvolutionCostModel saved = model;
+
+        // large scales favour recursive filters, small ones direct convolution
+        TinyVector<MultiArrayIndex, 3> s(shape);
+        should(model.select(s, TinyVector<double, 3>(20.0), 0, 0.0, false, 1, true, false) == RecursiveConvolution);
+        should(model.select(s, TinyVector<double, 3>(1.5), 0, 0.0, false, 1, true, false) == DirectConvolution);
+        should(model.select(s, TinyVector<double, 3>(20.0), 0, 0.0, false, 1, false, false) == DirectConvolution);
+        should(model.directCost(s, TinyVector<double, 3>(5.0), 0, 0.0, false, 4) <
+               model.directCost(s, TinyVector<double, 3>(5.0), 0, 0.0, false, 1));
+        shouldEqual(ConvolutionCostModel::fftPaddedSize(121), 125);
+        Kernel1D<double> kernel;
+        kernel.initGaussianDerivative(2.0, 1);
+        shouldEqual(ConvolutionCostModel::gaussianRadius(2.0, 1), kernel.right());
+
+        ConvolutionOptions<3> opt;
+        gaussianSmoothMultiArray(data, resD, 5.0, opt);
+        gaussianSmoothMultiArray(data, resR, 5.0, opt.convolutionMethod(RecursiveConvolution));
+        should(opt.getRecursiveGaussian());
+
+        // the automatic mode follows the model (FFT convolution is excluded
+        // by a prohibitive cost, since it is only available with FFTW)
+        opt.convolutionMethod(AutomaticConvolution);
+        model.fft_element[0] = 1.0;
+        model.direct_tap[0] = 1.0;
+        gaussianSmoothMultiArray(data, res, 5.0, opt);
+        shouldEqualSequence(res.begin(), res.end(), resR.begin());
+
+        model.direct_tap[0] = 0.0;
+        gaussianSmoothMultiArray(data, res, 5.0, opt);
+        shouldEqualSequence(res.begin(), res.end(), resD.begin());
+
+        // but never uses recursive filters at small scales
+        model.direct_tap[0] = 1.0;
+        gaussianSmoothMultiArray(data, res, 0.8, opt);
+        gaussianSmoothMultiArray(data, resD, 0.8);
+        shouldEqualSequence(res.begin(), res.end(), resD.begin());
+
+        // derivatives
+        MultiArray<3, TinyVector<PixelType, 3> > gradient(shape), gradientR(shape);
+        gaussianGradientMultiArray(data, gradient, 3.0, opt);
+        gaussianGradientMultiArray(data, gradientR, 3.0, ConvolutionOptions<3>().recursiveGaussian());
+        shouldEqualSequence(gradient.begin(), gradient.end(), gradientR.begin());
+
+        model = saved;
+
+        // load, save and calibrate on local models, the global one is left alone
+        std::string filename("convolution_cost_model.txt");
+        ConvolutionCostModel local;
+        local.direct_tap[0] = 1.0;
+        local.direct_pass[1] = 3.5e-9;
+        local.save(filename);
+        ConvolutionCostModel loaded;
+        should(loaded.load(filename));
+        shouldEqual(loaded.direct_tap[0], 1.0);
+        shouldEqual(loaded.direct_pass[1], 3.5e-9);
+        should(!loaded.load("nonexisting_cost_model.txt"));
+        shouldEqual(loaded.direct_tap[0], 1.0);
+
+        // calibration reads the cache file if it exists
+        ConvolutionCostModel cached;
+        calibrateConvolutionCostModel(filename, cached);
+        shouldEqual(cached.direct_tap[0], 1.0);
+        shouldEqual(cached.direct_pass[1], 3.5e-9);
+
+        // and measures the coefficients otherwise (only their validity can be checked)
+        std::remove(filename.c_str());
+        ConvolutionCostModel measured;
+        for(int p=0; p<2; ++p)
+            measured.direct_tap[p] = measured.direct_pass[p] = measured.recursive_pass[p] = -1.0;
+        calibrateConvolutionCostModel(filename, measured);
+        for(int p=0; p<2; ++p)
+        {
+            should(measured.direct_tap[p] >= 0.0 && measured.direct_pass[p] >= 0.0);
+            should(measured.recursive_pass[p] > 0.0);
+        }
+        should(loaded.load(filename));
+        should(std::abs(loaded.recursive_pass[0] - measured.recursive_pass[0]) <= 1e-5*measured.recursive_pass[0]);
+        std::remove(filename.c_str());
+        shouldEqual(model.direct_tap[0], saved.direct_tap[0]);
+        shouldEqual(model.recursive_pass[1], saved.recursive_pass[1]);
+
+#ifdef HasFFTW3
+        {
+            // FFT convolution reflects at the border like the direct method
+            opt.convolutionMethod(FFTConvolution);
+            gaussianSmoothMultiArray(data, res, 2.0, opt);
+            gaussianSmoothMultiArray(data, resD, 2.0);
+            should(maxDifference(res, resD) < 1e-5);
+
+            MultiArray<3, TinyVector<PixelType, 6> > hessian(shape), hessianF(shape);
+            hessianOfGaussianMultiArray(data, hessian, 2.0, ConvolutionOptions<3>().stepSize(1.0, 1.0, 1.5));
+            hessianOfGaussianMultiArray(data, hessianF, 2.0, ConvolutionOptions<3>().stepSize(1.0, 1.0, 1.5)
+                                                              .convolutionMethod(FFTConvolution));
+            should(maxDifference(hessian, hessianF) < 1e-5);
+
+            Shape start(10, 5, 20), stop(40, 45, 30);
+            Array roi(stop - start);
+            gaussianSmoothMultiArray(data, roi, 2.0, opt.subarray(start, stop));
+            should(maxDifference(roi, resD.subarray(start, stop)) < 1e-5);
+        }
+#else
+        try
+        {
+            gaussianSmoothMultiArray(data, res, 2.0, ConvolutionOptions<3>().convolutionMethod(FFTConvolution));
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\ngaussianSmoothMultiArray(): FFT convolution requires FFTW");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+#endif
+    }
+
     void test_Valid1() 
     {
         test_1DValidity( srcImage, kernelSize );
@@ -592,6 +1027,11 @@ struct MultiArraySeparableConvolutionTestSuite
                 add( testCase( &MultiArraySeparableConvolutionTest::test_InplaceN ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_Inplace1 ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::testSmoothing ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::testLineBundles ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::testTiled ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::testScaleSpace ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::testRecursiveGaussian ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::testConvolutionMethod ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_gradient1 ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_laplacian ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_divergence ) );
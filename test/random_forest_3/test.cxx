@@ -101,6 +101,13 @@ struct RandomForestTests
         MultiArray<1, int> pred_y(Shape1(8));
         rf.predict(test_x, pred_y, 1);
         shouldEqualSequence(pred_y.begin(), pred_y.end(), test_y.begin());
+
+        // Predictions of a forest without trees must still be valid calls of the parallel loops.
+        RF empty_rf = RF(Graph(), RF::NodeMap<SplitTest>::type(), RF::NodeMap<size_t>::type(), pspec);
+        MultiArray<2, double> probs(Shape2(8, 4));
+        empty_rf.predict_probabilities(test_x, probs, 2);
+        MultiArray<2, size_t> ids(Shape2(8, 0));
+        shouldEqual(empty_rf.leaf_ids(test_x, ids, 2), 0.0);
     }
 
     void test_default_rf()
@@ -103,6 +103,78 @@ struct ThreadPoolTests
         should(caught);
     }
 
+    void test_threadpool_work_stealing()
+    {
+        size_t const n = 10000;
+        std::vector<int> v(n);
+        ThreadPool pool(ParallelOptions().numThreads(4).scheduling(ParallelOptions::WorkStealing));
+        shouldEqual(pool.getScheduling(), ParallelOptions::WorkStealing);
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            pool.enqueue(
+                [&v, i](size_t /*thread_id*/)
+                {
+                    v[i] = 0;
+                    for (size_t k = 0; k < i+1; ++k)
+                    {
+                        v[i] += k;
+                    }
+                }
+            );
+        }
+        pool.waitFinished();
+
+        std::vector<int> v_expected(n);
+        for (size_t i = 0; i < v_expected.size(); ++i)
+            v_expected[i] = i*(i+1)/2;
+
+        shouldEqualSequence(v.begin(), v.end(), v_expected.begin());
+
+        // enqueueReturning() and exceptions work as with the shared queue
+        auto res = pool.enqueueReturning([](size_t) { return 42; });
+        shouldEqual(res.get(), 42);
+        auto fut = pool.enqueue([](size_t) { throw std::runtime_error("the test exception"); });
+        try
+        {
+            fut.get();
+            failTest("no exception thrown");
+        }
+        catch (std::runtime_error & ex)
+        {
+            shouldEqual(std::string(ex.what()), std::string("the test exception"));
+        }
+    }
+
+    void test_parallel_foreach_nested()
+    {
+        ParallelOptions::Scheduling modes[] = { ParallelOptions::SharedQueue,
+                                                ParallelOptions::WorkStealing };
+        for (auto mode : modes)
+        for (int n_threads = 2; n_threads <= 8; n_threads *= 2)
+        for (int repeat = 0; repeat < 10; ++repeat)
+        {
+            // more outer tasks than threads: without helping, all workers
+            // would block in the inner loops and the pool would deadlock
+            size_t const n_outer = 16, n_inner = 1000;
+            ThreadPool pool(ParallelOptions().numThreads(n_threads).scheduling(mode));
+            std::vector<std::vector<int> > v(n_outer, std::vector<int>(n_inner, 0));
+            parallel_foreach(pool, n_outer,
+                [&pool, &v, n_inner](size_t /*thread_id*/, size_t i)
+                {
+                    parallel_foreach(pool, n_inner,
+                        [&v, i](size_t /*thread_id*/, size_t k)
+                        {
+                            v[i][k] = (int)(i + k);
+                        }
+                    );
+                }
+            );
+            for (size_t i = 0; i < n_outer; ++i)
+                for (size_t k = 0; k < n_inner; ++k)
+                    shouldEqual(v[i][k], (int)(i + k));
+        }
+    }
+
     void test_parallel_foreach()
     {
         size_t const n = 10000;
@@ -209,6 +281,132 @@ struct ThreadPoolTests
         shouldEqual(sum, (n*(n-1))/2);
     }
 
+    void test_parallel_foreach_numa()
+    {
+        ParallelOptions::ThreadPinning modes[] = { ParallelOptions::NoPinning,
+                                                   ParallelOptions::CompactPinning,
+                                                   ParallelOptions::ScatterPinning };
+        for (auto mode : modes)
+        {
+            ThreadPool pool(ParallelOptions().numThreads(4).threadPinning(mode));
+            should(pool.numaNodeCount() >= 1);
+            for (size_t ti = 0; ti < pool.nThreads(); ++ti)
+                should(pool.numaNode(ti) >= 0 && pool.numaNode(ti) < pool.numaNodeCount());
+
+            size_t const n = 1000;
+            std::vector<int> v(n, 0);
+            parallel_foreach_numa(pool, n,
+                [&v](int /*thread_id*/, std::ptrdiff_t i)
+                {
+                    v[i] += (int)i;
+                }
+            );
+            for (size_t i = 0; i < n; ++i)
+                shouldEqual(v[i], (int)i);
+        }
+    }
+
+    void test_parallel_for()
+    {
+        size_t const n = 100000;
+        ThreadPool pool(4);
+        ParallelChunking modes[] = { StaticChunking, DynamicChunking, GuidedChunking };
+        for (auto mode : modes)
+        {
+            std::vector<int> v(n, 0);
+            parallel_for(pool, range(n), 100,
+                [&v](int /*thread_id*/, CountingIterator<size_t> piece)
+                {
+                    for (auto i : piece)
+                        v[i] += (int)i;
+                },
+                mode
+            );
+            for (size_t i = 0; i < n; ++i)
+                shouldEqual(v[i], (int)i);
+        }
+
+        // strided ranges
+        std::vector<int> v(n, 0);
+        parallel_for(pool, range(1, (int)n, 3), 10,
+            [&v](int /*thread_id*/, CountingIterator<int> piece)
+            {
+                for (auto i : piece)
+                    v[i] = 1;
+            },
+            DynamicChunking
+        );
+        for (size_t i = 0; i < n; ++i)
+            shouldEqual(v[i], (i % 3 == 1) ? 1 : 0);
+
+        // cheap, small ranges run sequentially in the calling thread
+        std::vector<int> thread_ids;
+        parallel_for(pool, range(std::ptrdiff_t(100)), 0,
+            [&thread_ids](int thread_id, CountingIterator<std::ptrdiff_t> piece)
+            {
+                thread_ids.push_back(thread_id);
+                shouldEqual(piece.end() - piece.begin(), 100);
+            }
+        );
+        shouldEqual(thread_ids.size(), 1u);
+    }
+
+    void test_parallel_for_exception()
+    {
+        bool caught = false;
+        try
+        {
+            parallel_for(4, range(std::ptrdiff_t(100000)), 10,
+                [](int /*thread_id*/, CountingIterator<std::ptrdiff_t> piece)
+                {
+                    for (auto i : piece)
+                        if (i == 5000)
+                            throw std::runtime_error("the test exception");
+                },
+                DynamicChunking
+            );
+        }
+        catch (std::runtime_error & ex)
+        {
+            caught = std::string(ex.what()) == "the test exception";
+        }
+        should(caught);
+    }
+
+    void test_parallel_reduce()
+    {
+        size_t const n = 100000;
+        std::vector<size_t> input(n);
+        std::iota(input.begin(), input.end(), 0);
+        ParallelChunking modes[] = { StaticChunking, DynamicChunking, GuidedChunking };
+        for (auto mode : modes)
+        {
+            size_t sum = parallel_reduce(4, range(n), 64, (size_t)0,
+                [&input](size_t & acc, CountingIterator<size_t> piece)
+                {
+                    for (auto i : piece)
+                        acc += input[i];
+                },
+                [](size_t a, size_t b) { return a + b; },
+                mode
+            );
+            shouldEqual(sum, (n*(n-1))/2);
+        }
+
+        // the cost hint controls whether a small range is split
+        ThreadPool pool(ParallelOptions().numThreads(4).scheduling(ParallelOptions::WorkStealing));
+        int pieces = parallel_reduce(pool, range(std::ptrdiff_t(8)), 1, 0,
+            [](int & acc, CountingIterator<std::ptrdiff_t>) { ++acc; },
+            [](int a, int b) { return a + b; },
+            DynamicChunking, 1.0e6);
+        shouldEqual(pieces, 8);
+        pieces = parallel_reduce(pool, range(std::ptrdiff_t(8)), 1, 0,
+            [](int & acc, CountingIterator<std::ptrdiff_t>) { ++acc; },
+            [](int a, int b) { return a + b; },
+            DynamicChunking, 1.0);
+        shouldEqual(pieces, 1);
+    }
+
     void test_parallel_foreach_timing()
     {
         size_t const n_threads = 4;
@@ -241,6 +439,7 @@ struct ThreadPoolTestSuite : public test_suite
     {
         add(testCase(&ThreadPoolTests::test_threadpool));
         add(testCase(&ThreadPoolTests::test_threadpool_exception));
+        add(testCase(&ThreadPoolTests::test_threadpool_work_stealing));
         add(testCase(&ThreadPoolTests::test_parallel_foreach));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_exception));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum_serial));
@@ -248,6 +447,11 @@ struct ThreadPoolTestSuite : public test_suite
     defined(BOOST_THREAD_PROVIDES_VARIADIC_THREAD)
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum_auto));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_nested));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_numa));
+        add(testCase(&ThreadPoolTests::test_parallel_for));
+        add(testCase(&ThreadPoolTests::test_parallel_for_exception));
+        add(testCase(&ThreadPoolTests::test_parallel_reduce));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_timing));
 #endif
     }
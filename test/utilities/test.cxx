@@ -49,6 +49,7 @@
 #include "vigra/priority_queue.hxx"
 #include "vigra/algorithm.hxx"
 #include "vigra/compression.hxx"
+#include "vigra/threadpool.hxx"
 #include "vigra/multi_blocking.hxx"
 
 #include "vigra/any.hxx"
@@ -1265,6 +1266,175 @@ struct CompressionTest
         shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
     }
 
+    void testZSTD()
+    {
+        ArrayVector<char> compressed;
+    #ifdef HasZSTD
+        compress(data.begin(), data.size(), compressed, ZSTD);
+        should(compressed.size() < data.size() / 100);
+
+        ArrayVector<char> decompressed(data.size());
+
+        uncompress(compressed.begin(), compressed.size(),
+                   decompressed.begin(), decompressed.size(), ZSTD);
+
+        shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+
+        compress(data.begin(), data.size(), compressed, zstdCompression(12));
+        uncompress(compressed.begin(), compressed.size(),
+                   decompressed.begin(), decompressed.size(), zstdCompression(12));
+        shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+
+        std::vector<char> shuffled;
+        compress(data.begin(), data.size() - 3, shuffled, ZSTD_BEST, BIT_SHUFFLE, 4);
+        uncompress(&shuffled[0], shuffled.size(),
+                   decompressed.begin(), data.size() - 3, ZSTD_BEST, BIT_SHUFFLE, 4);
+        shouldEqualSequence(data.begin(), data.end() - 3, decompressed.begin());
+    #else
+        try
+        {
+            compress(data.begin(), data.size(), compressed, ZSTD);
+            failTest("missing ZSTD did not throw exception.");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\ncompress(): VIGRA was compiled without ZSTD compression.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    #endif
+        should(isZstdCompression(ZSTD_FAST));
+        should(isZstdCompression(ZSTD_BEST));
+        should(!isZstdCompression(LZ4));
+        shouldEqual(zstdCompression(3), ZSTD);
+    }
+
+    void testShuffle()
+    {
+        // smooth 16-bit data, where the high bytes are highly redundant
+        ArrayVector<UInt16> values(100003);
+        for(unsigned int k=0; k<values.size(); ++k)
+            values[k] = UInt16(20000.0 + 10000.0*std::sin(k / 1000.0) + (k*7919) % 13);
+        char const * source = (char const *)values.data();
+        std::size_t size = values.size()*sizeof(UInt16);
+
+        ArrayVector<char> plain, byteShuffled, bitShuffled, decompressed(size);
+        compress(source, size, plain, LZ4);
+        compress(source, size, byteShuffled, LZ4, BYTE_SHUFFLE, sizeof(UInt16));
+        compress(source, size, bitShuffled, LZ4, BIT_SHUFFLE, sizeof(UInt16));
+        should(byteShuffled.size() < plain.size());
+        should(bitShuffled.size() < plain.size());
+
+        uncompress(byteShuffled.begin(), byteShuffled.size(),
+                   decompressed.begin(), size, LZ4, BYTE_SHUFFLE, sizeof(UInt16));
+        shouldEqualSequence(source, source+size, decompressed.begin());
+
+        uncompress(bitShuffled.begin(), bitShuffled.size(),
+                   decompressed.begin(), size, LZ4, BIT_SHUFFLE, sizeof(UInt16));
+        shouldEqualSequence(source, source+size, decompressed.begin());
+
+        // sizes that are not a multiple of the element size
+        for(std::size_t elementSize = 1; elementSize <= 8; ++elementSize)
+        {
+            ArrayVector<char> shuffled, result(data.size() - 5);
+            compress(data.begin(), result.size(), shuffled, NO_COMPRESSION, BIT_SHUFFLE, elementSize);
+            shouldEqual(shuffled.size(), result.size());
+            uncompress(shuffled.begin(), shuffled.size(),
+                       result.begin(), result.size(), NO_COMPRESSION, BIT_SHUFFLE, elementSize);
+            shouldEqualSequence(result.begin(), result.end(), data.begin());
+
+            compress(data.begin(), result.size(), shuffled, LZ4, BYTE_SHUFFLE, elementSize);
+            uncompress(shuffled.begin(), shuffled.size(),
+                       result.begin(), result.size(), LZ4, BYTE_SHUFFLE, elementSize);
+            shouldEqualSequence(result.begin(), result.end(), data.begin());
+        }
+    }
+
+    void testFramed()
+    {
+        ArrayVector<UInt16> values(100003);
+        for(unsigned int k=0; k<values.size(); ++k)
+            values[k] = UInt16(20000.0 + 10000.0*std::sin(k / 1000.0) + (k*7919) % 13);
+        char const * source = (char const *)values.data();
+        std::size_t size = values.size()*sizeof(UInt16);
+
+        for(int threads = 1; threads <= 4; threads *= 2)
+        {
+            ArrayVector<char> framed, decompressed(size);
+            compressFramed(source, size, framed, LZ4, ParallelOptions().numThreads(threads),
+                           10001, BYTE_SHUFFLE, sizeof(UInt16));
+            should(framed.size() < size);
+            shouldEqual(framedUncompressedSize(framed.begin(), framed.size()), size);
+
+            uncompressFramed(framed.begin(), framed.size(), decompressed.begin(), size,
+                             ParallelOptions().numThreads(threads));
+            shouldEqualSequence(source, source+size, decompressed.begin());
+        }
+
+        // buffers smaller than a frame and empty buffers
+        {
+            std::vector<char> framed;
+            ArrayVector<char> decompressed(data.size());
+            compressFramed(data.begin(), data.size(), framed, DEFAULT_COMPRESSION, ParallelOptions());
+            shouldEqual(framedUncompressedSize(&framed[0], framed.size()), data.size());
+            uncompressFramed(&framed[0], framed.size(), decompressed.begin(), data.size(), ParallelOptions());
+            shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+
+            framed.clear();
+            compressFramed(data.begin(), 0, framed, LZ4, ParallelOptions());
+            shouldEqual(framedUncompressedSize(&framed[0], framed.size()), 0u);
+        }
+
+        // invalid input
+        {
+            ArrayVector<char> framed, decompressed(data.size());
+            compressFramed(data.begin(), data.size(), framed, LZ4, ParallelOptions(), 100);
+            try
+            {
+                uncompressFramed(framed.begin(), framed.size() - 1, decompressed.begin(), data.size(), ParallelOptions());
+                failTest("uncompressFramed() failed to throw exception.");
+            }
+            catch(PreconditionViolation &) {}
+            ArrayVector<char> corrupted(framed);
+            std::fill(corrupted.begin()+24, corrupted.begin()+40, char(0xff));  // huge frame size and count
+            try
+            {
+                uncompressFramed(corrupted.begin(), corrupted.size(), decompressed.begin(), data.size(), ParallelOptions());
+                failTest("uncompressFramed() failed to throw exception.");
+            }
+            catch(PreconditionViolation &) {}
+            std::fill(corrupted.begin()+32, corrupted.begin()+40, char(0));  // huge frame size, but no frames
+            try
+            {
+                uncompressFramed(corrupted.begin(), corrupted.size(), decompressed.begin(), data.size(), ParallelOptions());
+                failTest("uncompressFramed() failed to throw exception.");
+            }
+            catch(PreconditionViolation &) {}
+            corrupted = framed;
+            std::fill(corrupted.begin()+40, corrupted.begin()+48, char(0xff));  // frame sizes whose sum wraps around
+            try
+            {
+                uncompressFramed(corrupted.begin(), corrupted.size(), decompressed.begin(), data.size(), ParallelOptions());
+                failTest("uncompressFramed() failed to throw exception.");
+            }
+            catch(PreconditionViolation &) {}
+            framed[5] = 3;  // invalid shuffle mode
+            try
+            {
+                uncompressFramed(framed.begin(), framed.size(), decompressed.begin(), data.size(), ParallelOptions());
+                failTest("uncompressFramed() failed to throw exception.");
+            }
+            catch(PreconditionViolation &) {}
+            framed[0] = 'X';
+            try
+            {
+                framedUncompressedSize(framed.begin(), framed.size());
+                failTest("framedUncompressedSize() failed to throw exception.");
+            }
+            catch(PreconditionViolation &) {}
+        }
+    }
+
     void testNoCompression()
     {
         ArrayVector<char> compressed;
@@ -1544,6 +1714,9 @@ struct UtilitiesTestSuite
         add( testCase( &stringTest));
         add( testCase( &CompressionTest::testZLIB));
         add( testCase( &CompressionTest::testLZ4));
+        add( testCase( &CompressionTest::testZSTD));
+        add( testCase( &CompressionTest::testShuffle));
+        add( testCase( &CompressionTest::testFramed));
         add( testCase( &CompressionTest::testNoCompression));
 
         add( testCase( &AnyTest::test));
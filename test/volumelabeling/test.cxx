@@ -40,6 +40,8 @@
 
 #include "vigra/labelvolume.hxx"
 #include "vigra/multi_labeling.hxx"
+#include "vigra/multi_runlength.hxx"
+#include "vigra/random.hxx"
 
 using namespace vigra;
 
@@ -457,6 +459,196 @@ struct VolumeLabelingTest
         shouldEqualSequence(res.begin(), res.end(), out6);
     }
 
+    void concurrentUnionFindTest()
+    {
+        const int size = 2000, unionCount = 1500;
+        ArrayVector<int> first(unionCount), second(unionCount);
+        RandomMT19937 random(42);
+        for(int k=0; k<unionCount; ++k)
+        {
+            first[k] = random.uniformInt(size);
+            second[k] = random.uniformInt(size);
+        }
+
+        UnionFindArray<int> sequential(size);
+        for(int k=0; k<unionCount; ++k)
+            sequential.makeUnion(first[k], second[k]);
+
+        ConcurrentUnionFindArray<UInt32> concurrent(size);
+        shouldEqual(concurrent.size(), (std::size_t)size);
+        parallel_foreach(4, unionCount,
+            [&](int, std::ptrdiff_t k)
+            {
+                concurrent.makeUnion(first[k], second[k]);
+            });
+
+        // same partition, and the representative is the smallest element of each set
+        for(int k=0; k<size; ++k)
+        {
+            shouldEqual((int)concurrent.findIndex(k), sequential.findIndex(k));
+            shouldEqual(concurrent.isRoot(k), sequential.findIndex(k) == k);
+        }
+    }
+
+    void parallelLabelingTest()
+    {
+        RandomMT19937 random(42);
+        IntVolume data(IntVolume::difference_type(40, 30, 25));
+        for(auto & v: data)
+            v = random.uniformInt(3);
+
+        IntVolume ref(data.shape()), res(data.shape());
+        ParallelOptions parallel = ParallelOptions().numThreads(4);
+
+        int count = labelMultiArray(data, ref, DirectNeighborhood);
+        shouldEqual(labelMultiArray(data, res, LabelOptions(), parallel), count);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        count = labelMultiArray(data, ref, IndirectNeighborhood);
+        shouldEqual(labelMultiArray(data, res, LabelOptions().neighborhood(IndirectNeighborhood), parallel), count);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        count = labelMultiArrayWithBackground(data, ref, DirectNeighborhood, 1);
+        shouldEqual(labelMultiArray(data, res, LabelOptions().ignoreBackgroundValue(1), parallel), count);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        // strided views and custom equality functor
+        MultiArray<3, UInt16> buffer(Shape3(2, 40, 25));
+        MultiArray<2, UInt16> ref2D(Shape2(40, 25));
+        MultiArrayView<2, UInt16, StridedArrayTag> labels2D = buffer.bindInner(0);
+        MultiArrayView<2, int, StridedArrayTag> slice = data.bindAt(1, 7);
+        std::not_equal_to<int> unequal;
+        count = labelMultiArray(slice, ref2D, IndirectNeighborhood, unequal);
+        shouldEqual(labelMultiArray(slice, labels2D, LabelOptions().neighborhood(IndirectNeighborhood),
+                                    parallel, unequal), count);
+        shouldEqualSequence(labels2D.begin(), labels2D.end(), ref2D.begin());
+
+        // thread count 1 falls back to the sequential algorithm
+        count = labelMultiArray(data, ref, DirectNeighborhood);
+        shouldEqual(labelMultiArray(data, res, LabelOptions(), ParallelOptions().numThreads(1)), count);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+    }
+
+    void parallelLabelingStressTest()
+    {
+        // Large inputs near the percolation threshold create long union-find paths,
+        // so that concurrent makeUnion() and findIndex() calls interfere often.
+        RandomMT19937 random(7);
+        MultiArray<3, UInt8> data(Shape3(160, 160, 80));
+        MultiArray<3, UInt32> ref(data.shape()), res(data.shape());
+        for(int threads = 4; threads <= 16; threads *= 2)
+        {
+            for(auto & v: data)
+                v = random.uniformInt(10) < 6 ? 1 : 0;
+            ParallelOptions parallel = ParallelOptions().numThreads(threads);
+
+            UInt32 count = labelMultiArray(data, ref, DirectNeighborhood);
+            shouldEqual(labelMultiArray(data, res, LabelOptions(), parallel), count);
+            should(res == ref);
+
+            count = labelMultiArray(data, ref, IndirectNeighborhood);
+            shouldEqual(labelMultiArray(data, res, LabelOptions().neighborhood(IndirectNeighborhood), parallel), count);
+            should(res == ref);
+
+            count = labelMultiArrayWithBackground(data, ref, DirectNeighborhood, (UInt8)0);
+            shouldEqual(labelMultiArray(data, res, LabelOptions().ignoreBackgroundValue(0), parallel), count);
+            should(res == ref);
+        }
+
+        // concurrent findIndex() calls on deep trees must all return the roots
+        const int size = 1000000;
+        ArrayVector<int> partner(size);
+        for(int k=0; k<size; ++k)
+            partner[k] = random.uniformInt(size);
+
+        UnionFindArray<int> sequential(size);
+        for(int k=0; k<size; ++k)
+            sequential.makeUnion(k, partner[k]);
+
+        ConcurrentUnionFindArray<UInt32> concurrent(size);
+        parallel_foreach(8, size,
+            [&](int, std::ptrdiff_t k)
+            {
+                concurrent.makeUnion((UInt32)k, (UInt32)partner[k]);
+            });
+        ArrayVector<UInt32> roots(size);
+        parallel_foreach(8, size,
+            [&](int, std::ptrdiff_t k)
+            {
+                roots[k] = concurrent.findIndex((UInt32)k);
+            });
+        for(int k=0; k<size; ++k)
+            shouldEqual((int)roots[k], sequential.findIndex(k));
+    }
+
+    void runLengthLabelingTest()
+    {
+        RandomMT19937 random(42);
+        IntVolume data(IntVolume::difference_type(40, 30, 25));
+        for(auto & v: data)
+            v = random.uniformInt(10) < 7 ? 0 : random.uniformInt(3) + 1;
+
+        // conversion
+        RunLengthArray<3, int> rle_data(data);
+        IntVolume decoded(data.shape());
+        rle_data.copyTo(decoded);
+        shouldEqualSequence(decoded.begin(), decoded.end(), data.begin());
+        shouldEqual(rle_data[Shape3(5, 6, 7)], data(5, 6, 7));
+        shouldEqual(rle_data[Shape3(39, 29, 24)], data(39, 29, 24));
+        should((rle_data == RunLengthArray<3, int>(data.transpose().transpose())));
+
+        RunLengthArray<3, int> rle_empty(IntVolume(data.shape()));
+        shouldEqual(rle_empty.runCount(), 0);
+        shouldEqual(rle_empty.lastLine(), -1);
+
+        // labeling in 3D
+        IntVolume ref(data.shape()), res(data.shape());
+        RunLengthArray<3, int> rle_labels;
+
+        int count = labelMultiArrayWithBackground(data, ref, DirectNeighborhood, 0);
+        shouldEqual(labelMultiArrayWithBackground(rle_data, rle_labels, DirectNeighborhood), count);
+        rle_labels.copyTo(res);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        count = labelMultiArrayWithBackground(data, ref, IndirectNeighborhood, 0);
+        shouldEqual(labelMultiArrayWithBackground(rle_data, rle_labels, IndirectNeighborhood), count);
+        rle_labels.copyTo(res);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        // labeling in 2D and 1D
+        MultiArrayView<2, int, StridedArrayTag> slice = data.bindAt(1, 7);
+        MultiArray<2, int> ref2D(slice.shape()), res2D(slice.shape());
+        RunLengthArray<2, int> rle_slice(slice);
+        RunLengthArray<2, UInt16> rle_labels2D;
+        for(int k=0; k<2; ++k)
+        {
+            NeighborhoodType neighborhood = k == 0 ? DirectNeighborhood : IndirectNeighborhood;
+            count = labelMultiArrayWithBackground(slice, ref2D, neighborhood, 0);
+            shouldEqual(labelMultiArrayWithBackground(rle_slice, rle_labels2D, neighborhood), count);
+            rle_labels2D.copyTo(res2D);
+            shouldEqualSequence(res2D.begin(), res2D.end(), ref2D.begin());
+        }
+
+        MultiArrayView<1, int, StridedArrayTag> row = data.bindOuter(Shape2(3, 4));
+        MultiArray<1, int> ref1D(row.shape()), res1D(row.shape());
+        RunLengthArray<1, int> rle_row(row), rle_labels1D;
+        count = labelMultiArrayWithBackground(row, ref1D, DirectNeighborhood, 0);
+        shouldEqual(labelMultiArrayWithBackground(rle_row, rle_labels1D), count);
+        rle_labels1D.copyTo(res1D);
+        shouldEqualSequence(res1D.begin(), res1D.end(), ref1D.begin());
+
+        // touching runs with equal values, as created by appendRun()
+        RunLengthArray<2, int> rle_manual(Shape2(10, 3));
+        rle_manual.appendRun(0, 0, 4, 5);
+        rle_manual.appendRun(0, 4, 6, 5);
+        rle_manual.appendRun(2, 5, 7, 5);
+        shouldEqual(labelMultiArrayWithBackground(rle_manual, rle_labels2D), 2);
+        shouldEqual(labelMultiArrayWithBackground(rle_manual, rle_labels2D, IndirectNeighborhood), 2);
+        shouldEqual(rle_labels2D[Shape2(5, 0)], 1);
+        shouldEqual(rle_labels2D[Shape2(6, 2)], 2);
+        shouldEqual(rle_labels2D[Shape2(7, 2)], 0);
+    }
+
     IntVolume vol1, vol2, vol3;
     DoubleVolume vol4, vol5, vol6;
 };
@@ -479,6 +671,10 @@ struct VolumeLabelingTestSuite
         add( testCase( &VolumeLabelingTest::labelingTwentySixTest3));
         add( testCase( &VolumeLabelingTest::labelingTwentySixWithBackgroundTest1));
         add( testCase( &VolumeLabelingTest::labelingAllTest));
+        add( testCase( &VolumeLabelingTest::concurrentUnionFindTest));
+        add( testCase( &VolumeLabelingTest::parallelLabelingTest));
+        add( testCase( &VolumeLabelingTest::parallelLabelingStressTest));
+        add( testCase( &VolumeLabelingTest::runLengthLabelingTest));
     }
 };
 
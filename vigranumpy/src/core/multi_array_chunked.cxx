@@ -939,12 +939,18 @@ void defineChunkedArray()
          "   ``Compression.ZLIB_NONE:``\n      ZLIB no compression (level = 0)\n"
          "   ``Compression.ZLIB_FAST:``\n      ZLIB fast compression (level = 1)\n"
          "   ``Compression.ZLIB_BEST:``\n      ZLIB best compression (level = 9)\n"
-         "   ``Compression.LZ4:``\n      LZ4 compression (very fast)\n\n")
+         "   ``Compression.LZ4:``\n      LZ4 compression (very fast)\n"
+         "   ``Compression.ZSTD_FAST:``\n      Zstandard fast compression (level = 1)\n"
+         "   ``Compression.ZSTD:``\n      Zstandard default compression (level = 3)\n"
+         "   ``Compression.ZSTD_BEST:``\n      Zstandard high compression (level = 19)\n\n")
         .value("ZLIB", vigra::ZLIB)
         .value("ZLIB_NONE", vigra::ZLIB_NONE)
         .value("ZLIB_FAST", vigra::ZLIB_FAST)
         .value("ZLIB_BEST", vigra::ZLIB_BEST)
         .value("LZ4", vigra::LZ4)
+        .value("ZSTD_FAST", vigra::ZSTD_FAST)
+        .value("ZSTD", vigra::ZSTD)
+        .value("ZSTD_BEST", vigra::ZSTD_BEST)
     ;
 
 #ifdef HasHDF5